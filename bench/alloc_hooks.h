@@ -0,0 +1,83 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Benchmark Allocation Counting Hooks
+ *
+ * 替换 glibc 的 malloc 系列函数，统计分配次数、分配字节数和峰值占用
+ * （同时统计 libcurl 等库内部的分配）。只能被一个基准程序的一个源文件包含。
+ *===========================================================================*/
+
+#ifndef ALLOC_HOOKS_H
+#define ALLOC_HOOKS_H
+
+#include <stddef.h>
+
+typedef struct {
+    size_t mallocs;
+    size_t reallocs;
+    size_t frees;
+    size_t bytes;       /* 累计请求的字节数 */
+    size_t live;        /* 当前占用（按 malloc_usable_size 计） */
+    size_t peak;        /* 峰值占用 */
+} AllocStats;
+
+static AllocStats alloc_stats;
+
+#ifdef __GLIBC__
+#define ALLOC_COUNTING 1
+
+#include <malloc.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static inline void alloc_track(void *ptr, size_t old_usable) {
+    alloc_stats.live -= old_usable;
+    if (ptr) alloc_stats.live += malloc_usable_size(ptr);
+    if (alloc_stats.live > alloc_stats.peak) alloc_stats.peak = alloc_stats.live;
+}
+
+void *malloc(size_t size) {
+    void *ptr = __libc_malloc(size);
+    alloc_stats.mallocs++;
+    alloc_stats.bytes += size;
+    alloc_track(ptr, 0);
+    return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    void *ptr = __libc_calloc(nmemb, size);
+    alloc_stats.mallocs++;
+    alloc_stats.bytes += nmemb * size;
+    alloc_track(ptr, 0);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+    size_t old_usable = ptr ? malloc_usable_size(ptr) : 0;
+    void *new_ptr = __libc_realloc(ptr, size);
+    alloc_stats.reallocs++;
+    alloc_stats.bytes += size;
+    if (new_ptr || size == 0) {
+        alloc_track(new_ptr, old_usable);
+    }
+    return new_ptr;
+}
+
+void free(void *ptr) {
+    if (!ptr) return;
+    alloc_stats.frees++;
+    alloc_track(NULL, malloc_usable_size(ptr));
+    __libc_free(ptr);
+}
+#else
+#define ALLOC_COUNTING 0
+#endif
+
+/* 从当前占用开始重新统计峰值 */
+static inline void alloc_stats_reset_peak(void) {
+    alloc_stats.peak = alloc_stats.live;
+}
+
+#endif /* ALLOC_HOOKS_H */
@@ -0,0 +1,153 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Benchmark: Per-Request Allocations
+ *
+ * 通过 session_query 完整执行流式查询（构建请求体、SSE 解析、增量提取、
+ * 回答缓存和历史序列化），响应由 file:// 端点提供，不需要网络。
+ * 对比每次分配都调用 malloc（GLM_CMD_ARENA_DEBUG=1）与请求级 arena
+ * 的分配次数和耗时：
+ *     bench/bench_alloc [stream.sse] [requests]
+ *===========================================================================*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench_util.h"
+#include "alloc_hooks.h"
+#include "session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define DEFAULT_STREAM "bench/data/glm-4.7-stream.sse"
+#define DEFAULT_REQUESTS 200
+#define HISTORY_ROUNDS 5
+
+static void discard_callback(const char *content, StreamContentType content_type, void *userdata) {
+    (void)content_type;
+    (void)userdata;
+    bench_sink += strlen(content);
+}
+
+/* 执行 requests 次查询，返回总耗时（纳秒），失败时返回负数 */
+static double run_queries(Session *session, int requests, AllocStats *stats) {
+    AllocStats before = alloc_stats;
+    double start = bench_now_ns();
+
+    for (int i = 0; i < requests; i++) {
+        ApiResponse *response = api_response_create();
+        if (!response) return -1;
+
+        bool ok = session_query(session, "查看当前目录下各子目录的磁盘占用",
+                                discard_callback, NULL, response);
+        if (ok && response->command) bench_sink += strlen(response->command);
+        api_response_destroy(response);
+
+        if (!ok) return -1;
+    }
+
+    double elapsed = bench_now_ns() - start;
+    stats->mallocs = alloc_stats.mallocs - before.mallocs;
+    stats->reallocs = alloc_stats.reallocs - before.reallocs;
+    stats->frees = alloc_stats.frees - before.frees;
+    stats->bytes = alloc_stats.bytes - before.bytes;
+    return elapsed;
+}
+
+static void print_row(const char *label, const AllocStats *stats, double ns, int requests) {
+    printf("  %-18s %10.1f %10.1f %10.1f %10.1f %10.1f\n", label,
+           (double)stats->mallocs / requests, (double)stats->reallocs / requests,
+           (double)stats->frees / requests, (double)stats->bytes / 1024.0 / requests,
+           ns / 1e3 / requests);
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : DEFAULT_STREAM;
+    int requests = argc > 2 ? atoi(argv[2]) : DEFAULT_REQUESTS;
+    if (requests < 1) requests = 1;
+
+    size_t stream_len;
+    char *stream = bench_read_file(path, &stream_len);
+    if (!stream) return 1;
+
+    /* file:// 端点：<dir>/chat/completions 为录制的流式响应 */
+    char dir[] = "/tmp/glm-bench-XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "Error: Cannot create temporary directory\n");
+        free(stream);
+        return 1;
+    }
+
+    char chat_dir[64], response_path[96], history_path[96], endpoint[80];
+    snprintf(chat_dir, sizeof(chat_dir), "%s/chat", dir);
+    snprintf(response_path, sizeof(response_path), "%s/completions", chat_dir);
+    snprintf(history_path, sizeof(history_path), "%s/history.jsonl", dir);
+    snprintf(endpoint, sizeof(endpoint), "file://%s", dir);
+    mkdir(chat_dir, 0755);
+
+    FILE *fp = fopen(response_path, "wb");
+    if (!fp || fwrite(stream, 1, stream_len, fp) != stream_len) {
+        fprintf(stderr, "Error: Cannot write %s\n", response_path);
+        if (fp) fclose(fp);
+        free(stream);
+        return 1;
+    }
+    fclose(fp);
+    free(stream);
+
+    /* 与命令行相同的会话，但不读取用户配置 */
+    Session *session = (Session *)calloc(1, sizeof(Session));
+    session->cfg = config_create();
+    session->cfg->api_key = strdup("bench-key");
+    session->cfg->endpoint = strdup(endpoint);
+    session->cfg->stream_enabled = true;
+    session->history = history_create(dir, HISTORY_ROUNDS);
+    session->client = client_create();
+
+    if (!session->cfg->api_key || !session->cfg->endpoint ||
+        !session->history || !session->client) {
+        fprintf(stderr, "Error: Failed to create session\n");
+        return 1;
+    }
+
+    /* 预热：填满历史并建立 curl 内部状态 */
+    AllocStats warmup;
+    if (run_queries(session, HISTORY_ROUNDS + 1, &warmup) < 0) {
+        fprintf(stderr, "Error: Query against %s failed\n", endpoint);
+        return 1;
+    }
+
+    AllocStats malloc_stats, arena_stats;
+    setenv("GLM_CMD_ARENA_DEBUG", "1", 1);
+    double malloc_ns = run_queries(session, requests, &malloc_stats);
+    unsetenv("GLM_CMD_ARENA_DEBUG");
+    double arena_ns = run_queries(session, requests, &arena_stats);
+
+    if (malloc_ns < 0 || arena_ns < 0) {
+        fprintf(stderr, "Error: Query against %s failed\n", endpoint);
+        return 1;
+    }
+
+    printf("bench_alloc: %d requests, %d history rounds (%s)\n", requests, HISTORY_ROUNDS, path);
+    if (!ALLOC_COUNTING) {
+        printf("  (allocation counting requires glibc; counts below are zero)\n");
+    }
+    printf("  %-18s %10s %10s %10s %10s %10s\n", "per request",
+           "malloc", "realloc", "free", "KB", "us");
+    print_row("malloc (before)", &malloc_stats, malloc_ns, requests);
+    print_row("arena (after)", &arena_stats, arena_ns, requests);
+
+    size_t before_calls = malloc_stats.mallocs + malloc_stats.reallocs;
+    size_t after_calls = arena_stats.mallocs + arena_stats.reallocs;
+    if (after_calls > 0) {
+        printf("  allocator calls    %10.2fx fewer\n", (double)before_calls / after_calls);
+    }
+
+    session_destroy(session);
+    remove(history_path);
+    remove(response_path);
+    rmdir(chat_dir);
+    rmdir(dir);
+    return 0;
+}
@@ -0,0 +1,237 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Benchmark: Response Cache Lookup
+ *
+ * 分别以 1000 / 100000 个条目测量响应缓存：
+ *   - open：新进程的第一次查找（打开并映射索引）
+ *   - hit / miss：已映射后的查找
+ *   - similar：多一个词的查询（相似度约 0.8），通过 MinHash/LSH 查找，阈值 0.7
+ *   - jsonl：对比逐行解析 JSON Lines 文件查找一个键（原格式）
+ *   - store：写入一个新条目（加锁、追加值、发布桶）
+ *     bench/bench_cache [scale]
+ * scale 调整查找的次数（默认 1.0；小于 1 时同时缩小条目数）。
+ *===========================================================================*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench_util.h"
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 尝试多种可能的 cJSON 头文件路径
+#if __has_include(<cjson/cJSON.h>)
+    #include <cjson/cJSON.h>
+#elif __has_include(<cJSON.h>)
+    #include <cJSON.h>
+#else
+    #include <cjson/cJSON.h>
+#endif
+
+static const char sample_context[] = "OS: Linux\nShell: bash\nArchitecture: x86_64";
+static const char sample_command[] = "du -h --max-depth=1 . | sort -rh | head -n 20";
+static const char sample_thinking[] =
+    "用户想查看各目录的磁盘占用。du 统计每个子目录，sort -rh 按大小倒序，head 只保留前 20 项。";
+
+/* 查询由固定的伪随机词表组合而成（6 个词，词表 4096 个词） */
+#define VOCABULARY 4096
+static char vocabulary[VOCABULARY][10];
+
+static uint32_t lcg_next(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static void build_vocabulary(void) {
+    uint32_t state = 12345;
+    for (int i = 0; i < VOCABULARY; i++) {
+        int len = 3 + (int)(lcg_next(&state) % 6);
+        for (int j = 0; j < len; j++) vocabulary[i][j] = (char)('a' + lcg_next(&state) % 26);
+        vocabulary[i][len] = '\0';
+    }
+}
+
+/* 第 i 个查询；similar 为 true 时在中间多加一个词（相似度约 0.8） */
+static void make_query(char *buf, size_t size, int i, bool similar) {
+    uint32_t state = (uint32_t)i * 2654435761u + 1;
+    size_t len = 0;
+    buf[0] = '\0';
+    for (int w = 0; w < 6 && len < size; w++) {
+        if (similar && w == 3) len += (size_t)snprintf(buf + len, size - len, "the ");
+        if (len >= size) break;
+        len += (size_t)snprintf(buf + len, size - len, w < 5 ? "%s " : "%s",
+                                vocabulary[lcg_next(&state) % VOCABULARY]);
+    }
+}
+
+static void sample_query(char *buf, size_t size, int i) {
+    make_query(buf, size, i, false);
+}
+
+static void similar_query(char *buf, size_t size, int i) {
+    make_query(buf, size, i, true);
+}
+
+/* 原格式：逐行解析，找到匹配的键为止（平均扫描一半的文件） */
+static double run_jsonl(const char *path, const char *key_hex, int lookups) {
+    double start = bench_now_ns();
+    for (int n = 0; n < lookups; n++) {
+        size_t len;
+        char *data = bench_read_file(path, &len);
+        if (!data) return -1;
+
+        const char *line = data;
+        const char *end = data + len;
+        while (line < end) {
+            const char *newline = (const char *)memchr(line, '\n', (size_t)(end - line));
+            const char *line_end = newline ? newline : end;
+            cJSON *record = cJSON_ParseWithLength(line, (size_t)(line_end - line));
+            cJSON *key = cJSON_GetObjectItem(record, "key");
+            bool found = cJSON_IsString(key) && strcmp(key->valuestring, key_hex) == 0;
+            cJSON_Delete(record);
+            if (found || !newline) break;
+            line = newline + 1;
+        }
+        free(data);
+    }
+    return (bench_now_ns() - start) / lookups / 1000.0;
+}
+
+int main(int argc, char *argv[]) {
+    double scale = argc > 1 ? atof(argv[1]) : 1.0;
+    if (scale <= 0) scale = 1.0;
+
+    static const int entry_counts[] = { 1000, 100000 };
+
+    char dir[] = "/tmp/glm-bench-XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "Error: Cannot create temporary directory\n");
+        return 1;
+    }
+    char index_path[96], heap_path[96], lock_path[96], jsonl_path[96];
+    snprintf(index_path, sizeof(index_path), "%s/response_cache.idx", dir);
+    snprintf(heap_path, sizeof(heap_path), "%s/response_cache.heap", dir);
+    snprintf(lock_path, sizeof(lock_path), "%s/response_cache.lock", dir);
+    snprintf(jsonl_path, sizeof(jsonl_path), "%s/legacy.jsonl", dir);
+
+    printf("bench_cache: response cache lookup (mmap hash table vs JSON Lines scan)\n");
+    printf("  %8s %9s %9s %9s %10s %9s %11s %9s\n", "entries", "open us", "hit us", "miss us",
+           "similar us", "store us", "jsonl us", "speedup");
+
+    build_vocabulary();
+    Arena *arena = arena_create(0);
+    char query[128];
+
+    for (size_t e = 0; e < sizeof(entry_counts) / sizeof(entry_counts[0]); e++) {
+        int entries = (int)(entry_counts[e] * (scale < 1.0 ? scale : 1.0));
+        if (entries < 10) entries = 10;
+        int lookups = (int)(200000 * scale);
+        if (lookups < 100) lookups = 100;
+
+        remove(index_path);
+        remove(heap_path);
+
+        /* 填充缓存，同时写出原格式的文件 */
+        ResponseCache *cache = response_cache_create(dir, 0, entries + 1);
+        uint64_t context = response_cache_context(NULL, sample_context);
+        FILE *jsonl = fopen(jsonl_path, "wb");
+        if (!cache || !jsonl) {
+            fprintf(stderr, "Error: Cannot create cache in %s\n", dir);
+            return 1;
+        }
+
+        double start = bench_now_ns();
+        for (int i = 0; i < entries; i++) {
+            sample_query(query, sizeof(query), i);
+            uint64_t key = response_cache_key(query, NULL, sample_context);
+            response_cache_store(cache, key, context, query, sample_command, sample_thinking);
+            fprintf(jsonl, "{\"key\":\"%016llx\",\"created\":0,\"query\":\"%s\",\"command\":\"%s\","
+                    "\"thinking\":\"%s\"}\n", (unsigned long long)key, query, sample_command,
+                    sample_thinking);
+        }
+        double store_us = (bench_now_ns() - start) / entries / 1000.0;
+        fclose(jsonl);
+        response_cache_destroy(cache);
+
+        /* 第一次查找：包括打开和映射 */
+        cache = response_cache_create(dir, 0, entries + 1);
+        ResponseCacheEntry entry;
+        sample_query(query, sizeof(query), entries / 2);
+        uint64_t key = response_cache_key(query, NULL, sample_context);
+        start = bench_now_ns();
+        bool found = response_cache_lookup(cache, key, query, arena, &entry);
+        double open_us = (bench_now_ns() - start) / 1000.0;
+        if (!found) {
+            fprintf(stderr, "Error: Entry %d not found\n", entries / 2);
+            return 1;
+        }
+
+        /* 查找的键预先算好，只计时查找本身 */
+        uint64_t *keys = (uint64_t *)malloc(sizeof(uint64_t) * 1024);
+        char (*queries)[128] = malloc(sizeof(*queries) * 1024);
+        for (int i = 0; i < 1024; i++) {
+            sample_query(queries[i], sizeof(queries[i]), (int)((i * 7919L) % entries));
+            keys[i] = response_cache_key(queries[i], NULL, sample_context);
+        }
+
+        int hits = 0;
+        start = bench_now_ns();
+        for (int i = 0; i < lookups; i++) {
+            hits += response_cache_lookup(cache, keys[i & 1023], queries[i & 1023], arena, &entry);
+            if ((i & 1023) == 1023) {
+                arena_destroy(arena);
+                arena = arena_create(0);
+            }
+        }
+        double hit_us = (bench_now_ns() - start) / lookups / 1000.0;
+        if (hits != lookups) {
+            fprintf(stderr, "Error: %d of %d lookups hit\n", hits, lookups);
+            return 1;
+        }
+
+        start = bench_now_ns();
+        for (int i = 0; i < lookups; i++) {
+            hits += response_cache_lookup(cache, keys[i & 1023] ^ 0x5bd1e995, queries[i & 1023],
+                                          arena, &entry);
+        }
+        double miss_us = (bench_now_ns() - start) / lookups / 1000.0;
+
+        /* 相似查找：LSH 不保证召回，只统计命中率 */
+        int similar_lookups = lookups / 10 > 100 ? lookups / 10 : 100;
+        int similar_hits = 0;
+        start = bench_now_ns();
+        for (int i = 0; i < similar_lookups; i++) {
+            similar_query(query, sizeof(query), (int)((i * 7919L) % entries));
+            similar_hits += response_cache_lookup_similar(cache, context, query, 0.7, arena,
+                                                          &entry);
+            if ((i & 1023) == 1023) {
+                arena_destroy(arena);
+                arena = arena_create(0);
+            }
+        }
+        double similar_us = (bench_now_ns() - start) / similar_lookups / 1000.0;
+
+        char key_hex[17];
+        snprintf(key_hex, sizeof(key_hex), "%016llx", (unsigned long long)key);
+        int scans = entries > 10000 ? 5 : 100;
+        double jsonl_us = run_jsonl(jsonl_path, key_hex, scans);
+
+        printf("  %8d %9.2f %9.3f %9.3f %10.2f %9.2f %11.1f %8.0fx\n", entries, open_us, hit_us,
+               miss_us, similar_us, store_us, jsonl_us, jsonl_us / hit_us);
+        printf("  %8s similar hit rate %.1f%%\n", "", 100.0 * similar_hits / similar_lookups);
+
+        free(keys);
+        free(queries);
+        response_cache_destroy(cache);
+    }
+
+    arena_destroy(arena);
+    remove(index_path);
+    remove(heap_path);
+    remove(lock_path);
+    remove(jsonl_path);
+    rmdir(dir);
+    return 0;
+}
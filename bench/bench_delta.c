@@ -0,0 +1,209 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Benchmark: Streaming Delta Extraction
+ *
+ * 对比每个 SSE 事件构建完整 cJSON 树（原实现）与 delta_extract 扫描提取
+ * 的吞吐量。默认输入为 glm-4.7 格式的流式响应样本：
+ *     bench/bench_delta [stream.sse] [iterations]
+ *===========================================================================*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench_util.h"
+#include "sse.h"
+#include "delta.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 尝试多种可能的 cJSON 头文件路径
+#if __has_include(<cjson/cJSON.h>)
+    #include <cjson/cJSON.h>
+#elif __has_include(<cJSON.h>)
+    #include <cJSON.h>
+#else
+    #include <cjson/cJSON.h>
+#endif
+
+#define DEFAULT_STREAM "bench/data/glm-4.7-stream.sse"
+#define DEFAULT_ITERATIONS 200
+
+/* 预先切分好的事件数据 */
+typedef struct {
+    char **data;
+    size_t *len;
+    size_t count;
+    size_t capacity;
+} EventList;
+
+static void collect_event(const char *event, const char *data, size_t data_len, void *userdata) {
+    EventList *list = (EventList *)userdata;
+    (void)event;
+
+    /* [DONE] 不参与计时 */
+    if (data_len >= 6 && strncmp(data, "[DONE]", 6) == 0) return;
+
+    if (list->count >= list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->data = (char **)realloc(list->data, list->capacity * sizeof(char *));
+        list->len = (size_t *)realloc(list->len, list->capacity * sizeof(size_t));
+        if (!list->data || !list->len) {
+            fprintf(stderr, "Error: Out of memory\n");
+            exit(1);
+        }
+    }
+
+    char *copy = (char *)malloc(data_len);
+    if (!copy) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    memcpy(copy, data, data_len);
+    list->data[list->count] = copy;
+    list->len[list->count] = data_len;
+    list->count++;
+}
+
+/* 原实现：复制事件数据、构建 cJSON 树、读取 delta 字段 */
+static size_t extract_with_cjson(const char *data, size_t len, FILE *trace) {
+    size_t bytes = 0;
+
+    char *json_str = (char *)malloc(len + 1);
+    if (!json_str) return 0;
+    memcpy(json_str, data, len);
+    json_str[len] = '\0';
+
+    cJSON *json = cJSON_Parse(json_str);
+    free(json_str);
+    if (!json) return 0;
+
+    cJSON *choices = cJSON_GetObjectItem(json, "choices");
+    if (choices && cJSON_IsArray(choices)) {
+        cJSON *choice = cJSON_GetArrayItem(choices, 0);
+        if (choice) {
+            cJSON *delta = cJSON_GetObjectItem(choice, "delta");
+            if (delta) {
+                cJSON *reasoning = cJSON_GetObjectItem(delta, "reasoning_content");
+                if (reasoning && cJSON_IsString(reasoning) && strlen(reasoning->valuestring) > 0) {
+                    bytes += strlen(reasoning->valuestring);
+                    if (trace) fputs(reasoning->valuestring, trace);
+                }
+                cJSON *content = cJSON_GetObjectItem(delta, "content");
+                if (content && cJSON_IsString(content) && strlen(content->valuestring) > 0) {
+                    bytes += strlen(content->valuestring);
+                    if (trace) fputs(content->valuestring, trace);
+                }
+            }
+        }
+    }
+
+    cJSON_Delete(json);
+    return bytes;
+}
+
+/* 新实现：delta_extract 直接扫描事件字节 */
+static size_t extract_with_scanner(DeltaExtractor *extractor, const char *data, size_t len,
+                                   FILE *trace) {
+    DeltaEvent event;
+    if (!delta_extract(extractor, data, len, &event)) {
+        return extract_with_cjson(data, len, trace);
+    }
+
+    if (trace) {
+        if (event.reasoning_len > 0) fputs(event.reasoning, trace);
+        if (event.content_len > 0) fputs(event.content, trace);
+    }
+    return event.reasoning_len + event.content_len;
+}
+
+/* 两种实现的输出必须一致 */
+static int verify(const EventList *events, DeltaExtractor *extractor) {
+    char *expected = NULL, *actual = NULL;
+    size_t expected_len = 0, actual_len = 0;
+
+    FILE *fp = open_memstream(&expected, &expected_len);
+    for (size_t i = 0; i < events->count; i++) {
+        extract_with_cjson(events->data[i], events->len[i], fp);
+    }
+    fclose(fp);
+
+    fp = open_memstream(&actual, &actual_len);
+    for (size_t i = 0; i < events->count; i++) {
+        extract_with_scanner(extractor, events->data[i], events->len[i], fp);
+    }
+    fclose(fp);
+
+    int ok = expected_len == actual_len && memcmp(expected, actual, expected_len) == 0;
+    free(expected);
+    free(actual);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : DEFAULT_STREAM;
+    int iterations = argc > 2 ? atoi(argv[2]) : DEFAULT_ITERATIONS;
+    if (iterations < 1) iterations = 1;
+
+    size_t stream_len;
+    char *stream = bench_read_file(path, &stream_len);
+    if (!stream) return 1;
+
+    EventList events = {0};
+    SseParser parser;
+    sse_parser_init(&parser, NULL, collect_event, &events);
+    sse_parser_feed(&parser, stream, stream_len);
+    sse_parser_finish(&parser);
+    sse_parser_free(&parser);
+    free(stream);
+
+    if (events.count == 0) {
+        fprintf(stderr, "Error: No events in %s\n", path);
+        return 1;
+    }
+
+    DeltaExtractor extractor;
+    delta_extractor_init(&extractor, NULL);
+
+    if (!verify(&events, &extractor)) {
+        fprintf(stderr, "Error: delta_extract output differs from cJSON\n");
+        return 1;
+    }
+
+    /* 预热 */
+    for (size_t i = 0; i < events.count; i++) {
+        bench_sink += extract_with_cjson(events.data[i], events.len[i], NULL);
+        bench_sink += extract_with_scanner(&extractor, events.data[i], events.len[i], NULL);
+    }
+
+    double start = bench_now_ns();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < events.count; i++) {
+            bench_sink += extract_with_cjson(events.data[i], events.len[i], NULL);
+        }
+    }
+    double cjson_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < events.count; i++) {
+            bench_sink += extract_with_scanner(&extractor, events.data[i], events.len[i], NULL);
+        }
+    }
+    double scanner_ns = bench_now_ns() - start;
+
+    double total_events = (double)events.count * iterations;
+    printf("bench_delta: %zu events x %d iterations (%s)\n", events.count, iterations, path);
+    printf("  cJSON tree      %12.0f events/sec  %8.1f ns/event\n",
+           total_events / (cjson_ns / 1e9), cjson_ns / total_events);
+    printf("  delta_extract   %12.0f events/sec  %8.1f ns/event\n",
+           total_events / (scanner_ns / 1e9), scanner_ns / total_events);
+    printf("  speedup         %12.2fx\n", cjson_ns / scanner_ns);
+
+    for (size_t i = 0; i < events.count; i++) {
+        free(events.data[i]);
+    }
+    free(events.data);
+    free(events.len);
+    delta_extractor_free(&extractor);
+    return 0;
+}
@@ -0,0 +1,656 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Benchmark: End-to-End Latency
+ *
+ * 启动本地模拟服务器（tools/glm-mock-server），多次运行真实的 glm-cmd 进程，
+ * 从进程启动开始测量用户感受到的延迟：
+ *   - first token：输出 "Processing your request..." 之后第一次出现内容
+ *     （流式的第一个思考片段、非流式的完整结果、缓存命中的提示）
+ *   - command：输出 [Generated Command]
+ *   - exit：进程退出（确认提示自动回答 n）
+ * 对每种模式（stream / non-stream / cache）、memory_rounds 和初始历史记录数的组合
+ * 报告 p50 / p95 / p99（毫秒）。每个组合使用独立的 HOME，第一次运行前写好
+ * config.ini 和历史文件，预热运行建立系统信息快照、前缀缓存和响应缓存：
+ *     bench/bench_e2e [options]
+ * 需要先编译 glm-cmd 和 tools/glm-mock-server（make bench-e2e 会一并完成）。
+ *===========================================================================*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench_util.h"
+#include "history.h"
+#include "json_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define DEFAULT_GLM_CMD "./glm-cmd"
+#define DEFAULT_SERVER "tools/glm-mock-server"
+#define DEFAULT_RUNS 20
+#define DEFAULT_WARMUP 2
+#define MAX_VALUES 16
+
+static const char query[] = "查找当前目录下所有大于 100MB 的文件并按大小排序";
+
+typedef enum {
+    MODE_STREAM,
+    MODE_NON_STREAM,
+    MODE_CACHE
+} RunMode;
+
+static const char *const mode_names[] = { "stream", "non-stream", "cache" };
+
+/* 驱动程序选项 */
+typedef struct {
+    const char *glm_cmd;
+    const char *server;
+    int runs;
+    int warmup;
+    double ttfb_ms;
+    double token_delay_ms;
+    int modes[MAX_VALUES];
+    int mode_count;
+    int rounds[MAX_VALUES];
+    int round_count;
+    int histories[MAX_VALUES];
+    int history_count;
+    const char *json_path;
+} E2eOptions;
+
+/* 一次运行的时间点（毫秒，相对 fork 之前），未出现时为 -1 */
+typedef struct {
+    double first_token;
+    double command;
+    double exit;
+    bool ok;
+} RunTimes;
+
+/* 一个组合的结果 */
+typedef struct {
+    RunMode mode;
+    int memory_rounds;
+    int history_records;
+    int failures;
+    BenchStats first_token;
+    BenchStats command;
+    BenchStats exit;
+} ScenarioResult;
+
+/*----------------------------------------------------------------------------
+ * 工具函数
+ *--------------------------------------------------------------------------*/
+
+static int parse_list(const char *text, int *values, const char *option) {
+    int count = 0;
+    char *copy = strdup(text);
+    if (!copy) return -1;
+
+    for (char *item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+        if (count >= MAX_VALUES) {
+            fprintf(stderr, "Error: Too many values for %s (at most %d)\n", option, MAX_VALUES);
+            count = -1;
+            break;
+        }
+        char *end;
+        long value = strtol(item, &end, 10);
+        if (*end != '\0' || value < 0) {
+            fprintf(stderr, "Error: Invalid value for %s: %s\n", option, item);
+            count = -1;
+            break;
+        }
+        values[count++] = (int)value;
+    }
+
+    free(copy);
+    return count;
+}
+
+static int parse_modes(const char *text, int *modes) {
+    int count = 0;
+    char *copy = strdup(text);
+    if (!copy) return -1;
+
+    for (char *item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+        int mode = -1;
+        for (int i = 0; i < 3; i++) {
+            if (strcmp(item, mode_names[i]) == 0) mode = i;
+        }
+        if (mode < 0 || count >= MAX_VALUES) {
+            fprintf(stderr, "Error: Invalid mode: %s (use stream, non-stream or cache)\n", item);
+            count = -1;
+            break;
+        }
+        modes[count++] = mode;
+    }
+
+    free(copy);
+    return count;
+}
+
+static void remove_tree(const char *path) {
+    DIR *dir = opendir(path);
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            char child[1024];
+            snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+            remove_tree(child);
+        }
+        closedir(dir);
+        rmdir(path);
+    } else {
+        remove(path);
+    }
+}
+
+/* 子进程不继承调用者的 GLM_CMD_* 环境变量（会覆盖 config.ini） */
+static void clear_glm_environment(void) {
+    extern char **environ;
+    bool found = true;
+    while (found) {
+        found = false;
+        for (char **env = environ; *env; env++) {
+            if (strncmp(*env, "GLM_CMD_", 8) == 0) {
+                char name[128];
+                size_t len = strcspn(*env, "=");
+                if (len >= sizeof(name)) len = sizeof(name) - 1;
+                memcpy(name, *env, len);
+                name[len] = '\0';
+                unsetenv(name);
+                found = true;
+                break;
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * 模拟服务器
+ *--------------------------------------------------------------------------*/
+
+/* 启动模拟服务器（任意空闲端口），返回端口号，失败时返回 -1 */
+static int start_server(const E2eOptions *opts, pid_t *pid) {
+    int out[2];
+    if (pipe(out) != 0) return -1;
+
+    char ttfb[32], delay[32];
+    snprintf(ttfb, sizeof(ttfb), "%g", opts->ttfb_ms);
+    snprintf(delay, sizeof(delay), "%g", opts->token_delay_ms);
+
+    *pid = fork();
+    if (*pid < 0) return -1;
+    if (*pid == 0) {
+        dup2(out[1], STDOUT_FILENO);
+        close(out[0]);
+        close(out[1]);
+        execl(opts->server, opts->server, "--port", "0", "--quiet",
+              "--ttfb", ttfb, "--token-delay", delay, (char *)NULL);
+        fprintf(stderr, "Error: Cannot run %s: %s\n", opts->server, strerror(errno));
+        _exit(127);
+    }
+    close(out[1]);
+
+    /* 第一行：Listening on http://127.0.0.1:PORT */
+    char line[128];
+    size_t len = 0;
+    while (len < sizeof(line) - 1) {
+        ssize_t n = read(out[0], line + len, 1);
+        if (n <= 0 || line[len] == '\n') break;
+        len++;
+    }
+    line[len] = '\0';
+    close(out[0]);
+
+    const char *colon = strrchr(line, ':');
+    int port = colon ? atoi(colon + 1) : 0;
+    if (port <= 0) {
+        kill(*pid, SIGTERM);
+        waitpid(*pid, NULL, 0);
+        return -1;
+    }
+    return port;
+}
+
+/*----------------------------------------------------------------------------
+ * 组合准备和运行
+ *--------------------------------------------------------------------------*/
+
+static bool prepare_home(const char *home, RunMode mode, int memory_rounds, int history_records,
+                         int port) {
+    char config_dir[512], path[600];
+    snprintf(config_dir, sizeof(config_dir), "%s/.glm-cmd", home);
+    if (mkdir(home, 0700) != 0 || mkdir(config_dir, 0700) != 0) return false;
+
+    snprintf(path, sizeof(path), "%s/config.ini", config_dir);
+    FILE *fp = fopen(path, "w");
+    if (!fp) return false;
+    fprintf(fp,
+            "api_key=\"bench-key\"\n"
+            "endpoint=\"http://127.0.0.1:%d\"\n"
+            "model=\"glm-4.7\"\n"
+            "memory_enabled=%s\n"
+            "memory_rounds=%d\n"
+            "stream_enabled=%s\n"
+            "cache_enabled=%s\n",
+            port, memory_rounds > 0 ? "true" : "false", memory_rounds > 0 ? memory_rounds : 5,
+            mode == MODE_NON_STREAM ? "false" : "true", mode == MODE_CACHE ? "true" : "false");
+    if (fclose(fp) != 0) return false;
+
+    if (history_records <= 0) return true;
+
+    /* 历史文件：history_records 条记录（glm-cmd 只加载末尾 memory_rounds 轮） */
+    ConversationHistory *history = history_create(config_dir, history_records);
+    if (!history) return false;
+    for (int i = 0; i < history_records; i++) {
+        history_add_round(history, bench_sample_user, bench_sample_assistant);
+    }
+    bool ok = history_save(history, NULL);
+    history_destroy(history);
+    return ok;
+}
+
+/* 输出中 "Processing your request..." 之后是否已有内容（跳过颜色代码和空白） */
+static bool has_content_after_banner(const char *output) {
+    const char *pos = strstr(output, "Processing your request...");
+    if (!pos) return false;
+    pos += strlen("Processing your request...");
+
+    while (*pos) {
+        if (*pos == '\033') {
+            while (*pos && *pos != 'm') pos++;
+            if (*pos) pos++;
+        } else if (*pos == '\n' || *pos == '\r' || *pos == ' ') {
+            pos++;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool run_once(const E2eOptions *opts, const char *home, RunTimes *times) {
+    times->first_token = -1;
+    times->command = -1;
+    times->exit = -1;
+    times->ok = false;
+
+    int in[2], out[2];
+    if (pipe(in) != 0) return false;
+    if (pipe(out) != 0) {
+        close(in[0]);
+        close(in[1]);
+        return false;
+    }
+
+    double start = bench_now_ns();
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(in[0], STDIN_FILENO);
+        dup2(out[1], STDOUT_FILENO);
+        if (null_fd >= 0) dup2(null_fd, STDERR_FILENO);
+        close(in[0]);
+        close(in[1]);
+        close(out[0]);
+        close(out[1]);
+        setenv("HOME", home, 1);
+        execl(opts->glm_cmd, opts->glm_cmd, "--no-daemon", query, (char *)NULL);
+        _exit(127);
+    }
+    close(in[0]);
+    close(out[1]);
+
+    /* 确认提示：不执行命令 */
+    if (write(in[1], "n\n", 2) != 2) {
+        /* 子进程已退出时由下面的退出状态报告 */
+    }
+    close(in[1]);
+
+    size_t cap = 16384, len = 0;
+    char *output = (char *)malloc(cap);
+    char chunk[4096];
+    ssize_t n;
+
+    while (output && (n = read(out[0], chunk, sizeof(chunk))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        double now = (bench_now_ns() - start) / 1e6;
+
+        if (len + (size_t)n + 1 > cap) {
+            while (len + (size_t)n + 1 > cap) cap *= 2;
+            char *grown = (char *)realloc(output, cap);
+            if (!grown) break;
+            output = grown;
+        }
+        memcpy(output + len, chunk, (size_t)n);
+        len += (size_t)n;
+        output[len] = '\0';
+
+        if (times->first_token < 0 && has_content_after_banner(output)) {
+            times->first_token = now;
+        }
+        if (times->command < 0 && strstr(output, "[Generated Command]")) {
+            times->command = now;
+        }
+    }
+    close(out[0]);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    times->exit = (bench_now_ns() - start) / 1e6;
+    times->ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+                times->first_token >= 0 && times->command >= 0;
+
+    free(output);
+    return times->ok;
+}
+
+static bool run_scenario(const E2eOptions *opts, const char *root, int index, int port,
+                         ScenarioResult *result) {
+    char home[256];
+    snprintf(home, sizeof(home), "%s/%d", root, index);
+    if (!prepare_home(home, result->mode, result->memory_rounds, result->history_records, port)) {
+        fprintf(stderr, "Error: Cannot prepare %s\n", home);
+        return false;
+    }
+
+    /* 预热：系统信息快照、前缀缓存和响应缓存（cache 模式） */
+    RunTimes times;
+    for (int i = 0; i < opts->warmup; i++) {
+        run_once(opts, home, &times);
+    }
+
+    double *first_token = (double *)malloc((size_t)opts->runs * sizeof(double));
+    double *command = (double *)malloc((size_t)opts->runs * sizeof(double));
+    double *exit_ms = (double *)malloc((size_t)opts->runs * sizeof(double));
+    if (!first_token || !command || !exit_ms) {
+        free(first_token);
+        free(command);
+        free(exit_ms);
+        return false;
+    }
+
+    int count = 0;
+    for (int i = 0; i < opts->runs; i++) {
+        if (!run_once(opts, home, &times)) {
+            result->failures++;
+            continue;
+        }
+        first_token[count] = times.first_token;
+        command[count] = times.command;
+        exit_ms[count] = times.exit;
+        count++;
+    }
+
+    result->first_token = bench_stats(first_token, count);
+    result->command = bench_stats(command, count);
+    result->exit = bench_stats(exit_ms, count);
+
+    free(first_token);
+    free(command);
+    free(exit_ms);
+    remove_tree(home);
+    return true;
+}
+
+/*----------------------------------------------------------------------------
+ * 输出
+ *--------------------------------------------------------------------------*/
+
+static void print_row(const ScenarioResult *result) {
+    printf("  %-10s %6d %8d", mode_names[result->mode], result->memory_rounds,
+           result->history_records);
+    const BenchStats *stats[] = { &result->first_token, &result->command, &result->exit };
+    for (int i = 0; i < 3; i++) {
+        if (stats[i]->count == 0) {
+            printf("  %7s %7s %7s", "-", "-", "-");
+        } else {
+            printf("  %7.1f %7.1f %7.1f", stats[i]->p50, stats[i]->p95, stats[i]->p99);
+        }
+    }
+    printf("  %4d\n", result->failures);
+    fflush(stdout);
+}
+
+static void write_stats(JsonWriter *writer, const char *key, const BenchStats *stats) {
+    json_writer_key(writer, key);
+    if (stats->count == 0) {
+        json_writer_null(writer);
+        return;
+    }
+    json_writer_begin_object(writer);
+    json_writer_key(writer, "min");
+    json_writer_double(writer, stats->min);
+    json_writer_key(writer, "mean");
+    json_writer_double(writer, stats->mean);
+    json_writer_key(writer, "p50");
+    json_writer_double(writer, stats->p50);
+    json_writer_key(writer, "p95");
+    json_writer_double(writer, stats->p95);
+    json_writer_key(writer, "p99");
+    json_writer_double(writer, stats->p99);
+    json_writer_key(writer, "max");
+    json_writer_double(writer, stats->max);
+    json_writer_end_object(writer);
+}
+
+static bool write_json(const E2eOptions *opts, const ScenarioResult *results, int count) {
+    JsonWriter writer;
+    json_writer_init(&writer, NULL, 4096);
+    json_writer_begin_object(&writer);
+    json_writer_key(&writer, "benchmark");
+    json_writer_string(&writer, "bench_e2e");
+    json_writer_key(&writer, "runs");
+    json_writer_int(&writer, opts->runs);
+    json_writer_key(&writer, "warmup");
+    json_writer_int(&writer, opts->warmup);
+    json_writer_key(&writer, "ttfb_ms");
+    json_writer_double(&writer, opts->ttfb_ms);
+    json_writer_key(&writer, "token_delay_ms");
+    json_writer_double(&writer, opts->token_delay_ms);
+    json_writer_key(&writer, "unit");
+    json_writer_string(&writer, "ms");
+
+    json_writer_key(&writer, "results");
+    json_writer_begin_array(&writer);
+    for (int i = 0; i < count; i++) {
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "mode");
+        json_writer_string(&writer, mode_names[results[i].mode]);
+        json_writer_key(&writer, "memory_rounds");
+        json_writer_int(&writer, results[i].memory_rounds);
+        json_writer_key(&writer, "history_records");
+        json_writer_int(&writer, results[i].history_records);
+        json_writer_key(&writer, "samples");
+        json_writer_int(&writer, results[i].exit.count);
+        json_writer_key(&writer, "failures");
+        json_writer_int(&writer, results[i].failures);
+        write_stats(&writer, "first_token", &results[i].first_token);
+        write_stats(&writer, "command", &results[i].command);
+        write_stats(&writer, "exit", &results[i].exit);
+        json_writer_end_object(&writer);
+    }
+    json_writer_end_array(&writer);
+    json_writer_end_object(&writer);
+
+    size_t len = 0;
+    char *json = json_writer_finish(&writer, &len);
+    if (!json) return false;
+
+    FILE *fp = strcmp(opts->json_path, "-") == 0 ? stdout : fopen(opts->json_path, "wb");
+    bool ok = fp && fwrite(json, 1, len, fp) == len && fputc('\n', fp) != EOF;
+    if (fp && fp != stdout && fclose(fp) != 0) ok = false;
+    free(json);
+    return ok;
+}
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [options]\n\n", program);
+    printf("Options:\n");
+    printf("  -n, --runs N              Measured runs per scenario (default: %d)\n", DEFAULT_RUNS);
+    printf("  -w, --warmup N            Unmeasured runs per scenario (default: %d)\n",
+           DEFAULT_WARMUP);
+    printf("  -m, --modes LIST          stream,non-stream,cache (default: all)\n");
+    printf("  -r, --memory-rounds LIST  memory_rounds values, 0 = memory disabled (default: 0,5,50)\n");
+    printf("  -H, --history LIST        History records written before the first run (default: 0,10000)\n");
+    printf("  -t, --ttfb MS             Server delay before the first byte (default: 0)\n");
+    printf("  -d, --token-delay MS      Server delay between stream pieces (default: 0)\n");
+    printf("  -j, --json FILE           Also write the results as JSON ('-' for stdout)\n");
+    printf("      --glm-cmd PATH        Client binary (default: %s)\n", DEFAULT_GLM_CMD);
+    printf("      --server PATH         Mock server binary (default: %s)\n", DEFAULT_SERVER);
+    printf("  -h, --help                Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    E2eOptions opts = {
+        .glm_cmd = DEFAULT_GLM_CMD,
+        .server = DEFAULT_SERVER,
+        .runs = DEFAULT_RUNS,
+        .warmup = DEFAULT_WARMUP,
+        .modes = { MODE_STREAM, MODE_NON_STREAM, MODE_CACHE },
+        .mode_count = 3,
+        .rounds = { 0, 5, 50 },
+        .round_count = 3,
+        .histories = { 0, 10000 },
+        .history_count = 2,
+    };
+
+    enum { OPT_GLM_CMD = 1000, OPT_SERVER };
+    static struct option long_options[] = {
+        {"runs",          required_argument, 0, 'n'},
+        {"warmup",        required_argument, 0, 'w'},
+        {"modes",         required_argument, 0, 'm'},
+        {"memory-rounds", required_argument, 0, 'r'},
+        {"history",       required_argument, 0, 'H'},
+        {"ttfb",          required_argument, 0, 't'},
+        {"token-delay",   required_argument, 0, 'd'},
+        {"json",          required_argument, 0, 'j'},
+        {"glm-cmd",       required_argument, 0, OPT_GLM_CMD},
+        {"server",        required_argument, 0, OPT_SERVER},
+        {"help",          no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:w:m:r:H:t:d:j:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': opts.runs = atoi(optarg); break;
+            case 'w': opts.warmup = atoi(optarg); break;
+            case 'm': opts.mode_count = parse_modes(optarg, opts.modes); break;
+            case 'r': opts.round_count = parse_list(optarg, opts.rounds, "--memory-rounds"); break;
+            case 'H': opts.history_count = parse_list(optarg, opts.histories, "--history"); break;
+            case 't': opts.ttfb_ms = atof(optarg); break;
+            case 'd': opts.token_delay_ms = atof(optarg); break;
+            case 'j': opts.json_path = optarg; break;
+            case OPT_GLM_CMD: opts.glm_cmd = optarg; break;
+            case OPT_SERVER: opts.server = optarg; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (opts.mode_count <= 0 || opts.round_count <= 0 || opts.history_count <= 0) return 1;
+    if (opts.runs < 1) opts.runs = 1;
+    if (opts.warmup < 0) opts.warmup = 0;
+
+    /* cache 模式的第一次运行写入缓存，至少预热一次 */
+    if (opts.warmup < 1) {
+        for (int i = 0; i < opts.mode_count; i++) {
+            if (opts.modes[i] == MODE_CACHE) opts.warmup = 1;
+        }
+    }
+
+    if (access(opts.glm_cmd, X_OK) != 0 || access(opts.server, X_OK) != 0) {
+        fprintf(stderr, "Error: %s and %s must be built first (make all mock-server)\n",
+                opts.glm_cmd, opts.server);
+        return 1;
+    }
+
+    clear_glm_environment();
+    signal(SIGPIPE, SIG_IGN);
+
+    pid_t server_pid;
+    int port = start_server(&opts, &server_pid);
+    if (port < 0) {
+        fprintf(stderr, "Error: Cannot start %s\n", opts.server);
+        return 1;
+    }
+
+    char root[] = "/tmp/glm-bench-XXXXXX";
+    if (!mkdtemp(root)) {
+        fprintf(stderr, "Error: Cannot create temporary directory\n");
+        kill(server_pid, SIGTERM);
+        waitpid(server_pid, NULL, 0);
+        return 1;
+    }
+
+    /* memory_rounds 为 0 时不加载历史，只测一次（初始历史为 0）；cache 模式只测 memory_rounds 为 0 */
+    ScenarioResult *results = (ScenarioResult *)calloc(
+        (size_t)(opts.mode_count * opts.round_count * opts.history_count), sizeof(ScenarioResult));
+    int result_count = 0;
+    int failures = 0;
+    int rc = results ? 0 : 1;
+
+    printf("bench_e2e: %d runs per scenario after %d warmup, server ttfb %g ms, "
+           "token delay %g ms\n", opts.runs, opts.warmup, opts.ttfb_ms, opts.token_delay_ms);
+    printf("  %-10s %6s %8s  %-23s  %-23s  %-23s  %4s\n", "mode", "rounds", "history",
+           "first token ms", "command ms", "exit ms", "fail");
+    printf("  %-10s %6s %8s  %7s %7s %7s  %7s %7s %7s  %7s %7s %7s\n", "", "", "",
+           "p50", "p95", "p99", "p50", "p95", "p99", "p50", "p95", "p99");
+
+    for (int m = 0; rc == 0 && m < opts.mode_count; m++) {
+        for (int r = 0; rc == 0 && r < opts.round_count; r++) {
+            for (int h = 0; rc == 0 && h < opts.history_count; h++) {
+                if (opts.rounds[r] == 0 && h > 0) break;
+                /* 携带对话历史的查询不使用缓存，cache 模式只测不加载历史的情况 */
+                if (opts.modes[m] == MODE_CACHE && opts.rounds[r] > 0) break;
+
+                ScenarioResult *result = &results[result_count];
+                result->mode = (RunMode)opts.modes[m];
+                result->memory_rounds = opts.rounds[r];
+                result->history_records = opts.rounds[r] == 0 ? 0 : opts.histories[h];
+
+                if (!run_scenario(&opts, root, result_count, port, result)) {
+                    rc = 1;
+                    break;
+                }
+                print_row(result);
+                failures += result->failures;
+                result_count++;
+            }
+        }
+    }
+
+    kill(server_pid, SIGTERM);
+    waitpid(server_pid, NULL, 0);
+    remove_tree(root);
+
+    if (opts.json_path && results && !write_json(&opts, results, result_count)) {
+        fprintf(stderr, "Error: Cannot write %s\n", opts.json_path);
+        rc = 1;
+    }
+    if (failures > 0) {
+        fprintf(stderr, "Error: %d runs failed (run %s --no-daemon manually to see why)\n",
+                failures, opts.glm_cmd);
+        rc = 1;
+    }
+
+    free(results);
+    return rc;
+}
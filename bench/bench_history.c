@@ -0,0 +1,273 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Benchmark: Conversation History Store
+ *
+ * 分别以 10 / 1000 / 100000 轮为窗口测量历史的添加、加载和保存：
+ *   - add：窗口已满后的稳态添加，对比原实现（逐轮前移数组 + 两次 strdup）
+ *     与环形缓冲区 + 连续文本区
+ *   - load / save：history_load / history_save 整个窗口
+ * 另外以 100 轮为窗口，测量日志增长到数百 MB 时的启动加载耗时
+ * （只解析末尾窗口内的记录 vs 原实现逐行解析整个日志）：
+ *     bench/bench_history [scale]
+ * scale 调整添加的次数（默认 1.0；小于 1 时同时缩小生成的日志）。
+ *===========================================================================*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench_util.h"
+#include "alloc_hooks.h"
+#include "history.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 尝试多种可能的 cJSON 头文件路径
+#if __has_include(<cjson/cJSON.h>)
+    #include <cjson/cJSON.h>
+#elif __has_include(<cJSON.h>)
+    #include <cJSON.h>
+#else
+    #include <cjson/cJSON.h>
+#endif
+
+/* 原实现：每轮两个独立分配的字符串，窗口满时整体前移一位 */
+typedef struct {
+    char *user_input;
+    char *assistant_response;
+} LegacyRound;
+
+typedef struct {
+    LegacyRound *rounds;
+    int max_rounds;
+    int current_count;
+} LegacyHistory;
+
+static void legacy_add(LegacyHistory *history, const char *user, const char *assistant) {
+    if (history->current_count >= history->max_rounds) {
+        free(history->rounds[0].user_input);
+        free(history->rounds[0].assistant_response);
+        for (int i = 0; i < history->current_count - 1; i++) {
+            history->rounds[i] = history->rounds[i + 1];
+        }
+        history->current_count--;
+    }
+
+    int index = history->current_count++;
+    history->rounds[index].user_input = strdup(user);
+    history->rounds[index].assistant_response = strdup(assistant);
+}
+
+/* 稳态添加耗时（纳秒/轮） */
+static double run_legacy_add(int rounds, int adds) {
+    LegacyHistory history = { calloc((size_t)rounds, sizeof(LegacyRound)), rounds, 0 };
+    for (int i = 0; i < rounds; i++) {
+        legacy_add(&history, bench_sample_user, bench_sample_assistant);
+    }
+
+    double start = bench_now_ns();
+    for (int i = 0; i < adds; i++) legacy_add(&history, bench_sample_user, bench_sample_assistant);
+    double ns = (bench_now_ns() - start) / adds;
+
+    for (int i = 0; i < history.current_count; i++) {
+        bench_sink += strlen(history.rounds[i].user_input);
+        free(history.rounds[i].user_input);
+        free(history.rounds[i].assistant_response);
+    }
+    free(history.rounds);
+    return ns;
+}
+
+static double run_ring_add(const char *dir, int rounds, int adds) {
+    ConversationHistory *history = history_create(dir, rounds);
+    for (int i = 0; i < rounds; i++) {
+        history_add_round(history, bench_sample_user, bench_sample_assistant);
+    }
+
+    double start = bench_now_ns();
+    for (int i = 0; i < adds; i++) {
+        history_add_round(history, bench_sample_user, bench_sample_assistant);
+    }
+    double ns = (bench_now_ns() - start) / adds;
+
+    for (int i = 0; i < history->current_count; i++) {
+        bench_sink += history_round(history, i)->user_len;
+    }
+    history_destroy(history);
+    return ns;
+}
+
+/* 原实现：逐行解析整个日志（只计时解析，不构建历史） */
+static double run_full_parse(const char *path) {
+    size_t len;
+    double start = bench_now_ns();
+    char *data = bench_read_file(path, &len);
+    if (!data) return -1;
+
+    const char *line = data;
+    const char *end = data + len;
+    while (line < end) {
+        const char *newline = (const char *)memchr(line, '\n', (size_t)(end - line));
+        const char *line_end = newline ? newline : end;
+        cJSON *record = cJSON_ParseWithLength(line, (size_t)(line_end - line));
+        if (record) {
+            bench_sink += (size_t)cJSON_GetArraySize(record);
+            cJSON_Delete(record);
+        }
+        if (!newline) break;
+        line = newline + 1;
+    }
+
+    free(data);
+    return (bench_now_ns() - start) / 1e6;
+}
+
+/* 生成 records 条记录的日志（每条与 format_record 的输出格式相同） */
+static bool write_log(const char *dir, const char *path, long long records) {
+    /* 借助 history_save 得到一条记录的序列化结果，去掉开头的 {"seq":0 */
+    ConversationHistory *history = history_create(dir, 1);
+    history_add_round(history, bench_sample_user, bench_sample_assistant);
+    bool ok = history_save(history, NULL);
+    history_destroy(history);
+    if (!ok) return false;
+
+    size_t len;
+    char *line = bench_read_file(path, &len);
+    if (!line) return false;
+    const char *body = strchr(line, ',');
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp || !body) {
+        if (fp) fclose(fp);
+        free(line);
+        return false;
+    }
+    for (long long i = 0; i < records; i++) {
+        fprintf(fp, "{\"seq\":%lld%s", i, body);
+    }
+    fclose(fp);
+    free(line);
+    return true;
+}
+
+static int run_growth(const char *dir, const char *path, double scale) {
+    static const long long record_counts[] = { 1000, 100000, 1000000 };
+    const int window = 100;
+
+    printf("\n  startup load, %d-round window, growing log\n", window);
+    printf("  %9s %9s %13s %13s %8s\n", "records", "file MB", "full parse ms",
+           "tail load ms", "speedup");
+
+    for (size_t r = 0; r < sizeof(record_counts) / sizeof(record_counts[0]); r++) {
+        long long records = (long long)(record_counts[r] * (scale < 1.0 ? scale : 1.0));
+        if (records < window) records = window;
+
+        if (!write_log(dir, path, records)) {
+            fprintf(stderr, "Error: Failed to write %s\n", path);
+            return 1;
+        }
+
+        size_t file_len = 0;
+        FILE *fp = fopen(path, "rb");
+        if (fp) {
+            fseek(fp, 0, SEEK_END);
+            file_len = (size_t)ftell(fp);
+            fclose(fp);
+        }
+
+        double full_ms = run_full_parse(path);
+
+        ConversationHistory *history = history_create(dir, window);
+        double start = bench_now_ns();
+        history_load(history);
+        double tail_ms = (bench_now_ns() - start) / 1e6;
+        bench_sink += (size_t)history->current_count;
+        history_destroy(history);
+
+        printf("  %9lld %9.1f %13.2f %13.3f %7.0fx\n", records, file_len / 1048576.0,
+               full_ms, tail_ms, full_ms / tail_ms);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    double scale = argc > 1 ? atof(argv[1]) : 1.0;
+    if (scale <= 0) scale = 1.0;
+
+    static const int round_counts[] = { 10, 1000, 100000 };
+
+    char dir[] = "/tmp/glm-bench-XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "Error: Cannot create temporary directory\n");
+        return 1;
+    }
+    char history_path[96];
+    snprintf(history_path, sizeof(history_path), "%s/history.jsonl", dir);
+
+    printf("bench_history: conversation history store (legacy array vs ring buffer)\n");
+    if (!ALLOC_COUNTING) {
+        printf("  (allocation counting requires glibc; allocs below are zero)\n");
+    }
+    printf("  %7s %11s %11s %8s %9s %11s %11s %9s\n", "rounds", "legacy add",
+           "ring add", "speedup", "file MB", "load ms", "save ms", "load");
+    printf("  %7s %11s %11s %8s %9s %11s %11s %9s\n", "", "ns", "ns", "", "", "", "",
+           "allocs");
+
+    for (size_t r = 0; r < sizeof(round_counts) / sizeof(round_counts[0]); r++) {
+        int rounds = round_counts[r];
+
+        /* 原实现每次添加都要前移整个窗口，大窗口时减少添加次数 */
+        int adds = (int)(200000.0 * scale / (rounds < 1000 ? 1 : rounds / 1000));
+        if (adds < 100) adds = 100;
+
+        double legacy_ns = run_legacy_add(rounds, adds);
+        double ring_ns = run_ring_add(dir, rounds, adds);
+
+        /* 保存一个完整窗口，再从文件加载 */
+        ConversationHistory *history = history_create(dir, rounds);
+        for (int i = 0; i < rounds; i++) {
+            history_add_round(history, bench_sample_user, bench_sample_assistant);
+        }
+
+        double start = bench_now_ns();
+        bool saved = history_save(history, NULL);
+        double save_ms = (bench_now_ns() - start) / 1e6;
+        history_destroy(history);
+
+        if (!saved) {
+            fprintf(stderr, "Error: Failed to save history to %s\n", history_path);
+            return 1;
+        }
+
+        size_t file_len = 0;
+        FILE *fp = fopen(history_path, "rb");
+        if (fp) {
+            fseek(fp, 0, SEEK_END);
+            file_len = (size_t)ftell(fp);
+            fclose(fp);
+        }
+
+        history = history_create(dir, rounds);
+        size_t allocs = alloc_stats.mallocs + alloc_stats.reallocs;
+        start = bench_now_ns();
+        history_load(history);
+        double load_ms = (bench_now_ns() - start) / 1e6;
+        allocs = alloc_stats.mallocs + alloc_stats.reallocs - allocs;
+
+        if (history->current_count != rounds) {
+            fprintf(stderr, "Error: Loaded %d of %d rounds\n", history->current_count, rounds);
+            return 1;
+        }
+        history_destroy(history);
+
+        printf("  %7d %11.1f %11.1f %7.1fx %9.2f %11.3f %11.3f %9zu\n", rounds,
+               legacy_ns, ring_ns, legacy_ns / ring_ns, file_len / 1048576.0,
+               load_ms, save_ms, allocs);
+    }
+
+    int rc = run_growth(dir, history_path, scale);
+
+    remove(history_path);
+    rmdir(dir);
+    return rc;
+}
@@ -0,0 +1,605 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Benchmark: Client Hot Paths
+ *
+ * 对客户端的热点路径分别计时，每个用例先预热，再采集多个样本并报告百分位：
+ *   - sse_decode：SSE 分帧 + delta 提取 + 命令块提取（与 handle_sse_event 相同），
+ *     录制的流按 64 / 1460 / 16384 字节分块输入
+ *   - stream_request：api_send_request_stream 完整处理一次流式响应
+ *     （stream_write_callback，响应由 file:// 端点提供，不需要网络）
+ *   - cmd_extract：流式逐片段提取 / 从完整回答中提取命令
+ *   - request_body：构建流式请求体，0 / 5 / 50 / 500 轮历史
+ *   - history_load / history_save：10 / 100 / 1000 轮的历史文件
+ *   - json_escape：JsonWriter 转义 4 KiB 的 ASCII / 中英文混合文本
+ *   - config_file_read：解析完整的 config.ini
+ * 默认输出表格；--json FILE 同时把结果写成 JSON（"-" 为标准输出），便于对比两次构建：
+ *     bench/bench_hotpaths [--json FILE] [scale]
+ * scale 调整每个用例的样本数（默认 1.0）。
+ *===========================================================================*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench_util.h"
+#include "api.h"
+#include "client.h"
+#include "cmd_extract.h"
+#include "config_parser.h"
+#include "delta.h"
+#include "history.h"
+#include "json_writer.h"
+#include "sse.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define DEFAULT_STREAM "bench/data/glm-4.7-stream.sse"
+#define DEFAULT_SAMPLES 200
+#define WARMUP_SAMPLES 20
+#define MIN_SAMPLE_NS 50000.0   /* 单个样本至少持续 50 us，过短的操作在一个样本内重复多次 */
+#define MAX_RESULTS 32
+
+static const char sample_config[] =
+    "# GLM-CMD 配置\n"
+    "api_key=\"0123456789abcdef0123456789abcdef.0123456789abcdef\"\n"
+    "endpoint=\"https://open.bigmodel.cn/api/coding/paas/v4\"\n"
+    "model=\"glm-4.7\"\n"
+    "user_prompt=\"请用最简洁的命令\"\n"
+    "memory_enabled=true\n"
+    "memory_rounds=5\n"
+    "stream_enabled=true\n"
+    "stop_after_command=false\n"
+    "thinking=\"enabled\"\n"
+    "cache_enabled=true\n"
+    "cache_ttl=604800\n"
+    "cache_max_entries=1000\n"
+    "cache_similarity=0.7\n"
+    "cache_background_refresh=false\n"
+    "temperature=0.7\n"
+    "max_tokens=8192\n"
+    "timeout=30\n";
+
+typedef void (*BenchFn)(void *ctx);
+
+typedef struct {
+    char name[32];
+    char params[32];
+    size_t bytes;           /* 每次操作处理的字节数（0 表示不计算吞吐量） */
+    int batch;              /* 每个样本重复的次数 */
+    BenchStats stats;
+} BenchResult;
+
+static BenchResult results[MAX_RESULTS];
+static int result_count;
+static int sample_count = DEFAULT_SAMPLES;
+static FILE *table;         /* 表格输出 */
+
+/* 预热并确定每个样本的重复次数，然后采集 sample_count 个样本 */
+static void bench_run(const char *name, const char *params, size_t bytes, BenchFn fn, void *ctx) {
+    if (result_count >= MAX_RESULTS) return;
+
+    int batch = 1;
+    for (int i = 0; i < WARMUP_SAMPLES; i++) {
+        double start = bench_now_ns();
+        for (int j = 0; j < batch; j++) fn(ctx);
+        double elapsed = bench_now_ns() - start;
+        if (elapsed < MIN_SAMPLE_NS && batch < (1 << 20)) {
+            batch *= elapsed > 0 ? (int)(MIN_SAMPLE_NS / elapsed) + 1 : 2;
+        }
+    }
+
+    double *samples = (double *)malloc((size_t)sample_count * sizeof(double));
+    if (!samples) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    for (int i = 0; i < sample_count; i++) {
+        double start = bench_now_ns();
+        for (int j = 0; j < batch; j++) fn(ctx);
+        samples[i] = (bench_now_ns() - start) / batch;
+    }
+
+    BenchResult *result = &results[result_count++];
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    snprintf(result->params, sizeof(result->params), "%s", params);
+    result->bytes = bytes;
+    result->batch = batch;
+    result->stats = bench_stats(samples, sample_count);
+    free(samples);
+
+    fprintf(table, "  %-18s %-12s %10.2f %10.2f %10.2f %10.2f", result->name, result->params,
+            result->stats.p50 / 1e3, result->stats.p90 / 1e3, result->stats.p99 / 1e3,
+            result->stats.max / 1e3);
+    if (bytes > 0) {
+        fprintf(table, " %9.1f", (double)bytes / result->stats.p50 * 1e3);
+    }
+    fprintf(table, "\n");
+    fflush(table);
+}
+
+/*----------------------------------------------------------------------------
+ * SSE 解码
+ *--------------------------------------------------------------------------*/
+
+typedef struct {
+    const char *stream;
+    size_t stream_len;
+    size_t chunk;
+    DeltaExtractor delta;
+    CommandExtractor commands;
+    size_t text_bytes;
+} SseContext;
+
+/* 与 handle_sse_event 的快速路径相同：提取 delta，回答片段交给命令块提取器 */
+static void decode_event(const char *event, const char *data, size_t data_len, void *userdata) {
+    SseContext *ctx = (SseContext *)userdata;
+    (void)event;
+
+    if (data_len >= 6 && strncmp(data, "[DONE]", 6) == 0) return;
+
+    DeltaEvent delta_event;
+    if (!delta_extract(&ctx->delta, data, data_len, &delta_event)) return;
+
+    ctx->text_bytes += delta_event.reasoning_len + delta_event.content_len;
+    if (delta_event.content_len > 0) {
+        cmd_extractor_feed(&ctx->commands, delta_event.content, delta_event.content_len);
+    }
+}
+
+static void run_sse_decode(void *arg) {
+    SseContext *ctx = (SseContext *)arg;
+    Arena *arena = arena_create(0);
+
+    SseParser parser;
+    sse_parser_init(&parser, arena, decode_event, ctx);
+    delta_extractor_init(&ctx->delta, arena);
+    cmd_extractor_init(&ctx->commands, arena);
+
+    for (size_t pos = 0; pos < ctx->stream_len; pos += ctx->chunk) {
+        size_t len = ctx->stream_len - pos < ctx->chunk ? ctx->stream_len - pos : ctx->chunk;
+        sse_parser_feed(&parser, ctx->stream + pos, len);
+    }
+    sse_parser_finish(&parser);
+    cmd_extractor_finish(&ctx->commands);
+    bench_sink += ctx->text_bytes;
+
+    sse_parser_free(&parser);
+    arena_destroy(arena);
+}
+
+/* 收集回答片段，供命令提取用例使用 */
+typedef struct {
+    DeltaExtractor delta;
+    char **pieces;
+    size_t *lens;
+    size_t count;
+    size_t capacity;
+} AnswerPieces;
+
+static void collect_answer(const char *event, const char *data, size_t data_len, void *userdata) {
+    AnswerPieces *answer = (AnswerPieces *)userdata;
+    (void)event;
+
+    DeltaEvent delta_event;
+    if (!delta_extract(&answer->delta, data, data_len, &delta_event) ||
+        delta_event.content_len == 0) {
+        return;
+    }
+
+    if (answer->count >= answer->capacity) {
+        answer->capacity = answer->capacity ? answer->capacity * 2 : 256;
+        answer->pieces = (char **)realloc(answer->pieces, answer->capacity * sizeof(char *));
+        answer->lens = (size_t *)realloc(answer->lens, answer->capacity * sizeof(size_t));
+        if (!answer->pieces || !answer->lens) {
+            fprintf(stderr, "Error: Out of memory\n");
+            exit(1);
+        }
+    }
+    answer->pieces[answer->count] = strndup(delta_event.content, delta_event.content_len);
+    answer->lens[answer->count] = delta_event.content_len;
+    answer->count++;
+}
+
+/*----------------------------------------------------------------------------
+ * 流式请求（stream_write_callback）
+ *--------------------------------------------------------------------------*/
+
+typedef struct {
+    GlmClient *client;
+    Config *cfg;
+    ConversationHistory *history;
+} StreamRequestContext;
+
+static void discard_callback(const char *content, StreamContentType content_type, void *userdata) {
+    (void)content_type;
+    (void)userdata;
+    bench_sink += strlen(content);
+}
+
+static void run_stream_request(void *arg) {
+    StreamRequestContext *ctx = (StreamRequestContext *)arg;
+    ApiResponse *response = api_response_create();
+    if (!response) return;
+
+    if (!api_send_request_stream(ctx->client, ctx->cfg, NULL, ctx->history,
+                                 "查看当前目录下各子目录的磁盘占用", discard_callback, NULL,
+                                 response) || !response->command) {
+        fprintf(stderr, "Error: Stream request against %s failed\n", ctx->cfg->endpoint);
+        exit(1);
+    }
+    bench_sink += strlen(response->command);
+    api_response_destroy(response);
+}
+
+/*----------------------------------------------------------------------------
+ * 命令提取
+ *--------------------------------------------------------------------------*/
+
+typedef struct {
+    const AnswerPieces *answer;
+    const char *text;
+} CommandContext;
+
+static void run_cmd_extract_stream(void *arg) {
+    const AnswerPieces *answer = ((CommandContext *)arg)->answer;
+    CommandExtractor extractor;
+    cmd_extractor_init(&extractor, NULL);
+    for (size_t i = 0; i < answer->count; i++) {
+        cmd_extractor_feed(&extractor, answer->pieces[i], answer->lens[i]);
+    }
+    cmd_extractor_finish(&extractor);
+    char *command = cmd_extractor_take(&extractor);
+    bench_sink += command ? strlen(command) : 0;
+    free(command);
+    cmd_extractor_free(&extractor);
+}
+
+static void run_cmd_extract_text(void *arg) {
+    char *command = cmd_extract_from_text(NULL, ((CommandContext *)arg)->text);
+    bench_sink += command ? strlen(command) : 0;
+    free(command);
+}
+
+/*----------------------------------------------------------------------------
+ * 请求体构建、历史、JSON 转义和配置文件
+ *--------------------------------------------------------------------------*/
+
+typedef struct {
+    Config *cfg;
+    ConversationHistory *history;
+} RequestContext;
+
+static void run_request_body(void *arg) {
+    RequestContext *ctx = (RequestContext *)arg;
+    RequestOptions options = { .stream = true };
+
+    /* 每次构建使用新的 arena，与实际请求的生命周期一致 */
+    Arena *arena = arena_create(0);
+    char *body = build_request_body(arena, ctx->cfg, NULL, ctx->history, "列出所有文件", &options);
+    bench_sink += body ? (size_t)body[0] : 0;
+    arena_destroy(arena);
+}
+
+typedef struct {
+    const char *dir;
+    int rounds;
+    ConversationHistory *history;
+} HistoryContext;
+
+static void run_history_load(void *arg) {
+    HistoryContext *ctx = (HistoryContext *)arg;
+    ConversationHistory *history = history_create(ctx->dir, ctx->rounds);
+    if (!history || !history_load(history) || history->current_count != ctx->rounds) {
+        fprintf(stderr, "Error: Failed to load %d rounds of history\n", ctx->rounds);
+        exit(1);
+    }
+    history_destroy(history);
+}
+
+static void run_history_save(void *arg) {
+    HistoryContext *ctx = (HistoryContext *)arg;
+    if (!history_save(ctx->history, NULL)) {
+        fprintf(stderr, "Error: Failed to save %d rounds of history\n", ctx->rounds);
+        exit(1);
+    }
+}
+
+static void run_json_escape(void *arg) {
+    const char *text = (const char *)arg;
+    JsonWriter writer;
+    json_writer_init(&writer, NULL, strlen(text) * 2 + 16);
+    json_writer_string(&writer, text);
+    size_t len = 0;
+    char *json = json_writer_finish(&writer, &len);
+    bench_sink += len;
+    free(json);
+}
+
+static void run_config_file_read(void *arg) {
+    ConfigFile *file_cfg = config_file_create();
+    if (!file_cfg || !config_file_read((const char *)arg, file_cfg)) {
+        fprintf(stderr, "Error: Failed to read %s\n", (const char *)arg);
+        exit(1);
+    }
+    bench_sink += file_cfg->api_key ? strlen(file_cfg->api_key) : 0;
+    config_file_destroy(file_cfg);
+}
+
+/* 重复 unit 直到至少 size 字节 */
+static char* repeat_text(const char *unit, size_t size) {
+    size_t unit_len = strlen(unit);
+    size_t count = (size + unit_len - 1) / unit_len;
+    char *text = (char *)malloc(count * unit_len + 1);
+    if (!text) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < count; i++) memcpy(text + i * unit_len, unit, unit_len);
+    text[count * unit_len] = '\0';
+    return text;
+}
+
+static size_t file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+static bool write_file(const char *path, const char *data, size_t len) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) return false;
+    bool ok = fwrite(data, 1, len, fp) == len;
+    return fclose(fp) == 0 && ok;
+}
+
+/*----------------------------------------------------------------------------
+ * JSON 输出
+ *--------------------------------------------------------------------------*/
+
+static bool write_json(const char *path, const char *stream_path, double scale) {
+    JsonWriter writer;
+    json_writer_init(&writer, NULL, 4096);
+    json_writer_begin_object(&writer);
+    json_writer_key(&writer, "benchmark");
+    json_writer_string(&writer, "bench_hotpaths");
+    json_writer_key(&writer, "compiler");
+#ifdef __VERSION__
+    json_writer_string(&writer, __VERSION__);
+#else
+    json_writer_null(&writer);
+#endif
+    json_writer_key(&writer, "stream");
+    json_writer_string(&writer, stream_path);
+    json_writer_key(&writer, "scale");
+    json_writer_double(&writer, scale);
+    json_writer_key(&writer, "warmup_samples");
+    json_writer_int(&writer, WARMUP_SAMPLES);
+    json_writer_key(&writer, "unit");
+    json_writer_string(&writer, "ns");
+
+    json_writer_key(&writer, "results");
+    json_writer_begin_array(&writer);
+    for (int i = 0; i < result_count; i++) {
+        const BenchResult *result = &results[i];
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "name");
+        json_writer_string(&writer, result->name);
+        json_writer_key(&writer, "params");
+        json_writer_string(&writer, result->params);
+        json_writer_key(&writer, "bytes");
+        json_writer_int(&writer, (long long)result->bytes);
+        json_writer_key(&writer, "samples");
+        json_writer_int(&writer, result->stats.count);
+        json_writer_key(&writer, "batch");
+        json_writer_int(&writer, result->batch);
+        json_writer_key(&writer, "min");
+        json_writer_double(&writer, result->stats.min);
+        json_writer_key(&writer, "mean");
+        json_writer_double(&writer, result->stats.mean);
+        json_writer_key(&writer, "p50");
+        json_writer_double(&writer, result->stats.p50);
+        json_writer_key(&writer, "p90");
+        json_writer_double(&writer, result->stats.p90);
+        json_writer_key(&writer, "p95");
+        json_writer_double(&writer, result->stats.p95);
+        json_writer_key(&writer, "p99");
+        json_writer_double(&writer, result->stats.p99);
+        json_writer_key(&writer, "max");
+        json_writer_double(&writer, result->stats.max);
+        json_writer_end_object(&writer);
+    }
+    json_writer_end_array(&writer);
+    json_writer_end_object(&writer);
+
+    size_t len = 0;
+    char *json = json_writer_finish(&writer, &len);
+    if (!json) return false;
+
+    bool ok;
+    if (strcmp(path, "-") == 0) {
+        ok = fwrite(json, 1, len, stdout) == len && putchar('\n') != EOF;
+    } else {
+        FILE *fp = fopen(path, "wb");
+        ok = fp && fwrite(json, 1, len, fp) == len && fputc('\n', fp) != EOF;
+        if (fp && fclose(fp) != 0) ok = false;
+    }
+    free(json);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    const char *json_path = NULL;
+    double scale = 1.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            scale = atof(argv[i]);
+        }
+    }
+    if (scale <= 0) scale = 1.0;
+    sample_count = (int)(DEFAULT_SAMPLES * scale);
+    if (sample_count < 10) sample_count = 10;
+
+    /* JSON 写到标准输出时，表格改写到标准错误 */
+    table = json_path && strcmp(json_path, "-") == 0 ? stderr : stdout;
+
+    size_t stream_len;
+    char *stream = bench_read_file(DEFAULT_STREAM, &stream_len);
+    if (!stream) return 1;
+
+    char dir[] = "/tmp/glm-bench-XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "Error: Cannot create temporary directory\n");
+        free(stream);
+        return 1;
+    }
+    char chat_dir[64], response_path[96], history_path[96], lock_path[96], config_path[96];
+    char endpoint[80];
+    snprintf(chat_dir, sizeof(chat_dir), "%s/chat", dir);
+    snprintf(response_path, sizeof(response_path), "%s/completions", chat_dir);
+    snprintf(history_path, sizeof(history_path), "%s/history.jsonl", dir);
+    snprintf(lock_path, sizeof(lock_path), "%s/history.lock", dir);
+    snprintf(config_path, sizeof(config_path), "%s/config.ini", dir);
+    snprintf(endpoint, sizeof(endpoint), "file://%s", dir);
+    mkdir(chat_dir, 0755);
+
+    if (!write_file(response_path, stream, stream_len) ||
+        !write_file(config_path, sample_config, strlen(sample_config))) {
+        fprintf(stderr, "Error: Cannot write benchmark files in %s\n", dir);
+        return 1;
+    }
+
+    fprintf(table, "bench_hotpaths: %d samples per case after %d warmup samples\n",
+           sample_count, WARMUP_SAMPLES);
+    fprintf(table, "  %-18s %-12s %10s %10s %10s %10s %9s\n", "case", "params",
+           "p50 us", "p90 us", "p99 us", "max us", "MB/s");
+
+    /* SSE 解码 */
+    static const size_t chunk_sizes[] = { 64, 1460, 16384 };
+    SseContext sse = { stream, stream_len, 0, {0}, {0}, 0 };
+    for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++) {
+        char params[32];
+        snprintf(params, sizeof(params), "chunk=%zu", chunk_sizes[i]);
+        sse.chunk = chunk_sizes[i];
+        bench_run("sse_decode", params, stream_len, run_sse_decode, &sse);
+    }
+
+    /* 流式请求 */
+    StreamRequestContext request_ctx = {0};
+    request_ctx.cfg = config_create();
+    request_ctx.cfg->api_key = strdup("bench-key");
+    free(request_ctx.cfg->endpoint);
+    request_ctx.cfg->endpoint = strdup(endpoint);
+    request_ctx.cfg->stream_enabled = true;
+    request_ctx.history = history_create(dir, 5);
+    request_ctx.client = client_create();
+    if (!request_ctx.history || !request_ctx.client) {
+        fprintf(stderr, "Error: Failed to create client\n");
+        return 1;
+    }
+    for (int i = 0; i < 5; i++) {
+        history_add_round(request_ctx.history, bench_sample_user, bench_sample_assistant);
+    }
+    bench_run("stream_request", "rounds=5", stream_len, run_stream_request, &request_ctx);
+    client_destroy(request_ctx.client);
+    history_destroy(request_ctx.history);
+
+    /* 命令提取 */
+    AnswerPieces answer = {0};
+    SseParser parser;
+    delta_extractor_init(&answer.delta, NULL);
+    sse_parser_init(&parser, NULL, collect_answer, &answer);
+    sse_parser_feed(&parser, stream, stream_len);
+    sse_parser_finish(&parser);
+    sse_parser_free(&parser);
+    delta_extractor_free(&answer.delta);
+
+    size_t answer_len = 0;
+    for (size_t i = 0; i < answer.count; i++) answer_len += answer.lens[i];
+    char *answer_text = (char *)malloc(answer_len + 1);
+    if (!answer_text) return 1;
+    for (size_t i = 0, pos = 0; i < answer.count; pos += answer.lens[i], i++) {
+        memcpy(answer_text + pos, answer.pieces[i], answer.lens[i]);
+    }
+    answer_text[answer_len] = '\0';
+
+    CommandContext command_ctx = { &answer, answer_text };
+    bench_run("cmd_extract", "stream", answer_len, run_cmd_extract_stream, &command_ctx);
+    bench_run("cmd_extract", "text", answer_len, run_cmd_extract_text, &command_ctx);
+
+    /* 请求体构建 */
+    static const int body_rounds[] = { 0, 5, 50, 500 };
+    for (size_t i = 0; i < sizeof(body_rounds) / sizeof(body_rounds[0]); i++) {
+        int rounds = body_rounds[i];
+        RequestContext body_ctx = { request_ctx.cfg, history_create(dir, rounds > 0 ? rounds : 1) };
+        for (int j = 0; j < rounds; j++) {
+            history_add_round(body_ctx.history, bench_sample_user, bench_sample_assistant);
+        }
+
+        RequestOptions options = { .stream = true };
+        char *body = build_request_body(NULL, body_ctx.cfg, NULL, body_ctx.history,
+                                        "列出所有文件", &options);
+        size_t body_len = body ? strlen(body) : 0;
+        free(body);
+
+        char params[32];
+        snprintf(params, sizeof(params), "rounds=%d", rounds);
+        bench_run("request_body", params, body_len, run_request_body, &body_ctx);
+        history_destroy(body_ctx.history);
+    }
+
+    /* 历史加载和保存 */
+    static const int history_rounds[] = { 10, 100, 1000 };
+    for (size_t i = 0; i < sizeof(history_rounds) / sizeof(history_rounds[0]); i++) {
+        int rounds = history_rounds[i];
+        HistoryContext history_ctx = { dir, rounds, history_create(dir, rounds) };
+        for (int j = 0; j < rounds; j++) {
+            history_add_round(history_ctx.history, bench_sample_user, bench_sample_assistant);
+        }
+        if (!history_save(history_ctx.history, NULL)) {
+            fprintf(stderr, "Error: Failed to save history to %s\n", history_path);
+            return 1;
+        }
+
+        char params[32];
+        snprintf(params, sizeof(params), "rounds=%d", rounds);
+        size_t history_len = file_size(history_path);
+        bench_run("history_load", params, history_len, run_history_load, &history_ctx);
+        bench_run("history_save", params, history_len, run_history_save, &history_ctx);
+        history_destroy(history_ctx.history);
+    }
+
+    /* JSON 转义 */
+    char *ascii_text = repeat_text("find . -type f -name \"*.log\" -size +100M | sort -rh\n", 4096);
+    char *mixed_text = repeat_text(bench_sample_assistant, 4096);
+    bench_run("json_escape", "ascii_4k", strlen(ascii_text), run_json_escape, ascii_text);
+    bench_run("json_escape", "mixed_4k", strlen(mixed_text), run_json_escape, mixed_text);
+
+    /* 配置文件 */
+    bench_run("config_file_read", "full", strlen(sample_config), run_config_file_read, config_path);
+
+    int rc = 0;
+    if (json_path && !write_json(json_path, DEFAULT_STREAM, scale)) {
+        fprintf(stderr, "Error: Cannot write %s\n", json_path);
+        rc = 1;
+    }
+
+    for (size_t i = 0; i < answer.count; i++) free(answer.pieces[i]);
+    free(answer.pieces);
+    free(answer.lens);
+    free(answer_text);
+    free(ascii_text);
+    free(mixed_text);
+    free(stream);
+    config_destroy(request_ctx.cfg);
+
+    remove(history_path);
+    remove(lock_path);
+    remove(config_path);
+    remove(response_path);
+    rmdir(chat_dir);
+    rmdir(dir);
+    return rc;
+}
@@ -0,0 +1,197 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Benchmark: Request Body Serialization
+ *
+ * 对比构建 cJSON 树再 cJSON_PrintUnformatted（原实现）与 JsonWriter
+ * 直接写入 arena 的请求体构建耗时和峰值内存，分别使用 5 / 50 / 500 轮历史：
+ *     bench/bench_request [scale]
+ * scale 调整迭代次数（默认 1.0）。
+ *===========================================================================*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench_util.h"
+#include "alloc_hooks.h"
+#include "api.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 尝试多种可能的 cJSON 头文件路径
+#if __has_include(<cjson/cJSON.h>)
+    #include <cjson/cJSON.h>
+#elif __has_include(<cJSON.h>)
+    #include <cJSON.h>
+#else
+    #include <cjson/cJSON.h>
+#endif
+
+/* 原实现：构建 cJSON 树后整体打印 */
+static char* build_with_cjson(const Config *cfg, const ConversationHistory *history,
+                              const char *user_input) {
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "model", cfg->model);
+
+    cJSON *messages = cJSON_CreateArray();
+    cJSON *system_msg = cJSON_CreateObject();
+    cJSON_AddStringToObject(system_msg, "role", "system");
+    char *system_prompt = build_system_prompt(NULL, NULL);
+    cJSON_AddStringToObject(system_msg, "content", system_prompt);
+    cJSON_AddItemToArray(messages, system_msg);
+
+    for (int i = 0; i < history->current_count; i++) {
+        cJSON *hist_user_msg = cJSON_CreateObject();
+        cJSON_AddStringToObject(hist_user_msg, "role", "user");
+        cJSON_AddStringToObject(hist_user_msg, "content", history_user(history, i));
+        cJSON_AddItemToArray(messages, hist_user_msg);
+
+        cJSON *hist_assist_msg = cJSON_CreateObject();
+        cJSON_AddStringToObject(hist_assist_msg, "role", "assistant");
+        cJSON_AddStringToObject(hist_assist_msg, "content", history_assistant(history, i));
+        cJSON_AddItemToArray(messages, hist_assist_msg);
+    }
+
+    cJSON *user_msg = cJSON_CreateObject();
+    cJSON_AddStringToObject(user_msg, "role", "user");
+    cJSON_AddStringToObject(user_msg, "content", user_input);
+    cJSON_AddItemToArray(messages, user_msg);
+    cJSON_AddItemToObject(json, "messages", messages);
+
+    cJSON_AddNumberToObject(json, "temperature", cfg->temperature);
+    cJSON_AddNumberToObject(json, "max_tokens", cfg->max_tokens);
+    cJSON_AddBoolToObject(json, "stream", true);
+
+    char *json_string = cJSON_PrintUnformatted(json);
+    free(system_prompt);
+    cJSON_Delete(json);
+    return json_string;
+}
+
+/* 新实现：JsonWriter 写入请求级 arena */
+static char* build_with_writer(Arena *arena, const Config *cfg,
+                               const ConversationHistory *history, const char *user_input) {
+    RequestOptions options = { .stream = true };
+    return build_request_body(arena, cfg, NULL, history, user_input, &options);
+}
+
+typedef struct {
+    double ns;          /* 单次构建耗时 */
+    size_t peak;        /* 单次构建的峰值内存（相对构建前） */
+    size_t allocs;      /* 单次构建的分配次数 */
+    size_t body_len;
+} BuildResult;
+
+static BuildResult run_cjson(const Config *cfg, const ConversationHistory *history,
+                             int iterations) {
+    BuildResult result = {0};
+
+    /* 单独测量一次的峰值与分配次数 */
+    alloc_stats_reset_peak();
+    size_t base = alloc_stats.live;
+    size_t allocs = alloc_stats.mallocs + alloc_stats.reallocs;
+    char *body = build_with_cjson(cfg, history, "列出所有文件");
+    result.peak = alloc_stats.peak - base;
+    result.allocs = alloc_stats.mallocs + alloc_stats.reallocs - allocs;
+    result.body_len = body ? strlen(body) : 0;
+    free(body);
+
+    double start = bench_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        body = build_with_cjson(cfg, history, "列出所有文件");
+        bench_sink += body[0];
+        free(body);
+    }
+    result.ns = (bench_now_ns() - start) / iterations;
+    return result;
+}
+
+static BuildResult run_writer(const Config *cfg, const ConversationHistory *history,
+                              int iterations) {
+    BuildResult result = {0};
+
+    /* 每次构建使用新的 arena，与实际请求的生命周期一致 */
+    alloc_stats_reset_peak();
+    size_t base = alloc_stats.live;
+    size_t allocs = alloc_stats.mallocs + alloc_stats.reallocs;
+    Arena *arena = arena_create(0);
+    char *body = build_with_writer(arena, cfg, history, "列出所有文件");
+    result.peak = alloc_stats.peak - base;
+    result.allocs = alloc_stats.mallocs + alloc_stats.reallocs - allocs;
+    result.body_len = body ? strlen(body) : 0;
+    arena_destroy(arena);
+
+    double start = bench_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        arena = arena_create(0);
+        body = build_with_writer(arena, cfg, history, "列出所有文件");
+        bench_sink += body[0];
+        arena_destroy(arena);
+    }
+    result.ns = (bench_now_ns() - start) / iterations;
+    return result;
+}
+
+/* 两种实现的输出必须完全一致 */
+static int verify(const Config *cfg, const ConversationHistory *history) {
+    char *expected = build_with_cjson(cfg, history, "列出所有文件");
+    char *actual = build_with_writer(NULL, cfg, history, "列出所有文件");
+
+    int ok = expected && actual && strcmp(expected, actual) == 0;
+    free(expected);
+    free(actual);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    double scale = argc > 1 ? atof(argv[1]) : 1.0;
+    if (scale <= 0) scale = 1.0;
+
+    static const int round_counts[] = { 5, 50, 500 };
+
+    Config *cfg = config_create();
+    if (!cfg) return 1;
+
+    printf("bench_request: request body serialization (cJSON tree vs JsonWriter)\n");
+    if (!ALLOC_COUNTING) {
+        printf("  (memory counting requires glibc; peak and allocs below are zero)\n");
+    }
+    printf("  %6s %9s %11s %11s %8s %11s %11s %8s %8s\n", "rounds", "body KB",
+           "cJSON us", "writer us", "speedup", "cJSON peak", "writer peak",
+           "cJSON", "writer");
+    printf("  %6s %9s %11s %11s %8s %11s %11s %8s %8s\n", "", "",
+           "", "", "", "KB", "KB", "allocs", "allocs");
+
+    for (size_t r = 0; r < sizeof(round_counts) / sizeof(round_counts[0]); r++) {
+        int rounds = round_counts[r];
+        ConversationHistory *history = history_create("/tmp", rounds);
+        if (!history) return 1;
+        for (int i = 0; i < rounds; i++) {
+            history_add_round(history, bench_sample_user, bench_sample_assistant);
+        }
+
+        if (!verify(cfg, history)) {
+            fprintf(stderr, "Error: JsonWriter output differs from cJSON (%d rounds)\n", rounds);
+            return 1;
+        }
+
+        int iterations = (int)(20000.0 * scale / (rounds + 5));
+        if (iterations < 3) iterations = 3;
+
+        /* 预热 */
+        run_cjson(cfg, history, 1);
+        run_writer(cfg, history, 1);
+
+        BuildResult cjson = run_cjson(cfg, history, iterations);
+        BuildResult writer = run_writer(cfg, history, iterations);
+
+        printf("  %6d %9.1f %11.1f %11.1f %7.2fx %11.1f %11.1f %8zu %8zu\n", rounds,
+               cjson.body_len / 1024.0, cjson.ns / 1e3, writer.ns / 1e3,
+               cjson.ns / writer.ns, cjson.peak / 1024.0, writer.peak / 1024.0,
+               cjson.allocs, writer.allocs);
+
+        history_destroy(history);
+    }
+
+    config_destroy(cfg);
+    return 0;
+}
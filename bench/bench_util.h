@@ -0,0 +1,103 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Benchmark Utilities
+ *===========================================================================*/
+
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* 单调时钟（纳秒） */
+static inline double bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* 读取整个文件（调用者负责释放），失败时返回 NULL */
+static inline char* bench_read_file(const char *path, size_t *len) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open %s\n", path);
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char *data = (char *)malloc((size_t)size + 1);
+    if (data && fread(data, 1, (size_t)size, fp) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+
+    if (!data) {
+        fprintf(stderr, "Error: Cannot read %s\n", path);
+        return NULL;
+    }
+
+    data[size] = '\0';
+    if (len) *len = (size_t)size;
+    return data;
+}
+
+/* 防止编译器优化掉基准测试中的计算 */
+static volatile size_t bench_sink;
+
+/* 各基准测试共用的一轮对话样本（长度和字符分布与实际回答相近，
+ * 包含需要转义的引号、换行、制表符和反斜杠）
+ */
+static const char bench_sample_user[] = "查找当前目录下所有大于 100MB 的 \"log\" 文件并按大小排序";
+static const char bench_sample_assistant[] =
+    "Thinking: 用户想找出大文件。使用 find 的 -size 选项筛选，再交给 du 和 sort 排序。\n"
+    "需要注意文件名中可能包含空格，使用 -print0 与 xargs -0 处理。\n\n"
+    "Answer: **命令：**\n"
+    "```bash\n"
+    "find . -type f -name \"*.log\" -size +100M -print0 | xargs -0 du -h | sort -rh\n"
+    "```\n\n"
+    "这个命令会递归查找 .log 文件，\t显示大小并从大到小排列。\\n 不会被展开。";
+
+/* 一组计时样本的统计（纳秒/次） */
+typedef struct {
+    int count;
+    double min;
+    double mean;
+    double p50;
+    double p90;
+    double p95;
+    double p99;
+    double max;
+} BenchStats;
+
+static inline int bench_compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* 排序样本（原地）并计算统计值，百分位取最近秩 */
+static inline BenchStats bench_stats(double *samples, int count) {
+    BenchStats stats = {0};
+    if (count <= 0) return stats;
+
+    qsort(samples, (size_t)count, sizeof(double), bench_compare_double);
+
+    double sum = 0;
+    for (int i = 0; i < count; i++) sum += samples[i];
+
+    stats.count = count;
+    stats.min = samples[0];
+    stats.max = samples[count - 1];
+    stats.mean = sum / count;
+    stats.p50 = samples[(count * 50 + 99) / 100 - 1];
+    stats.p90 = samples[(count * 90 + 99) / 100 - 1];
+    stats.p95 = samples[(count * 95 + 99) / 100 - 1];
+    stats.p99 = samples[(count * 99 + 99) / 100 - 1];
+    return stats;
+}
+
+#endif /* BENCH_UTIL_H */
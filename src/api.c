@@ -4,10 +4,17 @@
  *===========================================================================*/
 
 #include "api.h"
+#include "sse.h"
+#include "delta.h"
+#include "cmd_extract.h"
+#include "json_writer.h"
+#include "prefix.h"
+#include "transport.h"
+#include "cassette.h"
+#include "probes.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <curl/curl.h>
 
 // 尝试多种可能的 cJSON 头文件路径
 #if __has_include(<cjson/cJSON.h>)
@@ -18,24 +25,26 @@
     #include <cjson/cJSON.h>
 #endif
 
-/* 写入回调函数结构体 */
-typedef struct {
-    char *data;
-    size_t size;
-} WriteCallbackData;
-
-/* 写入回调函数 */
+/* 写入回调函数：按倍数扩容，避免每个数据块都重新分配 */
 static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
     WriteCallbackData *mem = (WriteCallbackData *)userp;
 
-    char *ptr = realloc(mem->data, mem->size + realsize + 1);
-    if (!ptr) {
-        fprintf(stderr, "Error: Not enough memory (realloc returned NULL)\n");
-        return 0;
+    if (mem->size + realsize + 1 > mem->capacity) {
+        size_t new_cap = mem->capacity ? mem->capacity : 4096;
+        while (mem->size + realsize + 1 > new_cap) {
+            new_cap *= 2;
+        }
+
+        char *ptr = (char *)arena_resize(mem->arena, mem->data, mem->capacity, new_cap);
+        if (!ptr) {
+            fprintf(stderr, "Error: Not enough memory for response data\n");
+            return 0;
+        }
+        mem->data = ptr;
+        mem->capacity = new_cap;
     }
 
-    mem->data = ptr;
     memcpy(&(mem->data[mem->size]), contents, realsize);
     mem->size += realsize;
     mem->data[mem->size] = '\0';
@@ -50,11 +59,18 @@ ApiResponse* api_response_create(void) {
         return NULL;
     }
 
+    response->arena = arena_create(0);
+    if (!response->arena) {
+        free(response);
+        return NULL;
+    }
+
     response->raw_response = NULL;
     response->thinking_process = NULL;
     response->command = NULL;
     response->success = false;
     response->error_message = NULL;
+    request_timings_reset(&response->timings);
 
     return response;
 }
@@ -62,48 +78,41 @@ ApiResponse* api_response_create(void) {
 void api_response_destroy(ApiResponse *response) {
     if (!response) return;
 
-    if (response->raw_response) free(response->raw_response);
-    if (response->thinking_process) free(response->thinking_process);
-    if (response->command) free(response->command);
-    if (response->error_message) free(response->error_message);
-
+    /* 所有字段都在 arena 中，一次释放 */
+    arena_destroy(response->arena);
     free(response);
 }
 
-char* build_system_prompt(const SystemInfo *sys_info) {
-    char *sys_context = NULL;
-
-    if (sys_info) {
-        sys_context = system_info_to_prompt(sys_info);
-    }
-
-    /* 基础系统提示词 */
-    const char *base_prompt =
-        "你是一个专业的命令行助手，擅长将自然语言转换为精确的 shell 命令。\n\n"
-        "## 你的任务\n"
-        "1. **理解用户意图**：分析用户的需求，识别要执行的操作\n"
-        "2. **思考过程**：展示你的推理过程，包括：\n"
-        "   - 分析用户需求的关键要素\n"
-        "   - 考虑不同的实现方案\n"
-        "   - 选择最优方案的理由\n"
-        "   - 潜在的风险和注意事项\n"
-        "3. **生成命令**：生成简洁、高效、安全的 shell 命令\n\n"
-        "## 输出格式要求\n"
-        "你必须严格按照以下格式输出：\n\n"
-        "**思考过程：**\n"
-        "[详细描述你的分析和推理过程]\n\n"
-        "**命令：**\n"
-        "```bash\n"
-        "[生成的命令，不要包含任何解释文字]\n"
-        "```\n\n"
-        "## 注意事项\n"
-        "- 命令必须实用、安全、符合最佳实践\n"
-        "- 优先使用现代工具和语法\n"
-        "- 根据系统上下文生成兼容的命令\n"
-        "- 避免破坏性操作，必要时添加确认选项\n"
-        "- 对于复杂操作，提供带注释的版本\n";
-
-    size_t prompt_len = strlen(base_prompt);
+/* 基础系统提示词 */
+static const char system_prompt_base[] =
+    "你是一个专业的命令行助手，擅长将自然语言转换为精确的 shell 命令。\n\n"
+    "## 你的任务\n"
+    "1. **理解用户意图**：分析用户的需求，识别要执行的操作\n"
+    "2. **思考过程**：展示你的推理过程，包括：\n"
+    "   - 分析用户需求的关键要素\n"
+    "   - 考虑不同的实现方案\n"
+    "   - 选择最优方案的理由\n"
+    "   - 潜在的风险和注意事项\n"
+    "3. **生成命令**：生成简洁、高效、安全的 shell 命令\n\n"
+    "## 输出格式要求\n"
+    "你必须严格按照以下格式输出：\n\n"
+    "**思考过程：**\n"
+    "[详细描述你的分析和推理过程]\n\n"
+    "**命令：**\n"
+    "```bash\n"
+    "[生成的命令，不要包含任何解释文字]\n"
+    "```\n\n"
+    "## 注意事项\n"
+    "- 命令必须实用、安全、符合最佳实践\n"
+    "- 优先使用现代工具和语法\n"
+    "- 根据系统上下文生成兼容的命令\n"
+    "- 避免破坏性操作，必要时添加确认选项\n"
+    "- 对于复杂操作，提供带注释的版本\n";
+
+char* build_system_prompt(Arena *arena, const SystemInfo *sys_info) {
+    const char *sys_context = system_info_prompt(sys_info);
+
+    size_t prompt_len = sizeof(system_prompt_base) - 1;
     size_t sys_context_len = 0;
 
     if (sys_context) {
@@ -111,337 +120,245 @@ char* build_system_prompt(const SystemInfo *sys_info) {
         prompt_len += sys_context_len + 1;  /* +1 for newline */
     }
 
-    char *full_prompt = (char *)malloc(prompt_len + 1);
+    char *full_prompt = (char *)arena_alloc(arena, prompt_len + 1);
     if (!full_prompt) {
-        if (sys_context) free(sys_context);
         return NULL;
     }
 
     if (sys_context) {
         snprintf(full_prompt, prompt_len + 1, "%s\n%s",
-                 sys_context, base_prompt);
+                 sys_context, system_prompt_base);
     } else {
         snprintf(full_prompt, prompt_len + 1, "%s",
-                 base_prompt);
+                 system_prompt_base);
     }
 
-    if (sys_context) free(sys_context);
-
     return full_prompt;
 }
 
-char* build_request_body(const Config *cfg, const SystemInfo *sys_info,
+char* build_request_body(Arena *arena, const Config *cfg, const SystemInfo *sys_info,
                          const ConversationHistory *history,
-                         const char *user_input) {
-    cJSON *json = cJSON_CreateObject();
-    if (!json) {
-        fprintf(stderr, "Error: Failed to create JSON object\n");
-        return NULL;
-    }
-
-    /* 添加 model */
-    cJSON_AddStringToObject(json, "model", cfg->model);
-
-    /* 添加 messages */
-    cJSON *messages = cJSON_CreateArray();
-    if (!messages) {
-        fprintf(stderr, "Error: Failed to create messages array\n");
-        cJSON_Delete(json);
-        return NULL;
-    }
-
-    /* System message */
-    cJSON *system_msg = cJSON_CreateObject();
-    cJSON_AddStringToObject(system_msg, "role", "system");
-
-    char *system_prompt = build_system_prompt(sys_info);
-    if (!system_prompt) {
-        cJSON_Delete(system_msg);
-        cJSON_Delete(messages);
-        cJSON_Delete(json);
-        return NULL;
-    }
-
-    cJSON_AddStringToObject(system_msg, "content", system_prompt);
-    cJSON_AddItemToArray(messages, system_msg);
-
-    /* 添加对话历史 (如果有) */
-    if (history && history->current_count > 0) {
-        if (cfg->verbose) {
-            printf("[DEBUG] Adding %d rounds of conversation history to API request\n", history->current_count);
-        }
-        for (int i = 0; i < history->current_count; i++) {
-            /* 用户消息 */
-            cJSON *hist_user_msg = cJSON_CreateObject();
-            cJSON_AddStringToObject(hist_user_msg, "role", "user");
-            cJSON_AddStringToObject(hist_user_msg, "content", history->rounds[i].user_input);
-            cJSON_AddItemToArray(messages, hist_user_msg);
-
-            /* 助手消息 */
-            cJSON *hist_assist_msg = cJSON_CreateObject();
-            cJSON_AddStringToObject(hist_assist_msg, "role", "assistant");
-            cJSON_AddStringToObject(hist_assist_msg, "content", history->rounds[i].assistant_response);
-            cJSON_AddItemToArray(messages, hist_assist_msg);
-
-            if (cfg->verbose) {
-                printf("[DEBUG] History[%d]: User='%s'\n", i, history->rounds[i].user_input);
-            }
-        }
+                         const char *user_input, const RequestOptions *options) {
+    if (!cfg || !user_input) return NULL;
+    TRACE_PROBE(request_build_start);
+
+    RequestOptions defaults = {0};
+    if (!options) options = &defaults;
+
+    const char *sys_context = system_info_prompt(sys_info);
+    int rounds = history ? history->current_count : 0;
+
+    /* 系统消息和历史消息：优先使用已序列化的前缀，只追加新增的轮次 */
+    PromptPrefix *prefix = history ? history->prefix : NULL;
+    const char *prefix_json = NULL;
+    size_t prefix_len = 0;
+    if (prefix && prompt_prefix_sync(prefix, sys_context, system_prompt_base,
+                                     sizeof(system_prompt_base) - 1, history)) {
+        prefix_json = prompt_prefix_messages(prefix, &prefix_len);
+    }
+
+    /* 预估输出大小，避免写入过程中反复扩容 */
+    size_t estimate = strlen(user_input) + 256;
+    if (cfg->user_prompt) estimate += strlen(cfg->user_prompt);
+    if (prefix_json) {
+        estimate += prefix_len;
     } else {
-        if (cfg->verbose) {
-            printf("[DEBUG] No conversation history to add\n");
+        estimate += sizeof(system_prompt_base);
+        if (sys_context) estimate += strlen(sys_context);
+        for (int i = 0; i < rounds; i++) {
+            const ConversationRound *round = history_round(history, i);
+            estimate += round->user_len + round->assistant_len + 64;
         }
     }
 
-    /* User message */
-    cJSON *user_msg = cJSON_CreateObject();
-    cJSON_AddStringToObject(user_msg, "role", "user");
-
-    /* 如果有用户自定义提示词,则前置到用户输入 */
-    char *final_content = NULL;
-    if (cfg->user_prompt && strlen(cfg->user_prompt) > 0) {
-        size_t total_len = strlen(cfg->user_prompt) + strlen(user_input) + 4; // +4 for ": " and null terminator
-        final_content = (char *)malloc(total_len);
-        if (final_content) {
-            snprintf(final_content, total_len, "%s: %s", cfg->user_prompt, user_input);
-            cJSON_AddStringToObject(user_msg, "content", final_content);
-            free(final_content);
-        } else {
-            /* 内存分配失败,使用原始输入 */
-            cJSON_AddStringToObject(user_msg, "content", user_input);
-        }
-    } else {
-        cJSON_AddStringToObject(user_msg, "content", user_input);
-    }
-
-    cJSON_AddItemToArray(messages, user_msg);
-
-    cJSON_AddItemToObject(json, "messages", messages);
-
-    /* 添加 temperature */
-    cJSON_AddNumberToObject(json, "temperature", cfg->temperature);
-
-    /* 添加 max_tokens */
-    cJSON_AddNumberToObject(json, "max_tokens", cfg->max_tokens);
-
-    /* 添加 stream (false for simplicity) */
-    cJSON_AddBoolToObject(json, "stream", false);
-
-    /* 转换为字符串 */
-    char *json_string = cJSON_PrintUnformatted(json);
-
-    /* 清理 */
-    free(system_prompt);
-    cJSON_Delete(json);
-
-    return json_string;
-}
-
-/* 构建请求体（流式模式） */
-char* build_request_body_stream(const Config *cfg, const SystemInfo *sys_info,
-                                 const ConversationHistory *history,
-                                 const char *user_input) {
-    cJSON *json = cJSON_CreateObject();
-    if (!json) {
-        fprintf(stderr, "Error: Failed to create JSON object\n");
-        return NULL;
-    }
+    JsonWriter writer;
+    json_writer_init(&writer, arena, estimate + estimate / 16);
+    json_writer_begin_object(&writer);
 
     /* 添加 model */
-    cJSON_AddStringToObject(json, "model", cfg->model);
+    json_writer_key(&writer, "model");
+    json_writer_string(&writer, cfg->model);
 
     /* 添加 messages */
-    cJSON *messages = cJSON_CreateArray();
-    if (!messages) {
-        fprintf(stderr, "Error: Failed to create messages array\n");
-        cJSON_Delete(json);
-        return NULL;
-    }
+    json_writer_key(&writer, "messages");
+    json_writer_begin_array(&writer);
 
-    /* System message */
-    cJSON *system_msg = cJSON_CreateObject();
-    cJSON_AddStringToObject(system_msg, "role", "system");
-
-    char *system_prompt = build_system_prompt(sys_info);
-    if (!system_prompt) {
-        cJSON_Delete(system_msg);
-        cJSON_Delete(messages);
-        cJSON_Delete(json);
-        return NULL;
+    if (prefix_json) {
+        json_writer_raw(&writer, prefix_json, prefix_len);
+    } else {
+        prompt_prefix_write_system(&writer, sys_context, system_prompt_base,
+                                   sizeof(system_prompt_base) - 1);
+        for (int i = 0; i < rounds; i++) {
+            prompt_prefix_write_round(&writer, history, i);
+        }
     }
 
-    cJSON_AddStringToObject(system_msg, "content", system_prompt);
-    cJSON_AddItemToArray(messages, system_msg);
-
-    /* 添加对话历史 (如果有) */
-    if (history && history->current_count > 0) {
-        if (cfg->verbose) {
-            printf("[DEBUG] Adding %d rounds of conversation history to API request\n", history->current_count);
-        }
-        for (int i = 0; i < history->current_count; i++) {
-            /* 用户消息 */
-            cJSON *hist_user_msg = cJSON_CreateObject();
-            cJSON_AddStringToObject(hist_user_msg, "role", "user");
-            cJSON_AddStringToObject(hist_user_msg, "content", history->rounds[i].user_input);
-            cJSON_AddItemToArray(messages, hist_user_msg);
-
-            /* 助手消息 */
-            cJSON *hist_assist_msg = cJSON_CreateObject();
-            cJSON_AddStringToObject(hist_assist_msg, "role", "assistant");
-            cJSON_AddStringToObject(hist_assist_msg, "content", history->rounds[i].assistant_response);
-            cJSON_AddItemToArray(messages, hist_assist_msg);
-
-            if (cfg->verbose) {
-                printf("[DEBUG] History[%d]: User='%s'\n", i, history->rounds[i].user_input);
+    /* 调试输出：对话历史和前缀复用情况 */
+    if (cfg->verbose) {
+        if (rounds > 0) {
+            printf("[DEBUG] Adding %d rounds of conversation history to API request\n", rounds);
+            for (int i = 0; i < rounds; i++) {
+                printf("[DEBUG] History[%d]: User='%s'\n", i, history_user(history, i));
             }
-        }
-    } else {
-        if (cfg->verbose) {
+        } else {
             printf("[DEBUG] No conversation history to add\n");
         }
+        if (prefix_json) {
+            printf("[DEBUG] Prompt prefix: %zu bytes, %d rounds reused, %d serialized\n",
+                   prefix_len, prefix->reused_rounds, rounds - prefix->reused_rounds);
+        }
     }
 
-    /* User message */
-    cJSON *user_msg = cJSON_CreateObject();
-    cJSON_AddStringToObject(user_msg, "role", "user");
-
-    /* 如果有用户自定义提示词,则前置到用户输入 */
-    char *final_content = NULL;
-    if (cfg->user_prompt && strlen(cfg->user_prompt) > 0) {
-        size_t total_len = strlen(cfg->user_prompt) + strlen(user_input) + 4; // +4 for ": " and null terminator
-        final_content = (char *)malloc(total_len);
-        if (final_content) {
-            snprintf(final_content, total_len, "%s: %s", cfg->user_prompt, user_input);
-            cJSON_AddStringToObject(user_msg, "content", final_content);
-            free(final_content);
-        } else {
-            /* 内存分配失败,使用原始输入 */
-            cJSON_AddStringToObject(user_msg, "content", user_input);
+    /* User message：如果有用户自定义提示词,则前置到用户输入 */
+    json_writer_begin_object(&writer);
+    json_writer_key(&writer, "role");
+    json_writer_string(&writer, "user");
+    json_writer_key(&writer, "content");
+    json_writer_string_begin(&writer);
+    if (cfg->user_prompt && cfg->user_prompt[0] != '\0') {
+        json_writer_string_append(&writer, cfg->user_prompt, strlen(cfg->user_prompt));
+        json_writer_string_append(&writer, ": ", 2);
+    }
+    json_writer_string_append(&writer, user_input, strlen(user_input));
+    json_writer_string_end(&writer);
+    json_writer_end_object(&writer);
+
+    json_writer_end_array(&writer);
+
+    /* 添加 temperature / max_tokens / stream */
+    json_writer_key(&writer, "temperature");
+    json_writer_double(&writer, cfg->temperature);
+    json_writer_key(&writer, "max_tokens");
+    json_writer_int(&writer, cfg->max_tokens);
+    json_writer_key(&writer, "stream");
+    json_writer_bool(&writer, options->stream);
+
+    /* 可选字段 */
+    if (options->thinking) {
+        json_writer_key(&writer, "thinking");
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "type");
+        json_writer_string(&writer, options->thinking);
+        json_writer_end_object(&writer);
+    }
+
+    if (options->stop && options->stop[0]) {
+        json_writer_key(&writer, "stop");
+        json_writer_begin_array(&writer);
+        for (int i = 0; options->stop[i]; i++) {
+            json_writer_string(&writer, options->stop[i]);
         }
-    } else {
-        cJSON_AddStringToObject(user_msg, "content", user_input);
+        json_writer_end_array(&writer);
     }
 
-    cJSON_AddItemToArray(messages, user_msg);
-    cJSON_AddItemToObject(json, "messages", messages);
-
-    /* 添加 temperature */
-    cJSON_AddNumberToObject(json, "temperature", cfg->temperature);
-
-    /* 添加 max_tokens */
-    cJSON_AddNumberToObject(json, "max_tokens", cfg->max_tokens);
-
-    /* 添加 stream = true (启用流式输出) */
-    cJSON_AddBoolToObject(json, "stream", true);
-
-    /* 转换为字符串 */
-    char *json_string = cJSON_PrintUnformatted(json);
+    if (options->response_format) {
+        json_writer_key(&writer, "response_format");
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "type");
+        json_writer_string(&writer, options->response_format);
+        json_writer_end_object(&writer);
+    }
 
-    /* 清理 */
-    free(system_prompt);
-    cJSON_Delete(json);
+    json_writer_end_object(&writer);
 
-    return json_string;
+    size_t body_len = 0;
+    char *body = json_writer_finish(&writer, &body_len);
+    if (!body) {
+        fprintf(stderr, "Error: Failed to serialize request body\n");
+    }
+    TRACE_PROBE1(request_build_done, body_len);
+    return body;
 }
 
-bool api_send_request(const Config *cfg, const SystemInfo *sys_info,
-                      const ConversationHistory *history,
-                      const char *user_input, ApiResponse *response) {
-    if (!cfg || !user_input || !response) {
-        fprintf(stderr, "Error: Invalid parameters\n");
-        return false;
+/* 根据配置填充请求选项 */
+static void request_options_init(RequestOptions *options, const Config *cfg, bool stream) {
+    memset(options, 0, sizeof(RequestOptions));
+    options->stream = stream;
+    if (cfg->thinking && cfg->thinking[0] != '\0') {
+        options->thinking = cfg->thinking;
     }
+}
 
-    CURL *curl;
-    CURLcode res;
+/* 设置请求通用的 curl 选项，返回需要在请求结束后释放的 header 链表 */
+static struct curl_slist* setup_request(CURL *curl, const Config *cfg,
+                                        const char *request_body) {
     struct curl_slist *headers = NULL;
-    WriteCallbackData write_data = {0};
-
-    /* 初始化 curl */
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "Error: Failed to initialize curl\n");
-        response->error_message = strdup("Failed to initialize curl");
-        return false;
-    }
 
     /* 构建请求 URL */
     char url[512];
     snprintf(url, sizeof(url), "%s/chat/completions", cfg->endpoint);
 
-    /* 构建请求体 */
-    char *request_body = build_request_body(cfg, sys_info, history, user_input);
-    if (!request_body) {
-        fprintf(stderr, "Error: Failed to build request body\n");
-        response->error_message = strdup("Failed to build request body");
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
-        return false;
-    }
-
-    if (cfg->verbose) {
-        printf("\n=== Request ===\n");
-        printf("URL: %s\n", url);
-        printf("Body: %s\n", request_body);
-        printf("===============\n\n");
-    }
-
     /* 设置 headers */
     char auth_header[256];
     snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", cfg->api_key);
-    headers = curl_slist_append(headers, auth_header);
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    headers = transport.slist_append(headers, auth_header);
+    headers = transport.slist_append(headers, "Content-Type: application/json");
 
     /* 设置 curl 选项 */
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request_body);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &write_data);
+    transport.easy_setopt(curl, CURLOPT_URL, url);
+    transport.easy_setopt(curl, CURLOPT_POSTFIELDS, request_body);
+    transport.easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 
     /* 超时设置：使用低速超时而非总时间超时 */
     /* 如果传输速度低于 1 byte/s 持续 cfg->timeout 秒，则判定为超时 */
-    /* 这样可以在有数据流时允许长时间运行 */
-    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);  /* 1 byte/s */
-    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, cfg->timeout);
+    /* 这样可以在有数据流时允许长时间运行（支持长时间推理） */
+    transport.easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);  /* 1 byte/s */
+    transport.easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)cfg->timeout);
 
     /* 设置总体最大超时时间为配置值的 10 倍（作为安全网） */
     /* 防止异常情况下无限等待 */
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, cfg->timeout * 10L);
+    transport.easy_setopt(curl, CURLOPT_TIMEOUT, cfg->timeout * 10L);
 
-    /* 发送请求 */
-    res = curl_easy_perform(curl);
+    return headers;
+}
 
-    if (res != CURLE_OK) {
-        fprintf(stderr, "Error: curl_easy_perform() failed: %s\n",
-                curl_easy_strerror(res));
-        response->error_message = strdup(curl_easy_strerror(res));
-        free(request_body);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
-        return false;
-    }
+/* 去除字符串首尾空白（原地修改） */
+static void trim_in_place(char *str, size_t len) {
+    if (len == 0) return;
 
-    /* 保存原始响应 */
-    response->raw_response = write_data.data;
+    char *start = str;
+    char *end = start + len - 1;
+    while (start < end && (*start == ' ' || *start == '\n' || *start == '\r')) start++;
+    while (end > start && (*end == ' ' || *end == '\n' || *end == '\r')) end--;
+    *(end + 1) = '\0';
 
-    if (cfg->verbose) {
-        printf("\n=== Response ===\n");
-        printf("%s\n", response->raw_response);
-        printf("================\n\n");
+    if (start != str) {
+        memmove(str, start, strlen(start) + 1);
     }
+}
+
+/* 提取 usage 字段中的 token 统计 */
+static void parse_usage(const cJSON *usage, ApiResponse *response) {
+    if (!usage || !cJSON_IsObject(usage)) return;
+
+    cJSON *item = cJSON_GetObjectItem(usage, "prompt_tokens");
+    if (cJSON_IsNumber(item)) response->prompt_tokens = item->valueint;
+
+    item = cJSON_GetObjectItem(usage, "completion_tokens");
+    if (cJSON_IsNumber(item)) response->completion_tokens = item->valueint;
+
+    item = cJSON_GetObjectItem(usage, "total_tokens");
+    if (cJSON_IsNumber(item)) response->total_tokens = item->valueint;
+
+    cJSON *details = cJSON_GetObjectItem(usage, "prompt_tokens_details");
+    item = cJSON_IsObject(details) ? cJSON_GetObjectItem(details, "cached_tokens") : NULL;
+    if (cJSON_IsNumber(item)) response->cached_tokens = item->valueint;
+}
+
+/* 记录 finish_reason（stop / length 等） */
+static void set_finish_reason(ApiResponse *response, const char *reason) {
+    if (response->finish_reason && strcmp(response->finish_reason, reason) == 0) return;
+    response->finish_reason = arena_strdup(response->arena, reason);
+}
+
+bool api_parse_response(const char *raw_response, ApiResponse *response) {
+    if (!raw_response || !response) return false;
 
     /* 解析响应 */
-    cJSON *json = cJSON_Parse(response->raw_response);
+    cJSON *json = cJSON_Parse(raw_response);
     if (!json) {
         fprintf(stderr, "Error: Failed to parse response JSON\n");
-        response->error_message = strdup("Failed to parse response");
-        free(request_body);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
+        response->error_message = arena_strdup(response->arena, "Failed to parse response");
         return false;
     }
 
@@ -451,21 +368,24 @@ bool api_send_request(const Config *cfg, const SystemInfo *sys_info,
         cJSON *message = cJSON_GetObjectItem(error, "message");
         if (message && cJSON_IsString(message)) {
             fprintf(stderr, "API Error: %s\n", message->valuestring);
-            response->error_message = strdup(message->valuestring);
+            response->error_message = arena_strdup(response->arena, message->valuestring);
         }
         cJSON_Delete(json);
-        free(request_body);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
         return false;
     }
 
+    parse_usage(cJSON_GetObjectItem(json, "usage"), response);
+
     /* 提取内容 */
     cJSON *choices = cJSON_GetObjectItem(json, "choices");
     if (choices && cJSON_IsArray(choices)) {
         cJSON *choice = cJSON_GetArrayItem(choices, 0);
         if (choice) {
+            cJSON *finish_reason = cJSON_GetObjectItem(choice, "finish_reason");
+            if (cJSON_IsString(finish_reason)) {
+                set_finish_reason(response, finish_reason->valuestring);
+            }
+
             cJSON *message = cJSON_GetObjectItem(choice, "message");
             if (message) {
                 cJSON *content = cJSON_GetObjectItem(message, "content");
@@ -480,51 +400,27 @@ bool api_send_request(const Config *cfg, const SystemInfo *sys_info,
                     if (thinking_start && thinking_end) {
                         thinking_start += strlen("**思考过程：**");
                         size_t thinking_len = thinking_end - thinking_start;
-                        response->thinking_process = (char *)malloc(thinking_len + 1);
+                        response->thinking_process = arena_strndup(response->arena,
+                                                                   thinking_start, thinking_len);
                         if (response->thinking_process) {
-                            strncpy(response->thinking_process, thinking_start, thinking_len);
-                            response->thinking_process[thinking_len] = '\0';
-
-                            /* 去除首尾空白 */
-                            char *start = response->thinking_process;
-                            char *end = start + thinking_len - 1;
-                            while (start < end && (*start == ' ' || *start == '\n' || *start == '\r')) start++;
-                            while (end > start && (*end == ' ' || *end == '\n' || *end == '\r')) end--;
-                            *(end + 1) = '\0';
-
-                            if (start != response->thinking_process) {
-                                memmove(response->thinking_process, start, strlen(start) + 1);
-                            }
+                            trim_in_place(response->thinking_process, thinking_len);
+                        }
+                    } else {
+                        /* 没有思考过程标记时，使用推理模型返回的 reasoning_content */
+                        cJSON *reasoning = cJSON_GetObjectItem(message, "reasoning_content");
+                        if (reasoning && cJSON_IsString(reasoning) &&
+                            strlen(reasoning->valuestring) > 0) {
+                            response->thinking_process = arena_strdup(response->arena,
+                                                                      reasoning->valuestring);
+                            trim_in_place(response->thinking_process,
+                                          strlen(response->thinking_process));
                         }
                     }
 
-                    /* 查找命令 */
-                    const char *cmd_start = strstr(response_text, "```bash");
-                    const char *cmd_end = NULL;
-
-                    if (cmd_start) {
-                        cmd_start += strlen("```bash");
-                        cmd_end = strstr(cmd_start, "```");
-                    }
-
-                    if (cmd_start && cmd_end && cmd_end > cmd_start) {
-                        size_t cmd_len = cmd_end - cmd_start;
-                        response->command = (char *)malloc(cmd_len + 1);
-                        if (response->command) {
-                            strncpy(response->command, cmd_start, cmd_len);
-                            response->command[cmd_len] = '\0';
-
-                            /* 去除首尾空白 */
-                            char *start = response->command;
-                            char *end = start + cmd_len - 1;
-                            while (start < end && (*start == ' ' || *start == '\n' || *start == '\r')) start++;
-                            while (end > start && (*end == ' ' || *end == '\n' || *end == '\r')) end--;
-                            *(end + 1) = '\0';
-
-                            if (start != response->command) {
-                                memmove(response->command, start, strlen(start) + 1);
-                            }
-                        }
+                    /* 查找命令（最后一个命令代码块） */
+                    response->command = cmd_extract_from_text(response->arena, response_text);
+                    if (response->command) {
+                        TRACE_PROBE1(command_extracted, response->command);
                     }
 
                     response->success = true;
@@ -535,68 +431,320 @@ bool api_send_request(const Config *cfg, const SystemInfo *sys_info,
 
     /* 清理 */
     cJSON_Delete(json);
-    free(request_body);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    curl_global_cleanup();
 
     return response->success;
 }
 
+bool api_request_prepare(ApiRequest *request, CURL *curl, Arena *arena, const Config *cfg,
+                         const SystemInfo *sys_info,
+                         const ConversationHistory *history,
+                         const char *user_input) {
+    if (!request || !curl || !cfg || !user_input) return false;
+
+    memset(request, 0, sizeof(ApiRequest));
+    request->curl = curl;
+    request->arena = arena;
+    request->response_data.arena = arena;
+
+    /* 构建请求体 */
+    RequestOptions options;
+    request_options_init(&options, cfg, false);
+    request->request_body = build_request_body(arena, cfg, sys_info, history, user_input,
+                                               &options);
+    if (!request->request_body) {
+        fprintf(stderr, "Error: Failed to build request body\n");
+        return false;
+    }
+
+    if (cfg->verbose) {
+        printf("\n=== Request ===\n");
+        printf("URL: %s/chat/completions\n", cfg->endpoint);
+        printf("Body: %s\n", request->request_body);
+        printf("===============\n\n");
+    }
+
+    request->headers = setup_request(curl, cfg, request->request_body);
+    transport.easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    transport.easy_setopt(curl, CURLOPT_WRITEDATA, &request->response_data);
+
+    return true;
+}
+
+bool api_request_finish(ApiRequest *request, CURLcode result, const Config *cfg,
+                        ApiResponse *response) {
+    if (!request || !response) return false;
+
+    if (result != CURLE_OK) {
+        fprintf(stderr, "Error: curl_easy_perform() failed: %s\n",
+                transport.easy_strerror(result));
+        response->error_message = arena_strdup(response->arena, transport.easy_strerror(result));
+        return false;
+    }
+
+    /* 保存原始响应（所有权转移给 response） */
+    if (request->arena == response->arena) {
+        response->raw_response = request->response_data.data;
+    } else {
+        response->raw_response = arena_strndup(response->arena, request->response_data.data,
+                                               request->response_data.size);
+        arena_free(request->arena, request->response_data.data);
+    }
+    request->response_data.data = NULL;
+    request->response_data.size = 0;
+    request->response_data.capacity = 0;
+
+    if (!response->raw_response) {
+        response->error_message = arena_strdup(response->arena, "Empty response");
+        return false;
+    }
+
+    if (cfg && cfg->verbose) {
+        printf("\n=== Response ===\n");
+        printf("%s\n", response->raw_response);
+        printf("================\n\n");
+    }
+
+    return api_parse_response(response->raw_response, response);
+}
+
+void api_request_cleanup(ApiRequest *request) {
+    if (!request) return;
+
+    if (request->headers) transport.slist_free_all(request->headers);
+    arena_free(request->arena, request->request_body);
+    arena_free(request->arena, request->response_data.data);
+
+    request->headers = NULL;
+    request->request_body = NULL;
+    request->response_data.data = NULL;
+    request->response_data.size = 0;
+    request->response_data.capacity = 0;
+}
+
+/* 传输结束后从 curl 读取各网络阶段的时间点
+ * curl 的时间是相对 curl_easy_perform 开始的秒数，perform_start 为此时的请求时间线位置
+ */
+static void record_transfer_times(CURL *curl, RequestTimings *timings, double perform_start) {
+    double seconds;
+    long connects = 0;
+
+    if (transport.easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME, &seconds) == CURLE_OK &&
+        seconds > 0) {
+        timings->request_sent = perform_start + seconds * 1000.0;
+    }
+
+    /* 没有建立新连接、但请求已经发出：复用了连接池中的连接 */
+    if (transport.easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects) == CURLE_OK) {
+        timings->reused_connection = connects == 0 && timings->request_sent >= 0;
+    }
+    if (!timings->reused_connection) {
+        if (transport.easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME, &seconds) == CURLE_OK &&
+            seconds > 0) {
+            timings->dns = perform_start + seconds * 1000.0;
+        }
+        if (transport.easy_getinfo(curl, CURLINFO_CONNECT_TIME, &seconds) == CURLE_OK &&
+            seconds > 0) {
+            timings->connect = perform_start + seconds * 1000.0;
+        }
+        /* 明文 HTTP 没有 TLS 握手，APPCONNECT_TIME 为 0 */
+        if (transport.easy_getinfo(curl, CURLINFO_APPCONNECT_TIME, &seconds) == CURLE_OK &&
+            seconds > 0) {
+            timings->tls = perform_start + seconds * 1000.0;
+        }
+    }
+    if (transport.easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &seconds) == CURLE_OK &&
+        seconds > 0) {
+        timings->first_byte = perform_start + seconds * 1000.0;
+    }
+}
+
+bool api_send_request(GlmClient *client, const Config *cfg, const SystemInfo *sys_info,
+                      const ConversationHistory *history,
+                      const char *user_input, ApiResponse *response) {
+    if (!cfg || !user_input || !response) {
+        fprintf(stderr, "Error: Invalid parameters\n");
+        return false;
+    }
+
+    RequestTimings *timings = &response->timings;
+    request_timings_reset(timings);
+    timings->start_ns = timing_now_ns();
+
+    CURL *curl;
+    CURLcode res;
+    ApiRequest request;
+    GlmClient *owned_client = NULL;
+
+    /* 未提供长生命周期客户端时，为本次请求创建临时客户端 */
+    if (!client) {
+        owned_client = client_create();
+        client = owned_client;
+    }
+
+    curl = client_acquire(client);
+    if (!curl) {
+        fprintf(stderr, "Error: Failed to initialize curl\n");
+        response->error_message = arena_strdup(response->arena, "Failed to initialize curl");
+        client_destroy(owned_client);
+        return false;
+    }
+
+    if (!api_request_prepare(&request, curl, response->arena, cfg, sys_info, history, user_input)) {
+        response->error_message = arena_strdup(response->arena, "Failed to build request body");
+        api_request_cleanup(&request);
+        client_destroy(owned_client);
+        return false;
+    }
+    request_timings_mark(timings, &timings->body_built);
+
+    /* 发送请求 */
+    double perform_start = timing_ms_since(timings->start_ns);
+    TRACE_PROBE1(request_perform_start, 0);
+    res = cassette_perform(curl, cfg, user_input, false, request.request_body,
+                           write_callback, &request.response_data);
+    TRACE_PROBE1(request_perform_done, (int)res);
+    request_timings_mark(timings, &timings->end);
+    if (!cassette_replaying()) {
+        record_transfer_times(curl, timings, perform_start);
+    }
+
+    bool success = api_request_finish(&request, res, cfg, response);
+    if (response->command) {
+        request_timings_mark(timings, &timings->command);
+    }
+
+    /* 清理 */
+    api_request_cleanup(&request);
+    client_destroy(owned_client);
+
+    return success;
+}
+
 /* 流式写入回调函数数据结构 */
 typedef struct {
     StreamCallback callback;
     void *userdata;
-    char *buffer;
-    size_t buffer_size;
-    size_t buffer_pos;
+    SseParser sse;           /* 增量 SSE 解析器 */
+    DeltaExtractor delta;    /* 增量字段提取器 */
+    CommandExtractor commands; /* 增量命令块提取器 */
+    bool stop_after_command; /* 命令块闭合后结束传输 */
+    bool stop_requested;     /* 已收到命令，等待写回调中止传输 */
     bool is_done;
+    ApiResponse *response;   /* 用于记录 usage 统计和时间线 */
 } StreamCallbackData;
 
-/* SSE 数据解析辅助函数 */
-static void process_sse_chunk(const char *chunk, size_t chunk_size,
-                              StreamCallbackData *stream_data) {
-    /* 跳过空行和注释 */
-    if (chunk_size == 0 || chunk[0] == '\n' || chunk[0] == '\r' || chunk[0] == ':') {
-        return;
+/* 转发思考过程片段 */
+static void emit_reasoning(StreamCallbackData *stream_data, const char *content) {
+    RequestTimings *timings = &stream_data->response->timings;
+    request_timings_mark(timings, &timings->first_reasoning);
+
+    if (stream_data->callback) {
+        stream_data->callback(content, STREAM_CONTENT_REASONING, stream_data->userdata);
     }
+}
 
-    /* 查找 "data: " 前缀 */
-    if (strncmp(chunk, "data: ", 6) != 0) {
-        return;
+/* 转发回答片段，并在命令块闭合时立即发出命令事件 */
+static void emit_answer(StreamCallbackData *stream_data, const char *content, size_t len) {
+    RequestTimings *timings = &stream_data->response->timings;
+    request_timings_mark(timings, &timings->first_answer);
+
+    if (stream_data->callback) {
+        stream_data->callback(content, STREAM_CONTENT_ANSWER, stream_data->userdata);
     }
 
-    const char *json_start = chunk + 6;
-    const char *json_end = memchr(json_start, '\n', chunk_size - 6);
+    const char *command = cmd_extractor_feed(&stream_data->commands, content, len);
+    if (command) {
+        TRACE_PROBE1(command_extracted, command);
+        request_timings_mark(timings, &timings->command);
+        if (stream_data->callback) {
+            stream_data->callback(command, STREAM_CONTENT_COMMAND, stream_data->userdata);
+        }
+        if (stream_data->stop_after_command) {
+            stream_data->stop_requested = true;
+        }
+    }
+}
 
-    size_t json_len = json_end ? (size_t)(json_end - json_start) : (chunk_size - 6);
+/* 回答结束：处理未闭合的命令块 */
+static void finish_answer(StreamCallbackData *stream_data) {
+    const char *command = cmd_extractor_finish(&stream_data->commands);
+    if (command) {
+        TRACE_PROBE1(command_extracted, command);
+        RequestTimings *timings = &stream_data->response->timings;
+        request_timings_mark(timings, &timings->command);
+    }
+    if (command && stream_data->callback) {
+        stream_data->callback(command, STREAM_CONTENT_COMMAND, stream_data->userdata);
+    }
+}
+
+/* SSE 事件处理：解析每个 data 事件中的增量内容 */
+static void handle_sse_event(const char *event, const char *data, size_t data_len,
+                             void *userdata) {
+    StreamCallbackData *stream_data = (StreamCallbackData *)userdata;
+    (void)event;
+
+    if (stream_data->is_done || stream_data->stop_requested) return;
 
     /* 检查 [DONE] 标记 */
-    if (json_len >= 6 && strncmp(json_start, "[DONE]", 6) == 0) {
+    if (data_len >= 6 && strncmp(data, "[DONE]", 6) == 0) {
         stream_data->is_done = true;
+        TRACE_PROBE2(sse_event, data_len, (int)STREAM_CONTENT_DONE);
+        finish_answer(stream_data);
         if (stream_data->callback) {
             stream_data->callback("", STREAM_CONTENT_DONE, stream_data->userdata);
         }
         return;
     }
 
-    /* 解析 JSON 提取 delta.content */
-    char *json_str = (char *)malloc(json_len + 1);
-    if (!json_str) return;
+    /* 快速路径：直接扫描事件字节提取 delta 字段（data 直接指向接收缓冲区） */
+    DeltaEvent delta_event;
+    if (delta_extract(&stream_data->delta, data, data_len, &delta_event)) {
+        if (stream_data->response) {
+            if (delta_event.has_usage) {
+                stream_data->response->prompt_tokens = delta_event.prompt_tokens;
+                stream_data->response->completion_tokens = delta_event.completion_tokens;
+                stream_data->response->total_tokens = delta_event.total_tokens;
+                stream_data->response->cached_tokens = delta_event.cached_tokens;
+            }
+            if (delta_event.finish_reason[0] != '\0') {
+                set_finish_reason(stream_data->response, delta_event.finish_reason);
+            }
+        }
 
-    memcpy(json_str, json_start, json_len);
-    json_str[json_len] = '\0';
+        TRACE_PROBE2(sse_event, data_len,
+                     delta_event.content_len > 0 ? (int)STREAM_CONTENT_ANSWER :
+                     delta_event.reasoning_len > 0 ? (int)STREAM_CONTENT_REASONING : -1);
 
-    cJSON *json = cJSON_Parse(json_str);
-    free(json_str);
+        if (delta_event.reasoning_len > 0) {
+            emit_reasoning(stream_data, delta_event.reasoning);
+        }
+        if (delta_event.content_len > 0) {
+            emit_answer(stream_data, delta_event.content, delta_event.content_len);
+        }
+        return;
+    }
 
+    /* 非预期结构：回退到 cJSON 完整解析 */
+    cJSON *json = cJSON_ParseWithLength(data, data_len);
     if (!json) return;
+    int content_type = -1;
+
+    /* 最后一个数据块可能携带 usage 统计 */
+    if (stream_data->response) {
+        parse_usage(cJSON_GetObjectItem(json, "usage"), stream_data->response);
+    }
 
     /* 提取 choices[0].delta */
     cJSON *choices = cJSON_GetObjectItem(json, "choices");
     if (choices && cJSON_IsArray(choices)) {
         cJSON *choice = cJSON_GetArrayItem(choices, 0);
         if (choice) {
+            cJSON *finish_reason = cJSON_GetObjectItem(choice, "finish_reason");
+            if (stream_data->response && cJSON_IsString(finish_reason)) {
+                set_finish_reason(stream_data->response, finish_reason->valuestring);
+            }
+
             cJSON *delta = cJSON_GetObjectItem(choice, "delta");
             if (delta) {
                 /* 优先处理 reasoning_content (思考过程) */
@@ -604,10 +752,8 @@ static void process_sse_chunk(const char *chunk, size_t chunk_size,
                 if (reasoning_content && cJSON_IsString(reasoning_content) &&
                     strlen(reasoning_content->valuestring) > 0) {
                     /* 调用用户回调 - 思考过程 */
-                    if (stream_data->callback) {
-                        stream_data->callback(reasoning_content->valuestring,
-                                            STREAM_CONTENT_REASONING, stream_data->userdata);
-                    }
+                    content_type = STREAM_CONTENT_REASONING;
+                    emit_reasoning(stream_data, reasoning_content->valuestring);
                 }
 
                 /* 处理 content (最终回答) */
@@ -615,15 +761,16 @@ static void process_sse_chunk(const char *chunk, size_t chunk_size,
                 if (content && cJSON_IsString(content) &&
                     strlen(content->valuestring) > 0) {
                     /* 调用用户回调 - 最终回答 */
-                    if (stream_data->callback) {
-                        stream_data->callback(content->valuestring,
-                                            STREAM_CONTENT_ANSWER, stream_data->userdata);
-                    }
+                    content_type = STREAM_CONTENT_ANSWER;
+                    emit_answer(stream_data, content->valuestring,
+                                strlen(content->valuestring));
                 }
             }
         }
     }
 
+    TRACE_PROBE2(sse_event, data_len, content_type);
+    (void)content_type;
     cJSON_Delete(json);
 }
 
@@ -631,45 +778,21 @@ static void process_sse_chunk(const char *chunk, size_t chunk_size,
 static size_t stream_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
     StreamCallbackData *stream_data = (StreamCallbackData *)userp;
-    char *data = (char *)contents;
-
-    /* 逐字符处理，查找 SSE 数据块 */
-    for (size_t i = 0; i < realsize; i++) {
-        /* 将字符添加到缓冲区 */
-        if (stream_data->buffer_pos >= stream_data->buffer_size) {
-            /* 缓冲区扩展 */
-            size_t new_size = stream_data->buffer_size * 2;
-            if (new_size == 0) new_size = 1024;
-            char *new_buffer = (char *)realloc(stream_data->buffer, new_size);
-            if (!new_buffer) {
-                fprintf(stderr, "Error: Failed to realloc stream buffer\n");
-                return 0;
-            }
-            stream_data->buffer = new_buffer;
-            stream_data->buffer_size = new_size;
-        }
 
-        stream_data->buffer[stream_data->buffer_pos++] = data[i];
-
-        /* 检测数据块结束（双换行符） */
-        if (i > 0 && data[i] == '\n' && data[i-1] == '\n') {
-            /* 处理完整的数据块 */
-            process_sse_chunk(stream_data->buffer, stream_data->buffer_pos - 2, stream_data);
-            stream_data->buffer_pos = 0;
-        } else if (data[i] == '\n') {
-            /* 单个换行符，也可能是数据块结束 */
-            if (stream_data->buffer_pos > 1) {
-                process_sse_chunk(stream_data->buffer, stream_data->buffer_pos - 1, stream_data);
-                stream_data->buffer_pos = 0;
-            }
-        }
+    if (!sse_parser_feed(&stream_data->sse, (const char *)contents, realsize)) {
+        return 0;
+    }
+
+    /* 已收到完整命令：返回 0 让 curl 以 CURLE_WRITE_ERROR 中止传输 */
+    if (stream_data->stop_requested) {
+        return 0;
     }
 
     return realsize;
 }
 
 /* 流式 API 请求 */
-bool api_send_request_stream(const Config *cfg, const SystemInfo *sys_info,
+bool api_send_request_stream(GlmClient *client, const Config *cfg, const SystemInfo *sys_info,
                               const ConversationHistory *history,
                               const char *user_input, StreamCallback callback,
                               void *userdata, ApiResponse *response) {
@@ -683,81 +806,100 @@ bool api_send_request_stream(const Config *cfg, const SystemInfo *sys_info,
     struct curl_slist *headers = NULL;
     StreamCallbackData stream_data = {0};
 
+    RequestTimings *timings = &response->timings;
+    request_timings_reset(timings);
+    timings->start_ns = timing_now_ns();
+
     /* 初始化流式数据 */
     stream_data.callback = callback;
     stream_data.userdata = userdata;
-    stream_data.buffer = NULL;
-    stream_data.buffer_size = 0;
-    stream_data.buffer_pos = 0;
     stream_data.is_done = false;
+    stream_data.stop_after_command = cfg->stop_after_command;
+    stream_data.response = response;
+
+    /* 未提供长生命周期客户端时，为本次请求创建临时客户端 */
+    GlmClient *owned_client = NULL;
+    if (!client) {
+        owned_client = client_create();
+        client = owned_client;
+    }
 
-    /* 初始化 curl */
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
+    curl = client_acquire(client);
     if (!curl) {
         fprintf(stderr, "Error: Failed to initialize curl\n");
-        response->error_message = strdup("Failed to initialize curl");
+        response->error_message = arena_strdup(response->arena, "Failed to initialize curl");
+        client_destroy(owned_client);
         return false;
     }
 
-    /* 构建请求 URL */
-    char url[512];
-    snprintf(url, sizeof(url), "%s/chat/completions", cfg->endpoint);
-
     /* 构建流式请求体 */
-    char *request_body = build_request_body_stream(cfg, sys_info, history, user_input);
+    RequestOptions options;
+    request_options_init(&options, cfg, true);
+    char *request_body = build_request_body(response->arena, cfg, sys_info,
+                                            history, user_input, &options);
     if (!request_body) {
         fprintf(stderr, "Error: Failed to build request body\n");
-        response->error_message = strdup("Failed to build request body");
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
+        response->error_message = arena_strdup(response->arena, "Failed to build request body");
+        client_destroy(owned_client);
         return false;
     }
+    request_timings_mark(timings, &timings->body_built);
 
     if (cfg->verbose) {
         printf("\n=== Stream Request ===\n");
-        printf("URL: %s\n", url);
+        printf("URL: %s/chat/completions\n", cfg->endpoint);
         printf("Body: %s\n", request_body);
         printf("====================\n\n");
     }
 
-    /* 设置 headers */
-    char auth_header[256];
-    snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", cfg->api_key);
-    headers = curl_slist_append(headers, auth_header);
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-
-    /* 设置 curl 选项 */
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request_body);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, stream_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &stream_data);
-
-    /* 超时设置：使用低速超时而非总时间超时 */
-    /* 如果传输速度低于 1 byte/s 持续 cfg->timeout 秒，则判定为超时 */
-    /* 这样可以在有数据流时允许长时间运行（支持长时间推理） */
-    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);  /* 1 byte/s */
-    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, cfg->timeout);
-
-    /* 设置总体最大超时时间为配置值的 10 倍（作为安全网） */
-    /* 防止异常情况下无限等待 */
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, cfg->timeout * 10L);
+    headers = setup_request(curl, cfg, request_body);
+    transport.easy_setopt(curl, CURLOPT_WRITEFUNCTION, stream_write_callback);
+    transport.easy_setopt(curl, CURLOPT_WRITEDATA, &stream_data);
 
     /* 发送请求 */
-    res = curl_easy_perform(curl);
+    sse_parser_init(&stream_data.sse, response->arena, handle_sse_event, &stream_data);
+    delta_extractor_init(&stream_data.delta, response->arena);
+    cmd_extractor_init(&stream_data.commands, response->arena);
+    double perform_start = timing_ms_since(timings->start_ns);
+    TRACE_PROBE1(request_perform_start, 1);
+    res = cassette_perform(curl, cfg, user_input, true, request_body,
+                           stream_write_callback, &stream_data);
+    TRACE_PROBE1(request_perform_done, (int)res);
+    request_timings_mark(timings, &timings->end);
+    if (!cassette_replaying()) {
+        record_transfer_times(curl, timings, perform_start);
+    }
+
+    /* 主动中止：命令已经完整，剩余的说明文字不再需要 */
+    if (res == CURLE_WRITE_ERROR && stream_data.stop_requested) {
+        res = CURLE_OK;
+        response->truncated = true;
+        if (cfg->verbose) {
+            printf("\n[DEBUG] Stream stopped after the command block (stop_after_command)\n");
+        }
+        if (callback) {
+            callback("", STREAM_CONTENT_DONE, userdata);
+        }
+    } else if (res == CURLE_OK) {
+        sse_parser_finish(&stream_data.sse);
+        finish_answer(&stream_data);
+    }
 
-    /* 清理 */
-    free(request_body);
-    free(stream_data.buffer);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    curl_global_cleanup();
+    if (res == CURLE_OK) {
+        response->command = cmd_extractor_take(&stream_data.commands);
+    }
+
+    /* 清理（缓冲区都在 response->arena 中，这里只归还可复用的尾部空间） */
+    sse_parser_free(&stream_data.sse);
+    delta_extractor_free(&stream_data.delta);
+    cmd_extractor_free(&stream_data.commands);
+    transport.slist_free_all(headers);
+    client_destroy(owned_client);
 
     if (res != CURLE_OK) {
         fprintf(stderr, "Error: curl_easy_perform() failed: %s\n",
-                curl_easy_strerror(res));
-        response->error_message = strdup(curl_easy_strerror(res));
+                transport.easy_strerror(res));
+        response->error_message = arena_strdup(response->arena, transport.easy_strerror(res));
         return false;
     }
 
@@ -9,12 +9,16 @@
 #include "config.h"
 #include "system_info.h"
 #include "history.h"
+#include "client.h"
+#include "arena.h"
+#include "timing.h"
 #include <stdbool.h>
 
 /* 流式内容类型枚举 */
 typedef enum {
     STREAM_CONTENT_REASONING,  /* 思考过程 (reasoning_content) */
     STREAM_CONTENT_ANSWER,     /* 最终回答 (content) */
+    STREAM_CONTENT_COMMAND,    /* 命令代码块已闭合（content 为提取出的命令） */
     STREAM_CONTENT_DONE        /* 流式结束标记 */
 } StreamContentType;
 
@@ -25,31 +29,91 @@ typedef enum {
  */
 typedef void (*StreamCallback)(const char *content, StreamContentType content_type, void *userdata);
 
-/* API 响应结构体 */
+/* API 响应结构体
+ * 所有字符串字段以及请求期间的缓冲区都从 arena 分配，
+ * api_response_destroy 时一次性释放，调用者不应单独 free 这些字段。
+ */
 typedef struct {
+    Arena *arena;            /* 本次请求的内存池 */
     char *raw_response;
     char *thinking_process;
     char *command;
     bool success;
     char *error_message;
+    int prompt_tokens;       /* usage.prompt_tokens */
+    int completion_tokens;   /* usage.completion_tokens */
+    int total_tokens;        /* usage.total_tokens */
+    int cached_tokens;       /* usage.prompt_tokens_details.cached_tokens（命中提供方前缀缓存的部分） */
+    char *finish_reason;     /* choices[0].finish_reason */
+    bool truncated;          /* 收到命令后主动结束了流式传输（stop_after_command） */
+    bool cached;             /* 结果来自本地响应缓存，没有发送请求 */
+    char *cached_query;      /* 相似匹配命中的原查询（精确命中或未命中时为 NULL） */
+    double cache_similarity; /* 命中缓存时的相似度（精确命中为 1） */
+    RequestTimings timings;  /* 请求各阶段的时间线（--timings） */
 } ApiResponse;
 
+/* 写入回调函数结构体 */
+typedef struct {
+    Arena *arena;
+    char *data;
+    size_t size;
+    size_t capacity;
+} WriteCallbackData;
+
+/* 非流式请求：由调用者提供 easy 句柄并负责执行
+ * （单次请求使用 curl_easy_perform，批量模式交给 curl_multi 并发驱动）
+ */
+typedef struct {
+    CURL *curl;                     /* 调用者提供的 easy 句柄 */
+    struct curl_slist *headers;     /* 请求头 */
+    Arena *arena;                   /* 请求体和响应数据所在的内存池 */
+    char *request_body;             /* 请求体（须在请求完成前保持有效） */
+    WriteCallbackData response_data;/* 响应数据 */
+} ApiRequest;
+
 /* 函数声明 */
 ApiResponse* api_response_create(void);
 void api_response_destroy(ApiResponse *response);
-bool api_send_request(const Config *cfg, const SystemInfo *sys_info,
+
+/* client 为长生命周期客户端，传入 NULL 时为本次请求创建临时客户端 */
+bool api_send_request(GlmClient *client, const Config *cfg, const SystemInfo *sys_info,
                       const ConversationHistory *history,
                       const char *user_input, ApiResponse *response);
-bool api_send_request_stream(const Config *cfg, const SystemInfo *sys_info,
+bool api_send_request_stream(GlmClient *client, const Config *cfg, const SystemInfo *sys_info,
                               const ConversationHistory *history,
                               const char *user_input, StreamCallback callback,
                               void *userdata, ApiResponse *response);
-char* build_system_prompt(const SystemInfo *sys_info);
-char* build_request_body(const Config *cfg, const SystemInfo *sys_info,
+
+/* 非流式请求的分步接口
+ * 请求期间的内存从 arena 分配（通常传入 response->arena），
+ * 响应数据在 api_request_finish 中直接交给同一 arena 中的 response。
+ */
+bool api_request_prepare(ApiRequest *request, CURL *curl, Arena *arena, const Config *cfg,
+                         const SystemInfo *sys_info,
                          const ConversationHistory *history,
                          const char *user_input);
-char* build_request_body_stream(const Config *cfg, const SystemInfo *sys_info,
-                                 const ConversationHistory *history,
-                                 const char *user_input);
+bool api_request_finish(ApiRequest *request, CURLcode result, const Config *cfg,
+                        ApiResponse *response);
+void api_request_cleanup(ApiRequest *request);
+
+/* 解析非流式响应 JSON，提取思考过程、命令和 token 统计 */
+bool api_parse_response(const char *raw_response, ApiResponse *response);
+
+/* 请求体中的可选字段 */
+typedef struct {
+    bool stream;                  /* "stream" 字段 */
+    const char *thinking;         /* thinking.type（"enabled" / "disabled"），NULL 时不发送 */
+    const char *const *stop;      /* 停止序列（以 NULL 结尾），NULL 时不发送 */
+    const char *response_format;  /* response_format.type（如 "json_object"），NULL 时不发送 */
+} RequestOptions;
+
+/* 请求体构建：返回的字符串从 arena 分配（arena 为 NULL 时由调用者 free）
+ * build_request_body 直接把系统提示词、历史和用户输入序列化为 JSON 文本，
+ * options 为 NULL 时只发送基本字段（非流式）。
+ */
+char* build_system_prompt(Arena *arena, const SystemInfo *sys_info);
+char* build_request_body(Arena *arena, const Config *cfg, const SystemInfo *sys_info,
+                         const ConversationHistory *history,
+                         const char *user_input, const RequestOptions *options);
 
 #endif /* API_H */
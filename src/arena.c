@@ -0,0 +1,184 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Request Arena Allocator Implementation
+ *===========================================================================*/
+
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 分配对齐（满足 long double / SSE 类型） */
+#define ARENA_ALIGN 16
+#define ALIGN_UP(n) (((n) + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1))
+#define BLOCK_HEADER ALIGN_UP(sizeof(ArenaBlock))
+#define BLOCK_DATA(block) ((char *)(block) + BLOCK_HEADER)
+
+/* 调试模式：记录分配以便在 arena_destroy 时释放 */
+static void* tracked_alloc(Arena *arena, size_t size) {
+    if (arena->tracked_count >= arena->tracked_cap) {
+        size_t new_cap = arena->tracked_cap ? arena->tracked_cap * 2 : 64;
+        void **new_tracked = (void **)realloc(arena->tracked, new_cap * sizeof(void *));
+        if (!new_tracked) return NULL;
+        arena->tracked = new_tracked;
+        arena->tracked_cap = new_cap;
+    }
+
+    void *ptr = malloc(size ? size : 1);
+    if (ptr) {
+        arena->tracked[arena->tracked_count++] = ptr;
+    }
+    return ptr;
+}
+
+static void* tracked_resize(Arena *arena, void *ptr, size_t new_size) {
+    for (size_t i = arena->tracked_count; i > 0; i--) {
+        if (arena->tracked[i - 1] == ptr) {
+            void *new_ptr = realloc(ptr, new_size ? new_size : 1);
+            if (new_ptr) arena->tracked[i - 1] = new_ptr;
+            return new_ptr;
+        }
+    }
+    return NULL;
+}
+
+/* 分配一个新块；普通块成为当前块，超大块挂在当前块之后单独使用 */
+static ArenaBlock* add_block(Arena *arena, size_t min_size, bool dedicated) {
+    size_t size = min_size > arena->block_size ? min_size : arena->block_size;
+
+    ArenaBlock *block = (ArenaBlock *)malloc(BLOCK_HEADER + size);
+    if (!block) {
+        fprintf(stderr, "Error: Failed to allocate arena block\n");
+        return NULL;
+    }
+    block->size = size;
+    block->used = 0;
+
+    if (dedicated && arena->head) {
+        block->next = arena->head->next;
+        arena->head->next = block;
+    } else {
+        block->next = arena->head;
+        arena->head = block;
+    }
+    return block;
+}
+
+Arena* arena_create(size_t block_size) {
+    Arena *arena = (Arena *)calloc(1, sizeof(Arena));
+    if (!arena) {
+        fprintf(stderr, "Error: Failed to allocate memory for arena\n");
+        return NULL;
+    }
+
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+
+    const char *debug = getenv("GLM_CMD_ARENA_DEBUG");
+    arena->passthrough = debug && (strcmp(debug, "1") == 0 || strcmp(debug, "true") == 0);
+
+    return arena;
+}
+
+void arena_destroy(Arena *arena) {
+    if (!arena) return;
+
+    ArenaBlock *block = arena->head;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    for (size_t i = 0; i < arena->tracked_count; i++) {
+        free(arena->tracked[i]);
+    }
+    free(arena->tracked);
+
+    free(arena);
+}
+
+void* arena_alloc(Arena *arena, size_t size) {
+    if (!arena) return malloc(size ? size : 1);
+    if (arena->passthrough) return tracked_alloc(arena, size);
+
+    ArenaBlock *block = arena->head;
+    size_t offset = block ? ALIGN_UP(block->used) : 0;
+
+    if (!block || offset + size > block->size) {
+        /* 超过块大小一半的分配使用独立块，避免浪费当前块的剩余空间 */
+        bool dedicated = size > arena->block_size / 2;
+        block = add_block(arena, size, dedicated);
+        if (!block) return NULL;
+        offset = 0;
+    }
+
+    void *ptr = BLOCK_DATA(block) + offset;
+    block->used = offset + size;
+
+    /* 只有当前块中的最近一次分配可以原地扩展 */
+    if (block == arena->head) {
+        arena->last = ptr;
+        arena->last_size = size;
+    } else {
+        arena->last = NULL;
+        arena->last_size = 0;
+    }
+
+    return ptr;
+}
+
+char* arena_strndup(Arena *arena, const char *str, size_t len) {
+    if (!str) return NULL;
+
+    char *copy = (char *)arena_alloc(arena, len + 1);
+    if (!copy) return NULL;
+
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char* arena_strdup(Arena *arena, const char *str) {
+    if (!str) return NULL;
+    return arena_strndup(arena, str, strlen(str));
+}
+
+void* arena_resize(Arena *arena, void *ptr, size_t old_size, size_t new_size) {
+    if (!arena) return realloc(ptr, new_size ? new_size : 1);
+    if (!ptr) return arena_alloc(arena, new_size);
+    if (arena->passthrough) return tracked_resize(arena, ptr, new_size);
+
+    /* 最近一次分配：在当前块内原地扩展 */
+    ArenaBlock *block = arena->head;
+    if (ptr == arena->last && block) {
+        size_t offset = (size_t)((char *)ptr - BLOCK_DATA(block));
+        if (offset + new_size <= block->size) {
+            block->used = offset + new_size;
+            arena->last_size = new_size;
+            return ptr;
+        }
+    }
+
+    if (new_size <= old_size) return ptr;
+
+    void *new_ptr = arena_alloc(arena, new_size);
+    if (!new_ptr) return NULL;
+
+    memcpy(new_ptr, ptr, old_size);
+    return new_ptr;
+}
+
+void arena_free(Arena *arena, void *ptr) {
+    if (!ptr) return;
+    if (!arena) {
+        free(ptr);
+        return;
+    }
+
+    /* 最近一次分配可以直接回收，其余随 arena 一起释放 */
+    if (!arena->passthrough && ptr == arena->last && arena->head) {
+        arena->head->used = (size_t)((char *)ptr - BLOCK_DATA(arena->head));
+        arena->last = NULL;
+        arena->last_size = 0;
+    }
+}
@@ -0,0 +1,56 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Request Arena Allocator Header
+ *===========================================================================*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* 默认块大小 */
+#define ARENA_DEFAULT_BLOCK_SIZE (16 * 1024)
+
+/* 内存块（链表，从大块中顺序分配） */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+/* 请求级别的 bump 分配器
+ * 一次查询中的请求体、响应数据、流式缓冲区和提取结果都从同一个 arena 分配，
+ * 请求结束时调用 arena_destroy 一次性释放，不需要逐个 free。
+ * 设置环境变量 GLM_CMD_ARENA_DEBUG=1 时每次分配都直接调用 malloc，
+ * 便于用 valgrind / AddressSanitizer 检查越界。
+ */
+typedef struct {
+    ArenaBlock *head;           /* 当前块 */
+    size_t block_size;          /* 新块的默认大小 */
+    void *last;                 /* 最近一次分配（可原地扩展） */
+    size_t last_size;
+    bool passthrough;           /* 调试模式：每次分配都使用 malloc */
+    void **tracked;             /* 调试模式下记录的分配 */
+    size_t tracked_count;
+    size_t tracked_cap;
+} Arena;
+
+/* 函数声明 */
+Arena* arena_create(size_t block_size);
+void arena_destroy(Arena *arena);
+
+/* 分配对齐的内存（内容未初始化），失败时返回 NULL */
+void* arena_alloc(Arena *arena, size_t size);
+char* arena_strdup(Arena *arena, const char *str);
+char* arena_strndup(Arena *arena, const char *str, size_t len);
+
+/* 调整分配大小：最近一次分配可原地扩展，否则复制到新位置
+ * arena 为 NULL 时退化为 realloc，方便模块同时支持两种用法
+ */
+void* arena_resize(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+/* 释放：arena 为 NULL 时调用 free，否则为空操作（随 arena 一起释放） */
+void arena_free(Arena *arena, void *ptr);
+
+#endif /* ARENA_H */
@@ -0,0 +1,404 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Concurrent Batch Mode Implementation
+ *===========================================================================*/
+
+#include "batch.h"
+#include "api.h"
+#include "transport.h"
+#include "probes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 尝试多种可能的 cJSON 头文件路径
+#if __has_include(<cjson/cJSON.h>)
+    #include <cjson/cJSON.h>
+#elif __has_include(<cJSON.h>)
+    #include <cJSON.h>
+#else
+    #include <cjson/cJSON.h>
+#endif
+
+/* 批量查询列表 */
+typedef struct {
+    char **queries;
+    size_t count;
+    size_t capacity;
+} BatchInput;
+
+/* 并发槽位：每个槽位持有一个可复用的 easy 句柄 */
+typedef struct {
+    CURL *curl;
+    ApiRequest request;
+    ApiResponse *response;  /* 请求期间的内存都在 response->arena 中 */
+    size_t index;       /* 当前查询在输入中的序号 */
+    bool busy;
+} BatchSlot;
+
+/* 去除行首尾空白（原地修改），返回新的起始位置 */
+static char* trim_line(char *line) {
+    while (*line == ' ' || *line == '\t') line++;
+
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' ||
+                       line[len - 1] == ' ' || line[len - 1] == '\t')) {
+        line[--len] = '\0';
+    }
+    return line;
+}
+
+/* 解析一行输入：JSON 对象取 "query"（或 "input"）字段，JSON 字符串取其值，其余按纯文本处理 */
+static char* parse_query_line(const char *line) {
+    if (line[0] == '{' || line[0] == '"') {
+        cJSON *json = cJSON_Parse(line);
+        if (json) {
+            const cJSON *value = json;
+            if (cJSON_IsObject(json)) {
+                value = cJSON_GetObjectItem(json, "query");
+                if (!value) value = cJSON_GetObjectItem(json, "input");
+            }
+
+            char *query = NULL;
+            if (value && cJSON_IsString(value) && value->valuestring[0] != '\0') {
+                query = strdup(value->valuestring);
+            }
+            cJSON_Delete(json);
+            return query;
+        }
+    }
+
+    return strdup(line);
+}
+
+static bool batch_input_add(BatchInput *input, char *query) {
+    if (input->count >= input->capacity) {
+        size_t new_capacity = input->capacity ? input->capacity * 2 : 64;
+        char **new_queries = (char **)realloc(input->queries, new_capacity * sizeof(char *));
+        if (!new_queries) {
+            fprintf(stderr, "Error: Failed to allocate memory for batch input\n");
+            return false;
+        }
+        input->queries = new_queries;
+        input->capacity = new_capacity;
+    }
+
+    input->queries[input->count++] = query;
+    return true;
+}
+
+static void batch_input_free(BatchInput *input) {
+    for (size_t i = 0; i < input->count; i++) {
+        free(input->queries[i]);
+    }
+    free(input->queries);
+}
+
+/* 读取一整行到可增长的缓冲区（不限制行长）
+ * 返回 1 表示读到一行，0 表示文件结束，-1 表示内存不足
+ */
+static int read_line(FILE *fp, char **buf, size_t *cap) {
+    size_t len = 0;
+    for (;;) {
+        if (*cap - len < 2) {
+            size_t new_cap = *cap ? *cap * 2 : 8192;
+            char *new_buf = (char *)realloc(*buf, new_cap);
+            if (!new_buf) {
+                fprintf(stderr, "Error: Failed to allocate memory for batch input\n");
+                return -1;
+            }
+            *buf = new_buf;
+            *cap = new_cap;
+        }
+
+        if (!fgets(*buf + len, (int)(*cap - len), fp)) return len > 0 ? 1 : 0;
+        len += strlen(*buf + len);
+        if (len > 0 && (*buf)[len - 1] == '\n') return 1;
+    }
+}
+
+/* 读取批量输入文件 */
+static bool batch_input_load(const char *path, BatchInput *input) {
+    FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open batch file: %s\n", path);
+        return false;
+    }
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    size_t line_number = 0;
+    bool ok = true;
+
+    int status;
+    while ((status = read_line(fp, &line, &line_cap)) > 0) {
+        line_number++;
+
+        char *text = trim_line(line);
+        if (text[0] == '\0') continue;
+
+        char *query = parse_query_line(text);
+        if (!query) {
+            fprintf(stderr, "Warning: Skipping line %zu: no query found\n", line_number);
+            continue;
+        }
+
+        if (!batch_input_add(input, query)) {
+            free(query);
+            ok = false;
+            break;
+        }
+    }
+
+    if (status < 0) ok = false;
+
+    free(line);
+    if (fp != stdin) fclose(fp);
+    return ok;
+}
+
+/* 输出一条结果（JSON Lines） */
+static void emit_result(FILE *out, size_t index, const char *query,
+                        const ApiResponse *response, double latency_ms) {
+    cJSON *result = cJSON_CreateObject();
+    if (!result) return;
+
+    cJSON_AddNumberToObject(result, "index", (double)index);
+    cJSON_AddStringToObject(result, "query", query);
+
+    if (response->command) {
+        cJSON_AddStringToObject(result, "command", response->command);
+    } else {
+        cJSON_AddNullToObject(result, "command");
+    }
+
+    if (response->thinking_process) {
+        cJSON_AddStringToObject(result, "thinking", response->thinking_process);
+    } else {
+        cJSON_AddNullToObject(result, "thinking");
+    }
+
+    /* 保留一位小数 */
+    cJSON_AddNumberToObject(result, "latency_ms", (double)(long)(latency_ms * 10.0 + 0.5) / 10.0);
+
+    cJSON *usage = cJSON_CreateObject();
+    if (usage) {
+        cJSON_AddNumberToObject(usage, "prompt_tokens", response->prompt_tokens);
+        cJSON_AddNumberToObject(usage, "completion_tokens", response->completion_tokens);
+        cJSON_AddNumberToObject(usage, "total_tokens", response->total_tokens);
+        cJSON_AddNumberToObject(usage, "cached_tokens", response->cached_tokens);
+        cJSON_AddItemToObject(result, "usage", usage);
+    }
+
+    if (!response->success) {
+        cJSON_AddStringToObject(result, "error",
+                                response->error_message ? response->error_message
+                                                        : "Unknown error");
+    } else {
+        cJSON_AddNullToObject(result, "error");
+    }
+
+    char *line = cJSON_PrintUnformatted(result);
+    if (line) {
+        fprintf(out, "%s\n", line);
+        fflush(out);
+        free(line);
+    }
+    cJSON_Delete(result);
+}
+
+/* 在空闲槽位上启动一条查询 */
+static bool start_query(CURLM *multi, BatchSlot *slot, size_t index,
+                        const BatchInput *input, const Config *cfg,
+                        const SystemInfo *sys_info) {
+    transport.easy_reset(slot->curl);
+
+    slot->response = api_response_create();
+    if (!slot->response) return false;
+
+    if (!api_request_prepare(&slot->request, slot->curl, slot->response->arena, cfg,
+                             sys_info, NULL, input->queries[index])) {
+        api_request_cleanup(&slot->request);
+        api_response_destroy(slot->response);
+        slot->response = NULL;
+        return false;
+    }
+
+    transport.easy_setopt(slot->curl, CURLOPT_PRIVATE, (void *)slot);
+    transport.easy_setopt(slot->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+#ifdef CURLPIPE_MULTIPLEX
+    /* HTTPS 端点可能通过 ALPN 协商 HTTP/2：等待已有连接以便多路复用，而不是新建连接 */
+    if (strncmp(cfg->endpoint, "https://", 8) == 0) {
+        transport.easy_setopt(slot->curl, CURLOPT_PIPEWAIT, 1L);
+    }
+#endif
+
+    slot->index = index;
+    slot->busy = true;
+    TRACE_PROBE1(request_perform_start, 2);
+    transport.multi_add_handle(multi, slot->curl);
+    return true;
+}
+
+bool batch_run(Session *session, const char *path, int jobs, FILE *out) {
+    if (!session || !session->cfg || !path || !out) {
+        fprintf(stderr, "Error: Invalid parameters\n");
+        return false;
+    }
+
+    if (jobs < 1) jobs = 1;
+    if (jobs > BATCH_MAX_JOBS) jobs = BATCH_MAX_JOBS;
+
+    BatchInput input = {0};
+    if (!batch_input_load(path, &input)) {
+        batch_input_free(&input);
+        return false;
+    }
+
+    if (input.count == 0) {
+        fprintf(stderr, "Warning: No queries found in %s\n", path);
+        batch_input_free(&input);
+        return true;
+    }
+
+    if ((size_t)jobs > input.count) jobs = (int)input.count;
+
+    /* 批量模式固定使用非流式请求；详细输出会与 JSON 结果混在一起，因此关闭 */
+    Config cfg = *session->cfg;
+    cfg.verbose = false;
+
+    /* 确保 curl 全局初始化（由会话客户端负责） */
+    if (!session->client) {
+        session->client = client_create();
+        if (!session->client) {
+            batch_input_free(&input);
+            return false;
+        }
+    }
+
+    CURLM *multi = transport.multi_init();
+    BatchSlot *slots = (BatchSlot *)calloc((size_t)jobs, sizeof(BatchSlot));
+    if (!multi || !slots) {
+        fprintf(stderr, "Error: Failed to initialize batch transfer\n");
+        if (multi) transport.multi_cleanup(multi);
+        free(slots);
+        batch_input_free(&input);
+        return false;
+    }
+
+    /* 同一主机的并发连接数不超过 jobs；HTTP/2 下优先多路复用 */
+#ifdef CURLPIPE_MULTIPLEX
+    transport.multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+    transport.multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)jobs);
+
+    bool ok = true;
+    for (int i = 0; i < jobs; i++) {
+        slots[i].curl = transport.easy_init();
+        if (!slots[i].curl) {
+            fprintf(stderr, "Error: Failed to initialize curl\n");
+            ok = false;
+            break;
+        }
+    }
+
+    size_t next = 0;
+    size_t completed = 0;
+    size_t failed = 0;
+    int active = 0;
+
+    while (ok && completed < input.count) {
+        /* 填满空闲槽位 */
+        for (int i = 0; i < jobs && next < input.count; i++) {
+            if (slots[i].busy) continue;
+
+            size_t index = next++;
+            if (!start_query(multi, &slots[i], index, &input, &cfg, session->sys_info)) {
+                ApiResponse *response = api_response_create();
+                if (response) {
+                    response->error_message = arena_strdup(response->arena,
+                                                           "Failed to build request body");
+                    emit_result(out, index, input.queries[index], response, 0);
+                    api_response_destroy(response);
+                }
+                failed++;
+                completed++;
+                continue;
+            }
+            active++;
+        }
+
+        if (active == 0) continue;
+
+        int still_running = 0;
+        CURLMcode mc = transport.multi_perform(multi, &still_running);
+        if (mc != CURLM_OK) {
+            fprintf(stderr, "Error: curl_multi_perform() failed: %s\n",
+                    transport.multi_strerror(mc));
+            ok = false;
+            break;
+        }
+
+        /* 处理已完成的传输 */
+        CURLMsg *msg;
+        int msgs_left = 0;
+        while ((msg = transport.multi_info_read(multi, &msgs_left))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            BatchSlot *slot = NULL;
+            transport.easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&slot);
+            if (!slot) continue;
+            TRACE_PROBE1(request_perform_done, (int)msg->data.result);
+
+            double total_time = 0;
+            transport.easy_getinfo(slot->curl, CURLINFO_TOTAL_TIME, &total_time);
+
+            ApiResponse *response = slot->response;
+            api_request_finish(&slot->request, msg->data.result, &cfg, response);
+            emit_result(out, slot->index, input.queries[slot->index],
+                        response, total_time * 1000.0);
+            if (!response->success) failed++;
+
+            transport.multi_remove_handle(multi, slot->curl);
+            api_request_cleanup(&slot->request);
+
+            /* 一次释放本条查询的请求体、响应数据和提取结果 */
+            api_response_destroy(response);
+            slot->response = NULL;
+            slot->busy = false;
+            active--;
+            completed++;
+        }
+
+        /* 等待套接字活动（有空闲槽位且尚有查询时立即回到循环补充） */
+        if (still_running && !(active < jobs && next < input.count)) {
+            mc = transport.multi_poll(multi, NULL, 0, 1000, NULL);
+            if (mc != CURLM_OK) {
+                fprintf(stderr, "Error: curl_multi_poll() failed: %s\n",
+                        transport.multi_strerror(mc));
+                ok = false;
+            }
+        }
+    }
+
+    /* 清理 */
+    for (int i = 0; i < jobs; i++) {
+        if (!slots[i].curl) continue;
+        if (slots[i].busy) {
+            transport.multi_remove_handle(multi, slots[i].curl);
+            api_request_cleanup(&slots[i].request);
+            api_response_destroy(slots[i].response);
+        }
+        transport.easy_cleanup(slots[i].curl);
+    }
+    free(slots);
+    transport.multi_cleanup(multi);
+
+    if (session->cfg->verbose) {
+        fprintf(stderr, "Batch complete: %zu queries, %zu failed, %d parallel jobs\n",
+                input.count, failed, jobs);
+    }
+
+    batch_input_free(&input);
+    return ok && failed == 0;
+}
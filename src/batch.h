@@ -0,0 +1,27 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Concurrent Batch Mode Header
+ *===========================================================================*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "session.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+/* 默认并发数 */
+#define BATCH_DEFAULT_JOBS 4
+/* 最大并发数 */
+#define BATCH_MAX_JOBS 64
+
+/* 批量翻译文件中的查询（每行一条，"-" 表示标准输入）
+ * 输入行可以是纯文本、JSON 字符串，或包含 "query" 字段的 JSON 对象。
+ * 请求通过 curl_multi 事件循环并发发送，最多同时进行 jobs 个；
+ * 每完成一条即向 out 写出一行 JSON 结果（按完成顺序，index 为输入行序号）。
+ * 批量查询相互独立：不附带也不写入对话历史。
+ * 全部查询成功时返回 true。
+ */
+bool batch_run(Session *session, const char *path, int jobs, FILE *out);
+
+#endif /* BATCH_H */
@@ -0,0 +1,996 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Response Cache Implementation
+ *===========================================================================*/
+
+#include "cache.h"
+#include "hash.h"
+#include "file_lock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <direct.h>
+    #include <io.h>
+    #include <windows.h>
+    #define open_cross(path, flags) _open(path, (flags) | _O_BINARY, _S_IREAD | _S_IWRITE)
+    #define close_cross(fd) _close(fd)
+    #define fdopen_cross(fd, mode) _fdopen(fd, mode)
+    #define mkdir_cross(path) _mkdir(path)
+#else
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #define open_cross(path, flags) open(path, flags, 0600)
+    #define close_cross(fd) close(fd)
+    #define fdopen_cross(fd, mode) fdopen(fd, mode)
+    #define mkdir_cross(path) mkdir(path, 0755)
+#endif
+
+/* 键的格式变化时修改，使旧条目不再命中 */
+#define CACHE_KEY_VERSION "glm-cmd-cache-1"
+
+/* 文件格式（本机字节序，文件只在本机使用） */
+#define CACHE_INDEX_MAGIC "GLMRCI1"
+#define CACHE_HEAP_MAGIC "GLMRCH1"
+#define CACHE_FORMAT_VERSION 2
+#define CACHE_INITIAL_BUCKETS 64
+#define CACHE_MAX_VALUE (16 * 1024 * 1024)
+
+/* 相似匹配：查询按字符切成 CACHE_SHINGLE-gram，MinHash 签名分成 CACHE_BANDS 段、
+ * 每段 CACHE_ROWS 个值（LSH）；任一段完全相同的条目成为候选，再计算精确的 Jaccard 相似度。
+ * 相似度为 s 的条目成为候选的概率为 1 - (1 - s^4)^8：0.7 时约 88%，0.8 时约 98%。
+ */
+#define CACHE_SHINGLE 3
+#define CACHE_BANDS 8
+#define CACHE_ROWS 4
+#define CACHE_SIGNATURE (CACHE_BANDS * CACHE_ROWS)
+#define CACHE_MAX_CANDIDATES 64
+#define CACHE_MAX_VERIFY 16
+/* 同一个段哈希最多的槽数：模板化的查询（"show disk usage of project N"）中
+ * 只由公共部分组成的段没有区分度，不再继续加入，探测长度因此有上限
+ */
+#define CACHE_BAND_LIMIT 16
+
+/* 索引文件头（64 字节） */
+typedef struct {
+    char magic[8];             /* CACHE_INDEX_MAGIC */
+    uint32_t version;          /* CACHE_FORMAT_VERSION */
+    uint32_t bucket_count;     /* 桶数（2 的幂） */
+    uint32_t max_load;         /* 最大装载率（百分比） */
+    uint32_t used;             /* 已占用的桶（含已删除） */
+    uint32_t live;             /* 有效条目数 */
+    uint32_t bands;            /* 每个桶对应的 LSH 槽数（CACHE_BANDS） */
+    uint64_t heap_id;          /* 值堆标识，与值堆文件头一致时才使用 */
+    uint64_t heap_live;        /* 有效条目在值堆中占用的字节数 */
+    uint8_t reserved[16];
+} CacheIndexHeader;
+
+/* 桶（24 字节）：key 为 0 表示空桶，offset 为 0 表示已删除 */
+typedef struct {
+    uint64_t key;
+    uint64_t offset;           /* 记录在值堆中的偏移 */
+    uint32_t created;          /* 生成时间 */
+    uint32_t last_used;        /* 最近使用时间（LRU） */
+} CacheBucket;
+
+/* LSH 槽（8 字节），位于桶数组之后，共 bucket_count * bands 个
+ * bucket 为桶下标 + 1，0 表示空槽；同一个段哈希可以有多个槽（线性探测）
+ */
+typedef struct {
+    uint32_t hash;             /* 上下文、段号和该段签名的哈希 */
+    uint32_t bucket;
+} CacheBandSlot;
+
+/* 值堆文件头（16 字节） */
+typedef struct {
+    char magic[8];             /* CACHE_HEAP_MAGIC */
+    uint64_t heap_id;
+} CacheHeapHeader;
+
+/* 值记录头（32 字节），之后依次是以 '\0' 结尾的查询、命令和思考过程，补齐到 8 字节 */
+typedef struct {
+    uint64_t key;
+    uint64_t context;          /* response_cache_context，0 表示不参与相似匹配 */
+    uint32_t query_len;
+    uint32_t command_len;
+    uint32_t thinking_len;
+    uint32_t reserved;
+} CacheValueHeader;
+
+_Static_assert(sizeof(CacheIndexHeader) == 64, "cache index header must be 64 bytes");
+_Static_assert(sizeof(CacheBucket) == 24, "cache bucket must be 24 bytes");
+_Static_assert(sizeof(CacheBandSlot) == 8, "cache band slot must be 8 bytes");
+_Static_assert(sizeof(CacheHeapHeader) == 16, "cache heap header must be 16 bytes");
+_Static_assert(sizeof(CacheValueHeader) == 32, "cache value header must be 32 bytes");
+
+/* 打开并映射的索引和值堆 */
+typedef struct CacheTable {
+    int index_fd;
+    int heap_fd;
+    CacheIndexHeader *header;  /* 映射的起始位置 */
+    CacheBucket *buckets;
+    CacheBandSlot *bands;      /* LSH 槽，紧跟在桶数组之后 */
+    size_t map_size;
+    bool writable;             /* 以读写方式映射（可以更新最近使用时间） */
+#ifdef _WIN32
+    HANDLE mapping;
+#else
+    dev_t dev;                 /* 用于发现索引已被替换 */
+    ino_t ino;
+#endif
+} CacheTable;
+
+/* 桶和 LSH 槽的并发访问：写入端最后以 release 写入键、偏移和槽的桶号，读取端以 acquire 读取 */
+static inline uint64_t load_u64(const uint64_t *p) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+    return *(const volatile uint64_t *)p;
+#endif
+}
+
+static inline void store_u64(uint64_t *p, uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+#else
+    *(volatile uint64_t *)p = value;
+#endif
+}
+
+static inline uint32_t load_u32(const uint32_t *p) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+    return *(const volatile uint32_t *)p;
+#endif
+}
+
+static inline void store_u32(uint32_t *p, uint32_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+#else
+    *(volatile uint32_t *)p = value;
+#endif
+}
+
+ResponseCache* response_cache_create(const char *config_dir, int ttl, int max_entries) {
+    if (!config_dir) return NULL;
+
+    ResponseCache *cache = (ResponseCache *)calloc(1, sizeof(ResponseCache));
+    if (!cache) {
+        fprintf(stderr, "Error: Failed to allocate memory for response cache\n");
+        return NULL;
+    }
+
+    size_t path_len = strlen(config_dir) + 32;
+    cache->index_file = (char *)malloc(path_len);
+    cache->heap_file = (char *)malloc(path_len);
+    cache->lock_file = (char *)malloc(path_len);
+    if (!cache->index_file || !cache->heap_file || !cache->lock_file) {
+        response_cache_destroy(cache);
+        return NULL;
+    }
+    snprintf(cache->index_file, path_len, "%s/response_cache.idx", config_dir);
+    snprintf(cache->heap_file, path_len, "%s/response_cache.heap", config_dir);
+    snprintf(cache->lock_file, path_len, "%s/response_cache.lock", config_dir);
+
+    cache->ttl = ttl > 0 ? ttl : 0;
+    cache->max_entries = max_entries > 0 ? max_entries : DEFAULT_CACHE_MAX_ENTRIES;
+    return cache;
+}
+
+static void table_close(CacheTable *table);
+
+void response_cache_destroy(ResponseCache *cache) {
+    if (!cache) return;
+
+    table_close(cache->reader);
+    free(cache->index_file);
+    free(cache->heap_file);
+    free(cache->lock_file);
+    free(cache);
+}
+
+/* 结尾可以去掉的标点（包括全角的句号、问号和感叹号） */
+static size_t trailing_punct(const char *str, size_t len) {
+    static const char *const marks[] = { ".", "?", "!", "\xe3\x80\x82", "\xef\xbc\x9f",
+                                         "\xef\xbc\x81", NULL };
+    for (int i = 0; marks[i]; i++) {
+        size_t mark_len = strlen(marks[i]);
+        if (len >= mark_len && memcmp(str + len - mark_len, marks[i], mark_len) == 0) {
+            return mark_len;
+        }
+    }
+    return 0;
+}
+
+char* response_cache_normalize(Arena *arena, const char *user_input) {
+    if (!user_input) return NULL;
+
+    char *out = (char *)arena_alloc(arena, strlen(user_input) + 1);
+    if (!out) return NULL;
+
+    size_t len = 0;
+    bool pending_space = false;
+    for (const unsigned char *p = (const unsigned char *)user_input; *p; p++) {
+        if (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\f' || *p == '\v') {
+            pending_space = len > 0;
+            continue;
+        }
+        if (pending_space) out[len++] = ' ';
+        pending_space = false;
+        out[len++] = (*p >= 'A' && *p <= 'Z') ? (char)(*p + ('a' - 'A')) : (char)*p;
+    }
+
+    /* "查找大文件？" 与 "查找大文件" 视为同一个查询 */
+    size_t mark;
+    while ((mark = trailing_punct(out, len)) > 0 || (len > 0 && out[len - 1] == ' ')) {
+        len -= mark > 0 ? mark : 1;
+    }
+
+    out[len] = '\0';
+    return out;
+}
+
+uint64_t response_cache_context(const Config *cfg, const char *sys_context) {
+    uint64_t hash = hash_fnv1a_str(HASH_FNV_OFFSET, CACHE_KEY_VERSION);
+    hash = hash_fnv1a_str(hash, cfg ? cfg->model : NULL);
+    hash = hash_fnv1a_str(hash, cfg ? cfg->user_prompt : NULL);
+    hash = hash_fnv1a_str(hash, sys_context);
+
+    /* 0 表示没有上下文（不参与相似匹配） */
+    return hash ? hash : 1;
+}
+
+uint64_t response_cache_key(const char *normalized, const Config *cfg, const char *sys_context) {
+    uint64_t hash = hash_fnv1a_str(HASH_FNV_OFFSET, CACHE_KEY_VERSION);
+    hash = hash_fnv1a_str(hash, normalized);
+    hash = hash_fnv1a_str(hash, cfg ? cfg->model : NULL);
+    hash = hash_fnv1a_str(hash, cfg ? cfg->user_prompt : NULL);
+    hash = hash_fnv1a_str(hash, sys_context);
+
+    /* 0 表示空桶 */
+    return hash ? hash : 1;
+}
+
+static bool write_all(int fd, const void *data, size_t len) {
+    const char *p = (const char *)data;
+    while (len > 0) {
+#ifdef _WIN32
+        int n = _write(fd, p, (unsigned int)len);
+#else
+        ssize_t n = write(fd, p, len);
+#endif
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool read_at(int fd, void *buf, size_t len, uint64_t offset) {
+    char *p = (char *)buf;
+    while (len > 0) {
+#ifdef _WIN32
+        if (_lseeki64(fd, (__int64)offset, SEEK_SET) < 0) return false;
+        int n = _read(fd, p, (unsigned int)len);
+#else
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+#endif
+        if (n <= 0) return false;
+        p += n;
+        offset += (uint64_t)n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* 查询的字符 n-gram 哈希（按 UTF-8 字符切分，不足 n 个字符时整个查询作为一个），
+ * 排序去重后写入 *out（调用者释放），返回个数
+ */
+static size_t query_shingles(const char *query, size_t len, uint32_t **out) {
+    *out = NULL;
+    if (len == 0) return 0;
+
+    /* 每个字符的起始位置 */
+    size_t *starts = (size_t *)malloc((len + 1) * sizeof(size_t));
+    uint32_t *shingles = (uint32_t *)malloc(len * sizeof(uint32_t));
+    if (!starts || !shingles) {
+        free(starts);
+        free(shingles);
+        return 0;
+    }
+
+    size_t chars = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (((unsigned char)query[i] & 0xC0) != 0x80) starts[chars++] = i;
+    }
+    starts[chars] = len;
+
+    size_t count = 0;
+    size_t n = chars < CACHE_SHINGLE ? chars : CACHE_SHINGLE;
+    for (size_t i = 0; i + n <= chars; i++) {
+        uint64_t hash = hash_fnv1a(HASH_FNV_OFFSET, query + starts[i], starts[i + n] - starts[i]);
+        shingles[count++] = (uint32_t)(hash ^ (hash >> 32));
+    }
+    free(starts);
+
+    /* 插入排序后去重（查询通常只有几十个字符） */
+    for (size_t i = 1; i < count; i++) {
+        uint32_t value = shingles[i];
+        size_t j = i;
+        while (j > 0 && shingles[j - 1] > value) {
+            shingles[j] = shingles[j - 1];
+            j--;
+        }
+        shingles[j] = value;
+    }
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (unique == 0 || shingles[unique - 1] != shingles[i]) shingles[unique++] = shingles[i];
+    }
+
+    *out = shingles;
+    return unique;
+}
+
+/* 两个有序集合的 Jaccard 相似度 */
+static double jaccard(const uint32_t *a, size_t a_count, const uint32_t *b, size_t b_count) {
+    size_t i = 0, j = 0, common = 0;
+    while (i < a_count && j < b_count) {
+        if (a[i] == b[j]) {
+            common++;
+            i++;
+            j++;
+        } else if (a[i] < b[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+
+    size_t total = a_count + b_count - common;
+    return total > 0 ? (double)common / (double)total : 0.0;
+}
+
+/* 第 k 个 MinHash 函数（splitmix64） */
+static inline uint32_t minhash_mix(uint32_t shingle, int k) {
+    uint64_t x = shingle + (uint64_t)(k + 1) * 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return (uint32_t)(x ^ (x >> 31));
+}
+
+/* 计算每一段的 LSH 哈希（同时混入上下文和段号），没有 n-gram 时返回 false */
+static bool band_hashes(const uint32_t *shingles, size_t count, uint64_t context,
+                        uint32_t hashes[CACHE_BANDS]) {
+    if (count == 0) return false;
+
+    uint32_t signature[CACHE_SIGNATURE];
+    for (int k = 0; k < CACHE_SIGNATURE; k++) signature[k] = UINT32_MAX;
+    for (size_t i = 0; i < count; i++) {
+        for (int k = 0; k < CACHE_SIGNATURE; k++) {
+            uint32_t value = minhash_mix(shingles[i], k);
+            if (value < signature[k]) signature[k] = value;
+        }
+    }
+
+    for (int band = 0; band < CACHE_BANDS; band++) {
+        uint64_t hash = hash_fnv1a(HASH_FNV_OFFSET, &context, sizeof(context));
+        hash = hash_fnv1a(hash, &band, sizeof(band));
+        hash = hash_fnv1a(hash, &signature[band * CACHE_ROWS], CACHE_ROWS * sizeof(uint32_t));
+        hashes[band] = (uint32_t)(hash ^ (hash >> 32));
+    }
+    return true;
+}
+
+/* 把一个桶加入 LSH 槽（写入端持有锁；先写哈希，最后发布桶号） */
+static void band_insert(CacheBandSlot *bands, uint32_t bucket_count,
+                        const uint32_t hashes[CACHE_BANDS], uint32_t bucket) {
+    uint32_t mask = bucket_count * CACHE_BANDS - 1;
+    for (int band = 0; band < CACHE_BANDS; band++) {
+        uint32_t index = hashes[band] & mask;
+        int same = 0;
+        while (bands[index].bucket != 0 && same < CACHE_BAND_LIMIT) {
+            if (bands[index].hash == hashes[band]) same++;
+            index = (index + 1) & mask;
+        }
+        if (same >= CACHE_BAND_LIMIT) continue;
+
+        bands[index].hash = hashes[band];
+        store_u32(&bands[index].bucket, bucket + 1);
+    }
+}
+
+/* 记录在值堆中占用的字节数 */
+static size_t record_size(const CacheValueHeader *value) {
+    size_t size = sizeof(CacheValueHeader) + (size_t)value->query_len + 1 +
+                  (size_t)value->command_len + 1 + (size_t)value->thinking_len + 1;
+    return (size + 7) & ~(size_t)7;
+}
+
+static void table_close(CacheTable *table) {
+    if (!table) return;
+
+    if (table->header) {
+#ifdef _WIN32
+        UnmapViewOfFile(table->header);
+        CloseHandle(table->mapping);
+#else
+        munmap(table->header, table->map_size);
+#endif
+    }
+    if (table->index_fd >= 0) close_cross(table->index_fd);
+    if (table->heap_fd >= 0) close_cross(table->heap_fd);
+    free(table);
+}
+
+/* 打开并映射索引，确认值堆与之对应；文件不存在或格式不对时返回 NULL
+ * writer 为 false 时尽量以读写方式映射，以便记录最近使用时间
+ */
+static CacheTable* table_open(const ResponseCache *cache, bool writer) {
+    CacheTable *table = (CacheTable *)calloc(1, sizeof(CacheTable));
+    if (!table) return NULL;
+    table->heap_fd = -1;
+
+    table->index_fd = open_cross(cache->index_file, O_RDWR);
+    table->writable = table->index_fd >= 0;
+    if (!table->writable && !writer) table->index_fd = open_cross(cache->index_file, O_RDONLY);
+
+    struct stat st;
+    if (table->index_fd < 0 || fstat(table->index_fd, &st) != 0 ||
+        (size_t)st.st_size < sizeof(CacheIndexHeader)) {
+        table_close(table);
+        return NULL;
+    }
+    table->map_size = (size_t)st.st_size;
+
+#ifdef _WIN32
+    HANDLE handle = (HANDLE)_get_osfhandle(table->index_fd);
+    table->mapping = CreateFileMappingA(handle, NULL,
+                                        table->writable ? PAGE_READWRITE : PAGE_READONLY,
+                                        0, 0, NULL);
+    void *map = table->mapping ?
+                MapViewOfFile(table->mapping, table->writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                              0, 0, table->map_size) : NULL;
+    if (!map) {
+        if (table->mapping) CloseHandle(table->mapping);
+        table_close(table);
+        return NULL;
+    }
+#else
+    table->dev = st.st_dev;
+    table->ino = st.st_ino;
+    void *map = mmap(NULL, table->map_size, table->writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                     MAP_SHARED, table->index_fd, 0);
+    if (map == MAP_FAILED) {
+        table_close(table);
+        return NULL;
+    }
+#endif
+    table->header = (CacheIndexHeader *)map;
+    table->buckets = (CacheBucket *)(table->header + 1);
+
+    /* 校验文件头，桶数必须是 2 的幂且与文件大小一致 */
+    const CacheIndexHeader *header = table->header;
+    uint32_t count = header->bucket_count;
+    bool valid = memcmp(header->magic, CACHE_INDEX_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == CACHE_FORMAT_VERSION && header->bands == CACHE_BANDS &&
+                 count > 0 && (count & (count - 1)) == 0 &&
+                 table->map_size >= sizeof(CacheIndexHeader) + (size_t)count *
+                                    (sizeof(CacheBucket) + CACHE_BANDS * sizeof(CacheBandSlot));
+
+    CacheHeapHeader heap_header;
+    if (valid) {
+        table->heap_fd = open_cross(cache->heap_file, writer ? O_RDWR | O_APPEND : O_RDONLY);
+        valid = table->heap_fd >= 0 &&
+                read_at(table->heap_fd, &heap_header, sizeof(heap_header), 0) &&
+                memcmp(heap_header.magic, CACHE_HEAP_MAGIC, sizeof(heap_header.magic)) == 0 &&
+                heap_header.heap_id == header->heap_id;
+    }
+
+    if (!valid) {
+        table_close(table);
+        return NULL;
+    }
+    table->bands = (CacheBandSlot *)(table->buckets + count);
+    return table;
+}
+
+/* 读取端的映射：索引被其他进程替换（扩容）后重新打开 */
+static CacheTable* reader_table(ResponseCache *cache) {
+    if (cache->reader) {
+#ifndef _WIN32
+        struct stat st;
+        if (stat(cache->index_file, &st) == 0 && st.st_dev == cache->reader->dev &&
+            st.st_ino == cache->reader->ino) {
+            return cache->reader;
+        }
+#else
+        return cache->reader;
+#endif
+        table_close(cache->reader);
+    }
+
+    cache->reader = table_open(cache, false);
+    return cache->reader;
+}
+
+/* 线性探测：返回键所在的桶，没有时返回 NULL */
+static CacheBucket* find_bucket(const CacheTable *table, uint64_t key) {
+    uint32_t mask = table->header->bucket_count - 1;
+    uint32_t index = (uint32_t)(key ^ (key >> 32)) & mask;
+
+    for (uint32_t probe = 0; probe <= mask; probe++) {
+        CacheBucket *bucket = &table->buckets[(index + probe) & mask];
+        uint64_t bucket_key = load_u64(&bucket->key);
+        if (bucket_key == 0) return NULL;
+        if (bucket_key == key) return bucket;
+    }
+    return NULL;
+}
+
+static bool expired(const ResponseCache *cache, uint32_t created, long long now) {
+    return cache->ttl > 0 && now - (long long)created >= cache->ttl;
+}
+
+/* 读取一条记录（校验键和长度），返回以 '\0' 分隔的查询、命令和思考过程 */
+static char* read_value(int heap_fd, uint64_t offset, uint64_t key, CacheValueHeader *value) {
+    if (offset < sizeof(CacheHeapHeader) ||
+        !read_at(heap_fd, value, sizeof(CacheValueHeader), offset) || value->key != key ||
+        value->query_len > CACHE_MAX_VALUE || value->command_len > CACHE_MAX_VALUE ||
+        value->thinking_len > CACHE_MAX_VALUE) {
+        return NULL;
+    }
+
+    size_t len = record_size(value) - sizeof(CacheValueHeader);
+    char *body = (char *)malloc(len);
+    if (body && !read_at(heap_fd, body, len, offset + sizeof(CacheValueHeader))) {
+        free(body);
+        return NULL;
+    }
+    return body;
+}
+
+bool response_cache_lookup(ResponseCache *cache, uint64_t key, const char *normalized,
+                           Arena *arena, ResponseCacheEntry *entry) {
+    if (!cache || !normalized || !entry) return false;
+    memset(entry, 0, sizeof(ResponseCacheEntry));
+
+    CacheTable *table = reader_table(cache);
+    if (!table) return false;
+
+    CacheBucket *bucket = find_bucket(table, key);
+    if (!bucket) return false;
+
+    uint64_t offset = load_u64(&bucket->offset);
+    uint32_t created = bucket->created;
+    long long now = (long long)time(NULL);
+    if (offset == 0 || expired(cache, created, now)) return false;
+
+    CacheValueHeader value;
+    char *body = read_value(table->heap_fd, offset, key, &value);
+    if (!body) return false;
+
+    /* 比较归一化的查询，排除 64 位哈希碰撞 */
+    const char *query = body;
+    const char *command = query + value.query_len + 1;
+    const char *thinking = command + value.command_len + 1;
+    bool hit = value.query_len == strlen(normalized) &&
+               memcmp(query, normalized, value.query_len) == 0 && value.command_len > 0;
+
+    if (hit) {
+        entry->similarity = 1.0;
+        entry->created = created;
+        entry->command = arena_strndup(arena, command, value.command_len);
+        entry->thinking = value.thinking_len > 0 ?
+                          arena_strndup(arena, thinking, value.thinking_len) : NULL;
+        hit = entry->command != NULL;
+    }
+    free(body);
+
+    /* 最近使用时间只用于淘汰，不加锁直接更新 */
+    if (hit && table->writable) store_u32(&bucket->last_used, (uint32_t)now);
+    return hit;
+}
+
+bool response_cache_lookup_similar(ResponseCache *cache, uint64_t context, const char *normalized,
+                                   double threshold, Arena *arena, ResponseCacheEntry *entry) {
+    if (!cache || !normalized || !entry || context == 0 || threshold <= 0) return false;
+    memset(entry, 0, sizeof(ResponseCacheEntry));
+
+    CacheTable *table = reader_table(cache);
+    if (!table) return false;
+
+    uint32_t *shingles;
+    size_t count = query_shingles(normalized, strlen(normalized), &shingles);
+    uint32_t hashes[CACHE_BANDS];
+    if (!band_hashes(shingles, count, context, hashes)) {
+        free(shingles);
+        return false;
+    }
+
+    /* 收集候选桶（任一段哈希相同），同时统计相同的段数 */
+    uint32_t candidates[CACHE_MAX_CANDIDATES];
+    int matches[CACHE_MAX_CANDIDATES];
+    int candidate_count = 0;
+    uint32_t bucket_count = table->header->bucket_count;
+    uint32_t mask = bucket_count * CACHE_BANDS - 1;
+    for (int band = 0; band < CACHE_BANDS; band++) {
+        for (uint32_t index = hashes[band] & mask; ; index = (index + 1) & mask) {
+            const CacheBandSlot *slot = &table->bands[index];
+            uint32_t bucket = load_u32(&slot->bucket);
+            if (bucket == 0) break;
+            if (slot->hash != hashes[band] || bucket > bucket_count) continue;
+
+            int i = 0;
+            while (i < candidate_count && candidates[i] != bucket - 1) i++;
+            if (i < candidate_count) {
+                matches[i]++;
+            } else if (candidate_count < CACHE_MAX_CANDIDATES) {
+                candidates[candidate_count] = bucket - 1;
+                matches[candidate_count++] = 1;
+            }
+        }
+    }
+
+    /* 相同的段越多，相似度越可能高（期望为 CACHE_BANDS * s^CACHE_ROWS）：
+     * 按段数排序，只精确比较前 CACHE_MAX_VERIFY 个
+     */
+    for (int i = 1; i < candidate_count; i++) {
+        uint32_t candidate = candidates[i];
+        int match = matches[i];
+        int j = i;
+        while (j > 0 && matches[j - 1] < match) {
+            candidates[j] = candidates[j - 1];
+            matches[j] = matches[j - 1];
+            j--;
+        }
+        candidates[j] = candidate;
+        matches[j] = match;
+    }
+    if (candidate_count > CACHE_MAX_VERIFY) candidate_count = CACHE_MAX_VERIFY;
+
+    /* 逐个读取候选条目，计算精确的 Jaccard 相似度，取最高的一个 */
+    long long now = (long long)time(NULL);
+    CacheBucket *best = NULL;
+    for (int i = 0; i < candidate_count; i++) {
+        CacheBucket *bucket = &table->buckets[candidates[i]];
+        uint64_t key = load_u64(&bucket->key);
+        uint64_t offset = load_u64(&bucket->offset);
+        uint32_t created = bucket->created;
+        if (key == 0 || offset == 0 || expired(cache, created, now)) continue;
+
+        CacheValueHeader value;
+        char *body = read_value(table->heap_fd, offset, key, &value);
+        if (!body) continue;
+
+        /* 上下文不同（段哈希碰撞）的条目不参与比较 */
+        uint32_t *other = NULL;
+        size_t other_count = value.context == context ?
+                             query_shingles(body, value.query_len, &other) : 0;
+        double similarity = jaccard(shingles, count, other, other_count);
+        free(other);
+
+        const char *command = body + value.query_len + 1;
+        const char *thinking = command + value.command_len + 1;
+        if (similarity >= threshold && similarity > entry->similarity && value.command_len > 0) {
+            entry->similarity = similarity;
+            entry->created = created;
+            entry->query = arena_strndup(arena, body, value.query_len);
+            entry->command = arena_strndup(arena, command, value.command_len);
+            entry->thinking = value.thinking_len > 0 ?
+                              arena_strndup(arena, thinking, value.thinking_len) : NULL;
+            best = bucket;
+        }
+        free(body);
+    }
+    free(shingles);
+
+    if (best && table->writable) store_u32(&best->last_used, (uint32_t)now);
+    return best != NULL && entry->command != NULL;
+}
+
+/* 创建（截断）只有当前用户可读写的文件：缓存中保存了查询和命令 */
+static FILE* create_private(const char *path) {
+    int fd = open_cross(path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0) return NULL;
+
+    FILE *fp = fdopen_cross(fd, "wb");
+    if (!fp) close_cross(fd);
+    return fp;
+}
+
+/* 写入新的值堆和索引，然后依次替换
+ * 只保留 old 中未过期的条目；old 为 NULL 时创建空表。
+ */
+static bool rebuild(const ResponseCache *cache, const CacheTable *old, uint32_t bucket_count,
+                    long long now) {
+    size_t path_len = strlen(cache->index_file) + 32;
+    char *heap_tmp = (char *)malloc(path_len);
+    char *index_tmp = (char *)malloc(path_len);
+    size_t index_size = sizeof(CacheIndexHeader) +
+                        (size_t)bucket_count * (sizeof(CacheBucket) +
+                                                CACHE_BANDS * sizeof(CacheBandSlot));
+    CacheIndexHeader *header = (CacheIndexHeader *)calloc(1, index_size);
+    if (!heap_tmp || !index_tmp || !header) {
+        free(heap_tmp);
+        free(index_tmp);
+        free(header);
+        return false;
+    }
+#ifdef _WIN32
+    snprintf(heap_tmp, path_len, "%s.tmp", cache->heap_file);
+    snprintf(index_tmp, path_len, "%s.tmp", cache->index_file);
+#else
+    snprintf(heap_tmp, path_len, "%s.tmp.%ld", cache->heap_file, (long)getpid());
+    snprintf(index_tmp, path_len, "%s.tmp.%ld", cache->index_file, (long)getpid());
+#endif
+
+    memcpy(header->magic, CACHE_INDEX_MAGIC, sizeof(header->magic));
+    header->version = CACHE_FORMAT_VERSION;
+    header->bucket_count = bucket_count;
+    header->max_load = CACHE_MAX_LOAD;
+    header->bands = CACHE_BANDS;
+    header->heap_id = old ? old->header->heap_id + 1 : ((uint64_t)now << 16);
+    CacheBucket *buckets = (CacheBucket *)(header + 1);
+    CacheBandSlot *bands = (CacheBandSlot *)(buckets + bucket_count);
+
+    CacheHeapHeader heap_header;
+    memcpy(heap_header.magic, CACHE_HEAP_MAGIC, sizeof(heap_header.magic));
+    heap_header.heap_id = header->heap_id;
+
+    FILE *heap = create_private(heap_tmp);
+    bool ok = heap && fwrite(&heap_header, sizeof(heap_header), 1, heap) == 1;
+    uint64_t heap_size = sizeof(heap_header);
+
+    /* 复制有效的条目，旧值堆中的垃圾被丢弃 */
+    uint32_t old_count = old ? old->header->bucket_count : 0;
+    for (uint32_t i = 0; ok && i < old_count; i++) {
+        const CacheBucket *bucket = &old->buckets[i];
+        if (bucket->key == 0 || bucket->offset == 0 || expired(cache, bucket->created, now)) {
+            continue;
+        }
+
+        CacheValueHeader value;
+        char *body = read_value(old->heap_fd, bucket->offset, bucket->key, &value);
+        if (!body) continue;
+
+        size_t size = record_size(&value);
+        ok = fwrite(&value, sizeof(value), 1, heap) == 1 &&
+             fwrite(body, 1, size - sizeof(value), heap) == size - sizeof(value);
+
+        uint32_t mask = bucket_count - 1;
+        uint32_t index = (uint32_t)(bucket->key ^ (bucket->key >> 32)) & mask;
+        while (buckets[index].key != 0) index = (index + 1) & mask;
+        buckets[index] = *bucket;
+        buckets[index].offset = heap_size;
+
+        /* 重新计算 LSH 槽（下标随桶的位置变化） */
+        uint32_t *shingles = NULL;
+        size_t count = value.context ? query_shingles(body, value.query_len, &shingles) : 0;
+        uint32_t hashes[CACHE_BANDS];
+        if (band_hashes(shingles, count, value.context, hashes)) {
+            band_insert(bands, bucket_count, hashes, index);
+        }
+        free(shingles);
+        free(body);
+
+        heap_size += size;
+        header->heap_live += size;
+        header->used++;
+        header->live++;
+    }
+
+    if (heap && fclose(heap) != 0) ok = false;
+
+    if (ok) {
+        FILE *index = create_private(index_tmp);
+        ok = index && fwrite(header, 1, index_size, index) == index_size;
+        if (index && fclose(index) != 0) ok = false;
+    }
+
+    /* 先替换值堆再替换索引：两者之间读到旧索引的进程会因标识不一致而视为未命中 */
+#ifdef _WIN32
+    if (ok) ok = MoveFileExA(heap_tmp, cache->heap_file, MOVEFILE_REPLACE_EXISTING) != 0;
+    if (ok) ok = MoveFileExA(index_tmp, cache->index_file, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    if (ok) ok = rename(heap_tmp, cache->heap_file) == 0;
+    if (ok) ok = rename(index_tmp, cache->index_file) == 0;
+#endif
+    if (!ok) {
+        remove(heap_tmp);
+        remove(index_tmp);
+    }
+
+    free(heap_tmp);
+    free(index_tmp);
+    free(header);
+    return ok;
+}
+
+/* 删除一个条目（保留键，探测可以继续越过它） */
+static void remove_bucket(CacheTable *table, CacheBucket *bucket) {
+    CacheValueHeader value;
+    if (read_at(table->heap_fd, &value, sizeof(value), bucket->offset) &&
+        value.key == bucket->key) {
+        size_t size = record_size(&value);
+        table->header->heap_live -= size < table->header->heap_live ? size : table->header->heap_live;
+    }
+    store_u64(&bucket->offset, 0);
+    table->header->live--;
+}
+
+/* 条目数达到上限时：删除所有过期的条目，仍然达到上限时删除最久未使用的条目
+ * （上限被调小后可能需要删除多个）
+ */
+static void evict(const ResponseCache *cache, CacheTable *table, long long now) {
+    bool first_pass = true;
+    while (table->header->live >= (uint32_t)cache->max_entries) {
+        CacheBucket *oldest = NULL;
+        for (uint32_t i = 0; i < table->header->bucket_count; i++) {
+            CacheBucket *bucket = &table->buckets[i];
+            if (bucket->key == 0 || bucket->offset == 0) continue;
+
+            if (first_pass && expired(cache, bucket->created, now)) {
+                remove_bucket(table, bucket);
+            } else if (!oldest || bucket->last_used < oldest->last_used) {
+                oldest = bucket;
+            }
+        }
+        first_pass = false;
+
+        if (!oldest || table->header->live < (uint32_t)cache->max_entries) break;
+        remove_bucket(table, oldest);
+    }
+}
+
+/* 追加一条记录到值堆末尾，返回其偏移（失败时为 0） */
+static uint64_t append_value(CacheTable *table, uint64_t key, uint64_t context,
+                             const char *query, const char *command, const char *thinking,
+                             size_t *size) {
+    CacheValueHeader value = { key, context, (uint32_t)strlen(query), (uint32_t)strlen(command),
+                               (uint32_t)(thinking ? strlen(thinking) : 0), 0 };
+    if (value.query_len > CACHE_MAX_VALUE || value.command_len > CACHE_MAX_VALUE ||
+        value.thinking_len > CACHE_MAX_VALUE) {
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(table->heap_fd, &st) != 0) return 0;
+
+    *size = record_size(&value);
+    char *record = (char *)calloc(1, *size);
+    if (!record) return 0;
+
+    char *p = record;
+    memcpy(p, &value, sizeof(value));
+    p += sizeof(value);
+    memcpy(p, query, value.query_len);
+    p += value.query_len + 1;
+    memcpy(p, command, value.command_len);
+    p += value.command_len + 1;
+    if (value.thinking_len > 0) memcpy(p, thinking, value.thinking_len);
+
+    /* 一次写入整条记录 */
+    bool ok = write_all(table->heap_fd, record, *size);
+    free(record);
+    return ok ? (uint64_t)st.st_size : 0;
+}
+
+/* 需要的桶数：装载率回到上限的一半左右 */
+static uint32_t grown_bucket_count(uint32_t live) {
+    uint32_t count = CACHE_INITIAL_BUCKETS;
+    while ((uint64_t)(live + 1) * 100 * 2 > (uint64_t)count * CACHE_MAX_LOAD) count *= 2;
+    return count;
+}
+
+static bool store_entry(ResponseCache *cache, uint64_t key, uint64_t context,
+                        const char *normalized, const char *command, const char *thinking,
+                        long long created) {
+    if (!cache || !normalized || !command || !*command || key == 0) return false;
+
+    /* 只设置了环境变量时配置目录可能还不存在 */
+    char *dir = strdup(cache->index_file);
+    char *slash = dir ? strrchr(dir, '/') : NULL;
+    if (slash) {
+        *slash = '\0';
+        mkdir_cross(dir);
+    }
+    free(dir);
+
+    int lock_fd = open_cross(cache->lock_file, O_RDWR | O_CREAT);
+    if (lock_fd >= 0 && !file_lock(lock_fd, true)) {
+        close_cross(lock_fd);
+        lock_fd = -1;
+    }
+
+    long long now = (long long)time(NULL);
+    CacheTable *table = table_open(cache, true);
+    if (!table && rebuild(cache, NULL, CACHE_INITIAL_BUCKETS, now)) {
+        table = table_open(cache, true);
+    }
+
+    bool ok = table != NULL;
+    CacheBucket *bucket = NULL;
+    if (ok) {
+        bucket = find_bucket(table, key);
+        bool present = bucket && bucket->offset != 0;
+        CacheIndexHeader *header = table->header;
+
+        if (!present && header->live >= (uint32_t)cache->max_entries) {
+            evict(cache, table, now);
+        }
+
+        /* 装载率（含已删除的桶）超过上限，或值堆中的垃圾过多时重建 */
+        struct stat st;
+        bool full = !bucket && (uint64_t)(header->used + 1) * 100 >
+                               (uint64_t)header->bucket_count * header->max_load;
+        bool garbage = fstat(table->heap_fd, &st) == 0 &&
+                       (uint64_t)st.st_size > header->heap_live * 4 + 1024 * 1024;
+        if (full || garbage) {
+            uint32_t count = grown_bucket_count(header->live);
+            if (count < header->bucket_count) count = header->bucket_count;
+            ok = rebuild(cache, table, count, now);
+            table_close(table);
+            table = ok ? table_open(cache, true) : NULL;
+            ok = table != NULL;
+            bucket = ok ? find_bucket(table, key) : NULL;
+        }
+    }
+
+    if (ok) {
+        CacheIndexHeader *header = table->header;
+        size_t size = 0;
+        uint64_t offset = append_value(table, key, context, normalized, command, thinking,
+                                       &size);
+        ok = offset != 0;
+
+        if (ok && bucket) {
+            /* 替换已有的键（或重新启用已删除的条目） */
+            if (bucket->offset != 0) remove_bucket(table, bucket);
+            bucket->created = (uint32_t)created;
+            bucket->last_used = (uint32_t)created;
+            store_u64(&bucket->offset, offset);
+        } else if (ok) {
+            /* 新键：使用探测序列中的第一个空桶，先写内容，最后发布键 */
+            uint32_t mask = header->bucket_count - 1;
+            uint32_t index = (uint32_t)(key ^ (key >> 32)) & mask;
+            while (table->buckets[index].key != 0) index = (index + 1) & mask;
+
+            bucket = &table->buckets[index];
+            bucket->offset = offset;
+            bucket->created = (uint32_t)created;
+            bucket->last_used = (uint32_t)created;
+            store_u64(&bucket->key, key);
+            header->used++;
+
+            /* 键相同时查询和上下文也相同，只有新键需要加入 LSH 槽 */
+            uint32_t *shingles = NULL;
+            size_t count = context ? query_shingles(normalized, strlen(normalized), &shingles) : 0;
+            uint32_t hashes[CACHE_BANDS];
+            if (band_hashes(shingles, count, context, hashes)) {
+                band_insert(table->bands, header->bucket_count, hashes, index);
+            }
+            free(shingles);
+        }
+
+        if (ok) {
+            header->live++;
+            header->heap_live += size;
+        }
+    }
+
+    table_close(table);
+    if (lock_fd >= 0) close_cross(lock_fd);
+    return ok;
+}
+
+bool response_cache_store(ResponseCache *cache, uint64_t key, uint64_t context,
+                          const char *normalized, const char *command, const char *thinking) {
+    return store_entry(cache, key, context, normalized, command, thinking, (long long)time(NULL));
+}
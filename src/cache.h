@@ -0,0 +1,82 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Response Cache Header
+ *===========================================================================*/
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "config.h"
+#include "arena.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* 索引的最大装载率（百分比，含已删除的桶），超过时加倍扩容 */
+#define CACHE_MAX_LOAD 70
+
+struct CacheTable;
+
+/* 本地响应缓存
+ * 以归一化的用户输入、模型、user_prompt 和系统上下文为键，保存提取出的命令和
+ * 思考过程；重复的查询直接返回，不发送网络请求。相同上下文中措辞相近的查询
+ * 可以通过字符 n-gram 的 MinHash/LSH 签名找到（response_cache_lookup_similar）。
+ *
+ * 存储为两个内存映射文件：
+ *   response_cache.idx   定长文件头（版本、装载率、条目数）+ 开放寻址的桶数组
+ *                        + LSH 槽数组；每个桶记录键、值的偏移、生成时间和
+ *                        最近使用时间，每个 LSH 槽记录一段签名的哈希和桶号
+ *   response_cache.heap  只追加的值堆，每条记录包含键、上下文、查询、命令和思考过程
+ * 查找只需映射索引、线性探测并读取一条记录，不解析任何文本。
+ *
+ * 读取不加锁；写入持有 response_cache.lock 的排他锁，先追加值再发布桶
+ * （最后写入键），读取端总能看到完整的记录。装载率超过上限时写入新的索引
+ * 和值堆后 rename 替换（同时丢弃过期、已删除的条目），已打开的读取端
+ * 继续使用旧文件。
+ */
+typedef struct {
+    char *index_file;      /* 索引文件路径 */
+    char *heap_file;       /* 值堆文件路径 */
+    char *lock_file;       /* 写入锁文件 */
+    int ttl;               /* 条目有效期（秒），0 表示不过期 */
+    int max_entries;       /* 最多保留的条目数，超过时淘汰最久未使用的条目 */
+    struct CacheTable *reader;  /* 查找使用的映射（守护进程中跨查询复用） */
+} ResponseCache;
+
+/* 查找到的条目（字符串从调用者的 arena 分配） */
+typedef struct {
+    char *command;
+    char *thinking;        /* 没有思考过程时为 NULL */
+    char *query;           /* 相似匹配命中的原查询（精确命中时为 NULL） */
+    double similarity;     /* n-gram Jaccard 相似度，精确命中为 1 */
+    long long created;     /* 生成时间（Unix 时间戳） */
+} ResponseCacheEntry;
+
+/* 函数声明 */
+ResponseCache* response_cache_create(const char *config_dir, int ttl, int max_entries);
+void response_cache_destroy(ResponseCache *cache);
+
+/* 归一化用户输入：去掉首尾空白和结尾的标点，连续空白合并为一个空格，ASCII 转小写 */
+char* response_cache_normalize(Arena *arena, const char *user_input);
+
+/* 缓存键：归一化的输入 + 模型 + user_prompt + 系统上下文（system_info_to_prompt） */
+uint64_t response_cache_key(const char *normalized, const Config *cfg, const char *sys_context);
+
+/* 上下文键：模型 + user_prompt + 系统上下文，相似匹配只在相同的上下文中进行 */
+uint64_t response_cache_context(const Config *cfg, const char *sys_context);
+
+/* 查找未过期的条目；命中时更新最近使用时间（LRU） */
+bool response_cache_lookup(ResponseCache *cache, uint64_t key, const char *normalized,
+                           Arena *arena, ResponseCacheEntry *entry);
+
+/* 查找相同上下文中与 normalized 的 n-gram Jaccard 相似度不低于 threshold 的条目，
+ * 返回相似度最高的一个；只比较 LSH 找到的少量候选，10 万个条目时仍在几十微秒内完成
+ */
+bool response_cache_lookup_similar(ResponseCache *cache, uint64_t context, const char *normalized,
+                                   double threshold, Arena *arena, ResponseCacheEntry *entry);
+
+/* 保存一条结果（已有相同的键时替换），必要时淘汰或扩容 */
+bool response_cache_store(ResponseCache *cache, uint64_t key, uint64_t context,
+                          const char *normalized, const char *command, const char *thinking);
+
+#endif /* CACHE_H */
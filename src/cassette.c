@@ -0,0 +1,271 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Request Record / Replay Implementation
+ *===========================================================================*/
+
+#include "cassette.h"
+#include "transport.h"
+#include "timing.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <direct.h>
+    #include <process.h>
+    #include <windows.h>
+    #define mkdir_cross(path) _mkdir(path)
+#else
+    #include <unistd.h>
+    #define mkdir_cross(path) mkdir(path, 0755)
+#endif
+
+typedef enum {
+    CASSETTE_OFF,
+    CASSETTE_RECORD,
+    CASSETTE_REPLAY
+} CassetteMode;
+
+/* 进程级的录制 / 重放状态（由命令行选项设置） */
+static struct {
+    CassetteMode mode;
+    char dir[512];
+    double speed;
+} state;
+
+/* 录制时的写回调包装 */
+typedef struct {
+    FILE *file;
+    uint64_t start_ns;
+    CassetteWriteFn callback;
+    void *userdata;
+} Recorder;
+
+static bool set_mode(CassetteMode mode, const char *dir) {
+    if (state.mode != CASSETTE_OFF) {
+        fprintf(stderr, "Error: --record and --replay cannot be combined\n");
+        return false;
+    }
+
+    size_t len = strlen(dir);
+    while (len > 1 && dir[len - 1] == '/') len--;
+    if (len == 0 || len >= sizeof(state.dir)) {
+        fprintf(stderr, "Error: Invalid cassette directory: %s\n", dir);
+        return false;
+    }
+    memcpy(state.dir, dir, len);
+    state.dir[len] = '\0';
+    state.mode = mode;
+    return true;
+}
+
+bool cassette_record(const char *dir) {
+    if (!dir || !set_mode(CASSETTE_RECORD, dir)) return false;
+
+    struct stat st;
+    if (stat(state.dir, &st) != 0 && mkdir_cross(state.dir) != 0) {
+        fprintf(stderr, "Error: Cannot create directory %s\n", state.dir);
+        state.mode = CASSETTE_OFF;
+        return false;
+    }
+    return true;
+}
+
+bool cassette_replay(const char *dir, double speed) {
+    if (!dir || !set_mode(CASSETTE_REPLAY, dir)) return false;
+
+    state.speed = speed < 0 ? 0 : speed;
+    return true;
+}
+
+bool cassette_replaying(void) {
+    return state.mode == CASSETTE_REPLAY;
+}
+
+/* 录制文件路径：<dir>/<模型、模式和用户输入的哈希>.<suffix> */
+static void cassette_path(char *path, size_t size, const Config *cfg, const char *user_input,
+                          bool stream, const char *suffix) {
+    uint64_t key = hash_fnv1a_str(HASH_FNV_OFFSET, cfg->model);
+    key = hash_fnv1a_str(key, stream ? "stream" : "json");
+    key = hash_fnv1a_str(key, user_input);
+    snprintf(path, size, "%s/%016llx.%s", state.dir, (unsigned long long)key, suffix);
+}
+
+static char* read_file(const char *path, size_t *len) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+
+    char *data = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long size = ftell(file);
+        if (size >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data = (char *)malloc((size_t)size + 1);
+            if (data && fread(data, 1, (size_t)size, file) == (size_t)size) {
+                data[size] = '\0';
+                *len = (size_t)size;
+            } else {
+                free(data);
+                data = NULL;
+            }
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+static void sleep_until(uint64_t deadline_ns) {
+    uint64_t now = timing_now_ns();
+    if (now >= deadline_ns) return;
+
+    uint64_t wait = deadline_ns - now;
+#ifdef _WIN32
+    Sleep((DWORD)(wait / 1000000));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(wait / 1000000000ULL);
+    ts.tv_nsec = (long)(wait % 1000000000ULL);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static size_t record_callback(void *contents, size_t size, size_t nmemb, void *userdata) {
+    Recorder *recorder = (Recorder *)userdata;
+    size_t len = size * nmemb;
+    unsigned long long offset_us = (timing_now_ns() - recorder->start_ns) / 1000;
+
+    fprintf(recorder->file, "chunk %llu %zu\n", offset_us, len);
+    fwrite(contents, 1, len, recorder->file);
+    fputc('\n', recorder->file);
+
+    return recorder->callback(contents, size, nmemb, recorder->userdata);
+}
+
+/* 录制：执行真实的请求，同时保存请求体和每个响应分块 */
+static CURLcode record_perform(CURL *curl, const Config *cfg, const char *user_input,
+                               bool stream, const char *request_body,
+                               CassetteWriteFn callback, void *userdata) {
+    char path[600];
+    cassette_path(path, sizeof(path), cfg, user_input, stream, "req");
+    FILE *req = fopen(path, "wb");
+    if (req) {
+        fputs(request_body, req);
+        fclose(req);
+    }
+
+    char res_path[600];
+    char tmp_path[640];
+    cassette_path(res_path, sizeof(res_path), cfg, user_input, stream, "res");
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", res_path, (long)getpid());
+
+    Recorder recorder = { fopen(tmp_path, "wb"), timing_now_ns(), callback, userdata };
+    if (!recorder.file) {
+        fprintf(stderr, "Warning: Cannot record the response to %s\n", res_path);
+        return transport.easy_perform(curl);
+    }
+    fprintf(recorder.file, "%s\nstream %d\n", CASSETTE_MAGIC, stream ? 1 : 0);
+
+    transport.easy_setopt(curl, CURLOPT_WRITEFUNCTION, record_callback);
+    transport.easy_setopt(curl, CURLOPT_WRITEDATA, &recorder);
+    CURLcode res = transport.easy_perform(curl);
+
+    long status = 0;
+    transport.easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    fprintf(recorder.file, "end %llu %d %ld\n",
+            (unsigned long long)((timing_now_ns() - recorder.start_ns) / 1000), (int)res, status);
+
+    if (fclose(recorder.file) != 0 || rename(tmp_path, res_path) != 0) {
+        fprintf(stderr, "Warning: Cannot record the response to %s\n", res_path);
+        remove(tmp_path);
+    }
+    return res;
+}
+
+/* 重放：按录制的分块和时间间隔调用写回调 */
+static CURLcode replay_perform(const Config *cfg, const char *user_input, bool stream,
+                               const char *request_body, CassetteWriteFn callback,
+                               void *userdata) {
+    char path[600];
+    size_t len = 0;
+
+    if (cfg->verbose) {
+        size_t recorded_len = 0;
+        cassette_path(path, sizeof(path), cfg, user_input, stream, "req");
+        char *recorded = read_file(path, &recorded_len);
+        if (recorded && strcmp(recorded, request_body) != 0) {
+            printf("[DEBUG] Replay: the request body differs from the recorded one (%s)\n", path);
+        }
+        free(recorded);
+    }
+
+    cassette_path(path, sizeof(path), cfg, user_input, stream, "res");
+    char *data = read_file(path, &len);
+    if (!data) {
+        fprintf(stderr, "Error: No recorded %s response for this query (%s)\n",
+                stream ? "stream" : "non-stream", path);
+        return CURLE_FILE_COULDNT_READ_FILE;
+    }
+
+    size_t magic_len = strlen(CASSETTE_MAGIC);
+    if (len <= magic_len || memcmp(data, CASSETTE_MAGIC, magic_len) != 0 ||
+        data[magic_len] != '\n') {
+        fprintf(stderr, "Error: %s is not a recorded response\n", path);
+        free(data);
+        return CURLE_FILE_COULDNT_READ_FILE;
+    }
+
+    uint64_t start = timing_now_ns();
+    CURLcode res = CURLE_FILE_COULDNT_READ_FILE;
+    const char *pos = data + magic_len + 1;
+    const char *end = data + len;
+
+    while (pos < end) {
+        const char *newline = (const char *)memchr(pos, '\n', (size_t)(end - pos));
+        if (!newline) break;
+
+        unsigned long long offset_us = 0;
+        size_t chunk_len = 0;
+        int code = 0;
+        if (sscanf(pos, "chunk %llu %zu", &offset_us, &chunk_len) == 2) {
+            const char *chunk = newline + 1;
+            if (chunk_len > (size_t)(end - chunk)) break;
+            if (state.speed > 0) {
+                sleep_until(start + (uint64_t)((double)offset_us * 1000.0 / state.speed));
+            }
+            /* 与 curl 相同：写回调没有处理全部字节时中止传输 */
+            if (callback((void *)chunk, 1, chunk_len, userdata) != chunk_len) {
+                res = CURLE_WRITE_ERROR;
+                break;
+            }
+            pos = chunk + chunk_len + 1;
+        } else if (sscanf(pos, "end %llu %d", &offset_us, &code) == 2) {
+            if (state.speed > 0) {
+                sleep_until(start + (uint64_t)((double)offset_us * 1000.0 / state.speed));
+            }
+            res = (CURLcode)code;
+            break;
+        } else {
+            pos = newline + 1;
+        }
+    }
+
+    if (res == CURLE_FILE_COULDNT_READ_FILE) {
+        fprintf(stderr, "Error: %s is truncated\n", path);
+    }
+    free(data);
+    return res;
+}
+
+CURLcode cassette_perform(CURL *curl, const Config *cfg, const char *user_input, bool stream,
+                          const char *request_body, CassetteWriteFn callback, void *userdata) {
+    switch (state.mode) {
+        case CASSETTE_RECORD:
+            return record_perform(curl, cfg, user_input, stream, request_body, callback, userdata);
+        case CASSETTE_REPLAY:
+            return replay_perform(cfg, user_input, stream, request_body, callback, userdata);
+        default:
+            return transport.easy_perform(curl);
+    }
+}
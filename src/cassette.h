@@ -0,0 +1,49 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Request Record / Replay Header
+ *===========================================================================*/
+
+#ifndef CASSETTE_H
+#define CASSETTE_H
+
+#include "config.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <curl/curl.h>
+
+/* 录制格式版本 */
+#define CASSETTE_MAGIC "GLM-CASSETTE 1"
+
+/* 与 curl 写回调相同的签名 */
+typedef size_t (*CassetteWriteFn)(void *contents, size_t size, size_t nmemb, void *userdata);
+
+/* API 流量的录制与重放（--record DIR / --replay DIR）
+ * 每次请求对应目录中的两个文件，文件名为模型、请求模式（流式/非流式）和用户输入的哈希：
+ *   <key>.req  发送的请求体（原样保存）
+ *   <key>.res  原始响应字节，每个分块记录相对请求开始的时间：
+ *                GLM-CASSETTE 1
+ *                stream 1
+ *                chunk <微秒> <字节数>\n<原始字节>\n
+ *                ...
+ *                end <微秒> <CURLcode> <HTTP 状态码>
+ * 重放时不访问网络，按录制的分块和时间间隔把字节交给同一个写回调
+ * （write_callback / stream_write_callback），录制时传输失败的结果也会重现。
+ */
+
+/* 开启录制：之后每次请求都写入 dir（不存在时创建） */
+bool cassette_record(const char *dir);
+
+/* 开启重放：speed 为时间倍率，1 为按录制时的速度，0 为不等待 */
+bool cassette_replay(const char *dir, double speed);
+
+/* 是否处于重放模式（不需要 API Key，也不访问网络） */
+bool cassette_replaying(void);
+
+/* 执行请求（代替 curl_easy_perform）
+ * 未开启录制或重放时直接执行；callback / userdata 为本次请求的写回调，
+ * request_body 为请求体，user_input 和 stream 用于确定录制文件
+ */
+CURLcode cassette_perform(CURL *curl, const Config *cfg, const char *user_input, bool stream,
+                          const char *request_body, CassetteWriteFn callback, void *userdata);
+
+#endif /* CASSETTE_H */
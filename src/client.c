@@ -0,0 +1,87 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Persistent HTTP Client Implementation
+ *===========================================================================*/
+
+#include "client.h"
+#include "transport.h"
+#include "timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* curl_global_init 的引用计数，保证全局初始化在进程内只执行一次 */
+static int global_refs = 0;
+
+GlmClient* client_create(void) {
+    GlmClient *client = (GlmClient *)calloc(1, sizeof(GlmClient));
+    if (!client) {
+        fprintf(stderr, "Error: Failed to allocate memory for client\n");
+        return NULL;
+    }
+
+    /* 加载 libcurl（LAZY_CURL 构建）并执行全局初始化（TLS 库在此初始化） */
+    uint64_t start = startup_phase_begin();
+    if (!transport_load()) {
+        free(client);
+        return NULL;
+    }
+    if (global_refs++ == 0) {
+        transport.global_init(CURL_GLOBAL_ALL);
+    }
+
+    /* 共享 DNS 缓存、TLS 会话和连接缓存 */
+    client->share = transport.share_init();
+    if (client->share) {
+        transport.share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        transport.share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900  /* 7.57.0 起支持共享连接缓存 */
+        transport.share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+    }
+
+    client->curl = transport.easy_init();
+    if (!client->curl) {
+        fprintf(stderr, "Error: Failed to initialize curl\n");
+        client_destroy(client);
+        return NULL;
+    }
+
+    client->request_count = 0;
+    startup_phase_end(STARTUP_NETWORK, start);
+    return client;
+}
+
+void client_destroy(GlmClient *client) {
+    if (!client) return;
+
+    /* easy 句柄必须先于共享对象释放 */
+    if (client->curl) transport.easy_cleanup(client->curl);
+    if (client->share) transport.share_cleanup(client->share);
+
+    if (--global_refs == 0) {
+        transport.global_cleanup();
+    }
+
+    free(client);
+}
+
+CURL* client_acquire(GlmClient *client) {
+    if (!client || !client->curl) return NULL;
+
+    /* 重置请求选项；连接池、DNS 缓存和 TLS 会话缓存不受影响 */
+    transport.easy_reset(client->curl);
+
+    if (client->share) {
+        transport.easy_setopt(client->curl, CURLOPT_SHARE, client->share);
+    }
+
+    /* 不使用信号实现超时：守护进程在多个线程中同时发送请求 */
+    transport.easy_setopt(client->curl, CURLOPT_NOSIGNAL, 1L);
+
+    /* 保持空闲连接存活，便于后续请求复用 */
+    transport.easy_setopt(client->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    transport.easy_setopt(client->curl, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+
+    client->request_count++;
+    return client->curl;
+}
@@ -0,0 +1,30 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Persistent HTTP Client Header
+ *===========================================================================*/
+
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <stdbool.h>
+#include <curl/curl.h>
+
+/* 长生命周期客户端（每个进程创建一次）
+ * 持有可复用的 easy 句柄以及 CURLSH 共享对象，
+ * 使 DNS 缓存、TLS 会话和连接缓存在多次请求之间复用，
+ * 只有第一次请求需要支付 DNS 解析、TCP 连接和 TLS 握手的开销。
+ */
+typedef struct {
+    CURL *curl;         /* 复用的 easy 句柄 */
+    CURLSH *share;      /* DNS / TLS 会话 / 连接缓存共享对象 */
+    int request_count;  /* 已发出的请求数（用于调试输出） */
+} GlmClient;
+
+/* 函数声明 */
+GlmClient* client_create(void);
+void client_destroy(GlmClient *client);
+
+/* 获取一个已重置选项、但保留连接与缓存的 easy 句柄 */
+CURL* client_acquire(GlmClient *client);
+
+#endif /* CLIENT_H */
@@ -0,0 +1,213 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Incremental Command Block Extractor Implementation
+ *===========================================================================*/
+
+#include "cmd_extract.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/* 围栏最少反引号数量 */
+#define FENCE_MIN_TICKS 3
+
+/* 视为可执行命令的代码块语言（空串表示未标注语言） */
+static const char *command_languages[] = {
+    "", "bash", "sh", "zsh", "shell", "powershell", "pwsh", NULL
+};
+
+/* 判断语言标记是否为命令语言（只取第一个单词，忽略大小写） */
+static bool is_command_language(const char *info, size_t info_len) {
+    size_t start = 0;
+    while (start < info_len && (info[start] == ' ' || info[start] == '\t')) start++;
+
+    size_t end = start;
+    while (end < info_len && info[end] != ' ' && info[end] != '\t' && info[end] != '{') end++;
+
+    size_t word_len = end - start;
+    for (int i = 0; command_languages[i]; i++) {
+        if (strlen(command_languages[i]) != word_len) continue;
+
+        bool match = true;
+        for (size_t j = 0; j < word_len; j++) {
+            if (tolower((unsigned char)info[start + j]) != command_languages[i][j]) {
+                match = false;
+                break;
+            }
+        }
+        if (match) return true;
+    }
+
+    return false;
+}
+
+static bool block_append(CommandExtractor *extractor, const char *text, size_t len) {
+    if (extractor->block_len + len + 1 > extractor->block_cap) {
+        size_t new_cap = extractor->block_cap ? extractor->block_cap : 256;
+        while (extractor->block_len + len + 1 > new_cap) {
+            new_cap *= 2;
+        }
+
+        char *new_block = (char *)arena_resize(extractor->arena, extractor->block,
+                                               extractor->block_cap, new_cap);
+        if (!new_block) {
+            fprintf(stderr, "Error: Failed to realloc command buffer\n");
+            return false;
+        }
+        extractor->block = new_block;
+        extractor->block_cap = new_cap;
+    }
+
+    memcpy(extractor->block + extractor->block_len, text, len);
+    extractor->block_len += len;
+    extractor->block[extractor->block_len] = '\0';
+    return true;
+}
+
+/* 代码块结束：命令块内容去除首尾空白后成为当前命令 */
+static const char* close_block(CommandExtractor *extractor) {
+    const char *result = NULL;
+
+    if (extractor->accept && extractor->block) {
+        const char *start = extractor->block;
+        const char *end = extractor->block + extractor->block_len;
+
+        while (start < end && isspace((unsigned char)*start)) start++;
+        while (end > start && isspace((unsigned char)*(end - 1))) end--;
+
+        if (end > start) {
+            char *command = arena_strndup(extractor->arena, start, (size_t)(end - start));
+            if (command) {
+                arena_free(extractor->arena, extractor->command);
+                extractor->command = command;
+                result = command;
+            }
+        }
+    }
+
+    extractor->state = CMD_STATE_TEXT;
+    extractor->block_len = 0;
+    extractor->tick_run = 0;
+    return result;
+}
+
+void cmd_extractor_init(CommandExtractor *extractor, Arena *arena) {
+    if (!extractor) return;
+    memset(extractor, 0, sizeof(CommandExtractor));
+    extractor->state = CMD_STATE_TEXT;
+    extractor->arena = arena;
+}
+
+void cmd_extractor_free(CommandExtractor *extractor) {
+    if (!extractor) return;
+
+    arena_free(extractor->arena, extractor->command);
+    arena_free(extractor->arena, extractor->block);
+    memset(extractor, 0, sizeof(CommandExtractor));
+}
+
+const char* cmd_extractor_feed(CommandExtractor *extractor, const char *text, size_t len) {
+    if (!extractor || !text) return NULL;
+
+    const char *completed = NULL;
+    const char *p = text;
+    const char *end = text + len;
+
+    while (p < end) {
+        char c = *p;
+
+        switch (extractor->state) {
+            case CMD_STATE_TEXT:
+                if (c == '`') {
+                    extractor->tick_run++;
+                    p++;
+                } else if (extractor->tick_run >= FENCE_MIN_TICKS) {
+                    /* 开始围栏：接下来是语言标记（当前字符在 INFO 状态中重新处理） */
+                    extractor->state = CMD_STATE_INFO;
+                    extractor->fence_len = extractor->tick_run;
+                    extractor->tick_run = 0;
+                    extractor->info_len = 0;
+                } else {
+                    /* 快速跳到下一个反引号 */
+                    extractor->tick_run = 0;
+                    const char *tick = memchr(p, '`', (size_t)(end - p));
+                    p = tick ? tick : end;
+                }
+                break;
+
+            case CMD_STATE_INFO:
+                if (c == '\n') {
+                    extractor->accept = is_command_language(extractor->info, extractor->info_len);
+                    extractor->state = CMD_STATE_BLOCK;
+                    extractor->block_len = 0;
+                    extractor->tick_run = 0;
+                } else if (c == '`') {
+                    /* 语言标记中不能出现反引号：不是围栏 */
+                    extractor->state = CMD_STATE_TEXT;
+                    extractor->tick_run = 1;
+                } else if (c != '\r' && extractor->info_len < sizeof(extractor->info) - 1) {
+                    extractor->info[extractor->info_len++] = c;
+                }
+                p++;
+                break;
+
+            case CMD_STATE_BLOCK:
+                if (c == '`') {
+                    extractor->tick_run++;
+                    p++;
+                    if (extractor->tick_run == extractor->fence_len) {
+                        /* 结束围栏：立即触发，不等待后续文本 */
+                        const char *command = close_block(extractor);
+                        if (command) completed = command;
+                    }
+                } else {
+                    /* 不足以构成结束围栏的反引号属于代码内容 */
+                    while (extractor->tick_run > 0) {
+                        if (extractor->accept) block_append(extractor, "`", 1);
+                        extractor->tick_run--;
+                    }
+
+                    /* 批量追加到下一个反引号之前的内容 */
+                    const char *tick = memchr(p, '`', (size_t)(end - p));
+                    const char *run_end = tick ? tick : end;
+                    if (extractor->accept) {
+                        block_append(extractor, p, (size_t)(run_end - p));
+                    }
+                    p = run_end;
+                }
+                break;
+        }
+    }
+
+    return completed;
+}
+
+const char* cmd_extractor_finish(CommandExtractor *extractor) {
+    if (!extractor || extractor->state != CMD_STATE_BLOCK) return NULL;
+
+    /* 回答在命令块中途结束（例如达到 max_tokens），使用已收到的内容 */
+    extractor->tick_run = 0;
+    return close_block(extractor);
+}
+
+char* cmd_extractor_take(CommandExtractor *extractor) {
+    if (!extractor) return NULL;
+
+    char *command = extractor->command;
+    extractor->command = NULL;
+    return command;
+}
+
+char* cmd_extract_from_text(Arena *arena, const char *text) {
+    if (!text) return NULL;
+
+    CommandExtractor extractor;
+    cmd_extractor_init(&extractor, arena);
+    cmd_extractor_feed(&extractor, text, strlen(text));
+    cmd_extractor_finish(&extractor);
+
+    char *command = cmd_extractor_take(&extractor);
+    cmd_extractor_free(&extractor);
+    return command;
+}
@@ -0,0 +1,62 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Incremental Command Block Extractor Header
+ *===========================================================================*/
+
+#ifndef CMD_EXTRACT_H
+#define CMD_EXTRACT_H
+
+#include "arena.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* 代码块围栏识别状态 */
+typedef enum {
+    CMD_STATE_TEXT,      /* 普通文本，寻找 ``` */
+    CMD_STATE_INFO,      /* 已读到开始围栏，读取语言标记直到换行 */
+    CMD_STATE_BLOCK      /* 代码块内部，寻找结束围栏 */
+} CommandExtractState;
+
+/* 增量命令块提取器
+ * 逐片段输入回答文本，围栏可以被任意拆分在多个片段之间。
+ * 识别 bash / sh / zsh / shell / powershell / pwsh 以及未标注语言的代码块，
+ * 其他语言（json、python 等）的代码块会被跳过；出现多个命令块时以最后一个为准。
+ */
+typedef struct {
+    Arena *arena;               /* 缓冲区所在的内存池（NULL 时使用 malloc） */
+    CommandExtractState state;
+    size_t tick_run;            /* 连续反引号计数（可跨片段） */
+    size_t fence_len;           /* 开始围栏的反引号数量 */
+
+    char info[32];              /* 语言标记 */
+    size_t info_len;
+    bool accept;                /* 当前代码块是否为命令块 */
+
+    char *block;                /* 当前代码块内容 */
+    size_t block_len;
+    size_t block_cap;
+
+    char *command;              /* 最近一个完整的命令（已去除首尾空白） */
+} CommandExtractor;
+
+/* 函数声明 */
+void cmd_extractor_init(CommandExtractor *extractor, Arena *arena);
+void cmd_extractor_free(CommandExtractor *extractor);
+
+/* 输入一个回答片段
+ * 有命令块在本片段内闭合时返回该命令（指向内部缓冲区），否则返回 NULL
+ */
+const char* cmd_extractor_feed(CommandExtractor *extractor, const char *text, size_t len);
+
+/* 输入结束：未闭合但有内容的命令块也视为命令
+ * 因此产生新命令时返回该命令，否则返回 NULL
+ */
+const char* cmd_extractor_finish(CommandExtractor *extractor);
+
+/* 取出最终命令（从 arena 分配；arena 为 NULL 时由调用者 free），没有命令时返回 NULL */
+char* cmd_extractor_take(CommandExtractor *extractor);
+
+/* 从完整文本中提取最后一个命令块（非流式响应使用），没有命令时返回 NULL */
+char* cmd_extract_from_text(Arena *arena, const char *text);
+
+#endif /* CMD_EXTRACT_H */
@@ -24,6 +24,14 @@ Config* config_create(void) {
     cfg->memory_enabled = DEFAULT_MEMORY_ENABLED;
     cfg->memory_rounds = DEFAULT_MEMORY_ROUNDS;
     cfg->stream_enabled = DEFAULT_STREAM_ENABLED;
+    cfg->stop_after_command = DEFAULT_STOP_AFTER_COMMAND;
+    cfg->thinking = NULL;
+    cfg->cache_enabled = DEFAULT_CACHE_ENABLED;
+    cfg->cache_ttl = DEFAULT_CACHE_TTL;
+    cfg->cache_max_entries = DEFAULT_CACHE_MAX_ENTRIES;
+    cfg->cache_similarity = DEFAULT_CACHE_SIMILARITY;
+    cfg->cache_background_refresh = DEFAULT_CACHE_BACKGROUND_REFRESH;
+    cfg->cache_refresh = false;
     cfg->temperature = DEFAULT_TEMP;
     cfg->max_tokens = DEFAULT_MAX_TOKENS;
     cfg->timeout = DEFAULT_TIMEOUT;
@@ -39,6 +47,7 @@ void config_destroy(Config *cfg) {
     if (cfg->model) free(cfg->model);
     if (cfg->endpoint) free(cfg->endpoint);
     if (cfg->user_prompt) free(cfg->user_prompt);
+    if (cfg->thinking) free(cfg->thinking);
 
     free(cfg);
 }
@@ -68,6 +77,18 @@ static void copy_from_config_file(Config *cfg, const ConfigFile *file_cfg) {
     cfg->memory_enabled = file_cfg->memory_enabled;
     cfg->memory_rounds = file_cfg->memory_rounds;
     cfg->stream_enabled = file_cfg->stream_enabled;
+    cfg->stop_after_command = file_cfg->stop_after_command;
+
+    if (file_cfg->thinking) {
+        if (cfg->thinking) free(cfg->thinking);
+        cfg->thinking = strdup(file_cfg->thinking);
+    }
+
+    cfg->cache_enabled = file_cfg->cache_enabled;
+    cfg->cache_ttl = file_cfg->cache_ttl;
+    cfg->cache_max_entries = file_cfg->cache_max_entries;
+    cfg->cache_similarity = file_cfg->cache_similarity;
+    cfg->cache_background_refresh = file_cfg->cache_background_refresh;
 
     cfg->temperature = file_cfg->temperature;
     cfg->max_tokens = file_cfg->max_tokens;
@@ -208,19 +229,34 @@ bool config_load(Config *cfg) {
         cfg->user_prompt = strdup(env_val);
     }
 
+    env_val = getenv("GLM_CMD_STOP_AFTER_COMMAND");
+    if (env_val && strlen(env_val) > 0) {
+        cfg->stop_after_command = (strcmp(env_val, "1") == 0 || strcmp(env_val, "true") == 0);
+    }
+
+    env_val = getenv("GLM_CMD_THINKING");
+    if (env_val && strlen(env_val) > 0) {
+        if (cfg->thinking) free(cfg->thinking);
+        cfg->thinking = strdup(env_val);
+    }
+
     env_val = getenv("GLM_CMD_VERBOSE");
     if (env_val && (strcmp(env_val, "1") == 0 || strcmp(env_val, "true") == 0)) {
         cfg->verbose = true;
     }
 
-    /* 3. 检查是否有 API Key */
+    return true;
+}
+
+bool config_validate(const Config *cfg) {
+    /* 检查是否有 API Key */
     if (!cfg->api_key || strlen(cfg->api_key) == 0) {
         fprintf(stderr, "Error: API Key not configured. Please set GLM_CMD_API_KEY environment variable\n");
         fprintf(stderr, "or create a config file at ~/.glm-cmd/config.ini\n");
         return false;
     }
 
-    /* 4. 检查是否有端点 */
+    /* 检查是否有端点 */
     if (!cfg->endpoint || strlen(cfg->endpoint) == 0) {
         fprintf(stderr, "Error: API endpoint not configured. Please set GLM_CMD_ENDPOINT environment variable\n");
         fprintf(stderr, "or add 'endpoint' to your config file at ~/.glm-cmd/config.ini\n");
@@ -258,6 +294,26 @@ void config_print(const Config *cfg) {
 
     /* 流式输出功能 */
     printf("  Streaming: %s\n", cfg->stream_enabled ? "enabled" : "disabled");
+    if (cfg->stream_enabled) {
+        printf("  Stop After Command: %s\n", cfg->stop_after_command ? "enabled" : "disabled");
+    }
+
+    /* 深度思考模式 */
+    printf("  Thinking: %s\n", cfg->thinking && strlen(cfg->thinking) > 0
+                                 ? cfg->thinking : "(model default)");
+
+    /* 本地响应缓存 */
+    printf("  Response Cache: %s\n", cfg->cache_enabled ? "enabled" : "disabled");
+    if (cfg->cache_enabled) {
+        printf("  Cache TTL: %d seconds\n", cfg->cache_ttl);
+        printf("  Cache Max Entries: %d\n", cfg->cache_max_entries);
+        if (cfg->cache_similarity > 0) {
+            printf("  Cache Similarity: %.2f (background refresh %s)\n", cfg->cache_similarity,
+                   cfg->cache_background_refresh ? "enabled" : "disabled");
+        } else {
+            printf("  Cache Similarity: disabled (exact matches only)\n");
+        }
+    }
 
     /* API Key（隐藏部分） */
     if (cfg->api_key) {
@@ -16,6 +16,12 @@
 #define DEFAULT_MEMORY_ENABLED false
 #define DEFAULT_MEMORY_ROUNDS 5
 #define DEFAULT_STREAM_ENABLED true
+#define DEFAULT_STOP_AFTER_COMMAND false
+#define DEFAULT_CACHE_ENABLED true
+#define DEFAULT_CACHE_TTL (7 * 24 * 3600)  /* 响应缓存有效期（秒） */
+#define DEFAULT_CACHE_MAX_ENTRIES 500
+#define DEFAULT_CACHE_SIMILARITY 0.0   /* 相似匹配阈值，0 表示只精确匹配 */
+#define DEFAULT_CACHE_BACKGROUND_REFRESH false
 
 /* 常用端点 */
 #define ENDPOINT_CODING "https://open.bigmodel.cn/api/coding/paas/v4"
@@ -30,6 +36,14 @@ typedef struct {
     bool memory_enabled;  /* 是否启用对话记忆 */
     int memory_rounds;   /* 记忆的对话轮数 */
     bool stream_enabled; /* 是否启用流式输出 */
+    bool stop_after_command; /* 收到完整命令块后立即结束流式传输 */
+    char *thinking;      /* 深度思考模式（enabled/disabled），NULL 时使用模型默认值 */
+    bool cache_enabled;  /* 是否启用本地响应缓存 */
+    int cache_ttl;       /* 缓存条目有效期（秒），0 表示不过期 */
+    int cache_max_entries; /* 缓存最多保留的条目数 */
+    double cache_similarity; /* 相似匹配阈值（n-gram Jaccard，0-1），0 表示只精确匹配 */
+    bool cache_background_refresh; /* 相似匹配命中后在后台重新请求并更新缓存 */
+    bool cache_refresh;  /* 跳过缓存查找，重新请求并更新缓存（--refresh） */
     double temperature;
     int max_tokens;
     int timeout;
@@ -42,6 +56,8 @@ void config_destroy(Config *cfg);
 bool config_load_from_env(Config *cfg);
 bool config_load_from_file(Config *cfg);
 bool config_load(Config *cfg);
+/* 检查发送请求所需的 API Key 和端点（重放录制的响应时不需要） */
+bool config_validate(const Config *cfg);
 void config_print(const Config *cfg);
 
 #endif /* CONFIG_H */
@@ -76,6 +76,13 @@ ConfigFile* config_file_create(void) {
     cfg->memory_enabled = false;
     cfg->memory_rounds = 5;
     cfg->stream_enabled = true;
+    cfg->stop_after_command = false;
+    cfg->thinking = NULL;
+    cfg->cache_enabled = true;
+    cfg->cache_ttl = 7 * 24 * 3600;
+    cfg->cache_max_entries = 500;
+    cfg->cache_similarity = 0.0;
+    cfg->cache_background_refresh = false;
     cfg->temperature = 0.7;
     cfg->max_tokens = 2048;
     cfg->timeout = 30;
@@ -90,6 +97,7 @@ void config_file_destroy(ConfigFile *cfg) {
     if (cfg->model) free(cfg->model);
     if (cfg->endpoint) free(cfg->endpoint);
     if (cfg->user_prompt) free(cfg->user_prompt);
+    if (cfg->thinking) free(cfg->thinking);
 
     free(cfg);
 }
@@ -212,6 +220,34 @@ bool config_file_read(const char *path, ConfigFile *cfg) {
                 cfg->stream_enabled = (strcmp(unquoted_value, "true") == 0 ||
                                       strcmp(unquoted_value, "1") == 0);
             }
+            /* Stop After Command */
+            else if (strcmp(key, "stop_after_command") == 0) {
+                cfg->stop_after_command = (strcmp(unquoted_value, "true") == 0 ||
+                                          strcmp(unquoted_value, "1") == 0);
+            }
+            /* Thinking */
+            else if (strcmp(key, "thinking") == 0) {
+                if (cfg->thinking) free(cfg->thinking);
+                cfg->thinking = strdup(unquoted_value);
+            }
+            /* Response Cache */
+            else if (strcmp(key, "cache_enabled") == 0) {
+                cfg->cache_enabled = (strcmp(unquoted_value, "true") == 0 ||
+                                     strcmp(unquoted_value, "1") == 0);
+            }
+            else if (strcmp(key, "cache_ttl") == 0) {
+                cfg->cache_ttl = atoi(unquoted_value);
+            }
+            else if (strcmp(key, "cache_max_entries") == 0) {
+                cfg->cache_max_entries = atoi(unquoted_value);
+            }
+            else if (strcmp(key, "cache_similarity") == 0) {
+                cfg->cache_similarity = atof(unquoted_value);
+            }
+            else if (strcmp(key, "cache_background_refresh") == 0) {
+                cfg->cache_background_refresh = (strcmp(unquoted_value, "true") == 0 ||
+                                                strcmp(unquoted_value, "1") == 0);
+            }
             /* Temperature */
             else if (strcmp(key, "temperature") == 0) {
                 cfg->temperature = atof(unquoted_value);
@@ -282,6 +318,30 @@ bool config_file_write(const char *path, const ConfigFile *cfg) {
     fprintf(fp, "# Stream output settings\n");
     fprintf(fp, "# stream_enabled: Enable/disable streaming output (real-time display)\n");
     fprintf(fp, "stream_enabled=%s\n", cfg->stream_enabled ? "true" : "false");
+    fprintf(fp, "# stop_after_command: End the stream as soon as the command block is complete\n");
+    fprintf(fp, "stop_after_command=%s\n", cfg->stop_after_command ? "true" : "false");
+    fprintf(fp, "\n");
+
+    if (cfg->thinking) {
+        fprintf(fp, "# Thinking mode sent as thinking.type (enabled/disabled)\n");
+        fprintf(fp, "# Leave empty to use the model default\n");
+        fprintf(fp, "thinking=\"%s\"\n", cfg->thinking);
+        fprintf(fp, "\n");
+    }
+
+    fprintf(fp, "# Local response cache settings\n");
+    fprintf(fp, "# cache_enabled: Answer repeated queries from ~/.glm-cmd/response_cache.idx\n");
+    fprintf(fp, "# cache_ttl: Seconds a cached answer stays valid (0 = never expires)\n");
+    fprintf(fp, "# cache_max_entries: Maximum number of cached answers (least recently used are dropped)\n");
+    fprintf(fp, "# cache_similarity: Also answer similar queries whose character n-gram similarity\n");
+    fprintf(fp, "#                   is at least this value (0.0 - 1.0, e.g. 0.8; 0 = exact matches only)\n");
+    fprintf(fp, "# cache_background_refresh: After a similar match, query the API in the background\n");
+    fprintf(fp, "#                           and cache the answer for the new wording\n");
+    fprintf(fp, "cache_enabled=%s\n", cfg->cache_enabled ? "true" : "false");
+    fprintf(fp, "cache_ttl=%d\n", cfg->cache_ttl);
+    fprintf(fp, "cache_max_entries=%d\n", cfg->cache_max_entries);
+    fprintf(fp, "cache_similarity=%.2f\n", cfg->cache_similarity);
+    fprintf(fp, "cache_background_refresh=%s\n", cfg->cache_background_refresh ? "true" : "false");
     fprintf(fp, "\n");
 
     fprintf(fp, "# Temperature parameter (0.0 - 2.0, default: 0.7)\n");
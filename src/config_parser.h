@@ -20,6 +20,13 @@ typedef struct {
     bool memory_enabled;  /* 是否启用对话记忆 */
     int memory_rounds;   /* 记忆的对话轮数 */
     bool stream_enabled; /* 是否启用流式输出 */
+    bool stop_after_command; /* 收到完整命令块后立即结束流式传输 */
+    char *thinking;      /* 深度思考模式（enabled/disabled） */
+    bool cache_enabled;  /* 是否启用本地响应缓存 */
+    int cache_ttl;       /* 缓存条目有效期（秒） */
+    int cache_max_entries; /* 缓存最多保留的条目数 */
+    double cache_similarity; /* 相似匹配阈值 */
+    bool cache_background_refresh; /* 相似匹配命中后在后台刷新 */
     double temperature;
     int max_tokens;
     int timeout;
@@ -0,0 +1,672 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Resident Daemon (glm-cmdd) Implementation
+ *===========================================================================*/
+
+/* struct ucred (SO_PEERCRED) 需要 _GNU_SOURCE */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
+#include "daemon.h"
+#include "session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+    #include <unistd.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <signal.h>
+    #include <stdint.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <arpa/inet.h>
+    #include <pthread.h>
+#endif
+
+bool daemon_get_socket_path(char *path, size_t path_size) {
+    if (!path || path_size == 0) return false;
+
+    const char *env_path = getenv("GLM_CMD_SOCKET");
+    if (env_path && strlen(env_path) > 0) {
+        snprintf(path, path_size, "%s", env_path);
+        return true;
+    }
+
+    char config_dir[512];
+    if (!session_get_config_dir(config_dir, sizeof(config_dir))) {
+        return false;
+    }
+
+    snprintf(path, path_size, "%s/%s", config_dir, DAEMON_SOCKET_NAME);
+    return true;
+}
+
+#ifdef _WIN32
+
+int daemon_run(bool foreground) {
+    (void)foreground;
+    fprintf(stderr, "Error: The resident daemon is not supported on Windows\n");
+    return 1;
+}
+
+int daemon_stop(void) {
+    fprintf(stderr, "Error: The resident daemon is not supported on Windows\n");
+    return 1;
+}
+
+int daemon_connect(void) {
+    return -1;
+}
+
+int daemon_query(int fd, const char *user_input, StreamCallback callback, void *userdata,
+                 ApiResponse *response, bool *streamed) {
+    (void)fd; (void)user_input; (void)callback; (void)userdata; (void)response; (void)streamed;
+    return -1;
+}
+
+#else
+
+/* 同时处理的客户端连接上限：超出时直接关闭连接，客户端回退到本地执行 */
+#define DAEMON_MAX_CLIENTS 8
+
+/* 会话池：每个连接在独立线程中处理，同一时刻一个会话只被一个线程使用。
+ * 空闲会话按后进先出复用：连续的查询总是拿到最近用过的会话，连接仍然是热的；
+ * 多个终端同时查询时才创建更多会话。会话的创建和销毁涉及进程级状态
+ * （curl 全局初始化、启动计时），在池的锁内进行。
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t drained;                 /* active 降为 0 */
+    Session *idle[DAEMON_MAX_CLIENTS];      /* 空闲会话（栈顶为最近用过的） */
+    int idle_count;
+    int active;                             /* 正在处理的连接数 */
+} SessionPool;
+
+typedef struct {
+    SessionPool *pool;
+    int fd;
+} ClientTask;
+
+/* 收到 SIGTERM / SIGINT 或停止请求后退出主循环
+ * 写入 wake_pipe 唤醒等待新连接的主线程（可在信号处理函数和任意线程中调用）
+ */
+static volatile sig_atomic_t stop_requested = 0;
+static int wake_pipe[2] = { -1, -1 };
+
+static void request_stop(void) {
+    if (wake_pipe[1] >= 0) {
+        ssize_t rc = write(wake_pipe[1], "x", 1);
+        (void)rc;
+    }
+}
+
+static void handle_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+    request_stop();
+}
+
+/* 完整写入数据（处理部分写入和 EINTR） */
+static bool write_all(int fd, const void *data, size_t len) {
+    const char *ptr = (const char *)data;
+    while (len > 0) {
+        ssize_t n = send(fd, ptr, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        ptr += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* 完整读取数据（处理部分读取和 EINTR） */
+static bool read_all(int fd, void *data, size_t len) {
+    char *ptr = (char *)data;
+    while (len > 0) {
+        ssize_t n = recv(fd, ptr, len, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) return false;  /* 对端关闭 */
+        ptr += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* 发送一帧：类型 + 长度 + 数据 */
+static bool send_frame(int fd, char type, const char *data, size_t len) {
+    unsigned char header[5];
+    uint32_t net_len = htonl((uint32_t)len);
+
+    header[0] = (unsigned char)type;
+    memcpy(header + 1, &net_len, 4);
+
+    /* 小帧合并为一次写入，减少系统调用 */
+    if (len <= 4096) {
+        char frame[5 + 4096];
+        memcpy(frame, header, 5);
+        if (len > 0) memcpy(frame + 5, data, len);
+        return write_all(fd, frame, 5 + len);
+    }
+
+    return write_all(fd, header, 5) && write_all(fd, data, len);
+}
+
+/* 接收一帧，数据以 '\0' 结尾，调用者负责释放 */
+static bool recv_frame(int fd, char *type, char **data, size_t *len) {
+    unsigned char header[5];
+    uint32_t net_len;
+
+    if (!read_all(fd, header, 5)) return false;
+
+    memcpy(&net_len, header + 1, 4);
+    *type = (char)header[0];
+    *len = ntohl(net_len);
+
+    /* 防止异常帧导致超大分配 */
+    if (*len > 64 * 1024 * 1024) return false;
+
+    *data = (char *)malloc(*len + 1);
+    if (!*data) return false;
+
+    if (*len > 0 && !read_all(fd, *data, *len)) {
+        free(*data);
+        *data = NULL;
+        return false;
+    }
+    (*data)[*len] = '\0';
+    return true;
+}
+
+int daemon_connect(void) {
+    char path[512];
+    if (!daemon_get_socket_path(path, sizeof(path))) return -1;
+
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* 守护进程端的转发回调：把流式片段写回客户端 */
+static void relay_callback(const char *content, StreamContentType content_type, void *userdata) {
+    int fd = *(int *)userdata;
+    char type;
+
+    switch (content_type) {
+        case STREAM_CONTENT_REASONING: type = DAEMON_FRAME_REASONING; break;
+        case STREAM_CONTENT_ANSWER:    type = DAEMON_FRAME_ANSWER; break;
+        case STREAM_CONTENT_COMMAND:   type = DAEMON_FRAME_CMD_READY; break;
+        case STREAM_CONTENT_DONE:      type = DAEMON_FRAME_DONE; break;
+        default: return;
+    }
+
+    /* 客户端断开时忽略写入失败，请求照常完成并保存历史 */
+    send_frame(fd, type, content, strlen(content));
+}
+
+/* 取一个空闲会话（没有时新建），并与磁盘上的配置和历史同步 */
+static Session* pool_acquire(SessionPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    Session *session = pool->idle_count > 0 ? pool->idle[--pool->idle_count] : NULL;
+
+    /* 配置文件已修改：丢弃旧会话，按新配置重新加载 */
+    if (session && !session_refresh(session)) {
+        session_destroy(session);
+        session = NULL;
+    }
+    if (!session) {
+        session = session_create(false);
+    }
+    if (session && !session->client) {
+        session->client = client_create();
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return session;
+}
+
+static void pool_release(SessionPool *pool, Session *session) {
+    pthread_mutex_lock(&pool->lock);
+    if (pool->idle_count < DAEMON_MAX_CLIENTS) {
+        pool->idle[pool->idle_count++] = session;
+    } else {
+        session_destroy(session);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* 处理单个客户端连接 */
+static void handle_client(SessionPool *pool, int fd) {
+    char type;
+    char *data = NULL;
+    size_t len = 0;
+
+    if (!recv_frame(fd, &type, &data, &len)) return;
+
+    if (type == DAEMON_FRAME_SHUTDOWN) {
+        send_frame(fd, DAEMON_FRAME_FINISH, "\1\0", 2);
+        free(data);
+        request_stop();
+        return;
+    }
+
+    if (type != DAEMON_FRAME_QUERY || len == 0) {
+        send_frame(fd, DAEMON_FRAME_ERROR, "Invalid request", strlen("Invalid request"));
+        send_frame(fd, DAEMON_FRAME_FINISH, "\0\0", 2);
+        free(data);
+        return;
+    }
+
+    Session *session = pool_acquire(pool);
+    ApiResponse *response = session ? api_response_create() : NULL;
+    if (!response) {
+        const char *message = "glm-cmdd failed to load its configuration";
+        if (session) pool_release(pool, session);
+        send_frame(fd, DAEMON_FRAME_ERROR, message, strlen(message));
+        send_frame(fd, DAEMON_FRAME_FINISH, "\0\0", 2);
+        free(data);
+        return;
+    }
+
+    bool success = session_query(session, data, relay_callback, &fd, response);
+    bool streamed = session->cfg->stream_enabled && !response->cached;
+
+    if (response->thinking_process && !streamed) {
+        send_frame(fd, DAEMON_FRAME_THINKING, response->thinking_process,
+                   strlen(response->thinking_process));
+    }
+    if (response->command) {
+        send_frame(fd, DAEMON_FRAME_COMMAND, response->command, strlen(response->command));
+    }
+    if (response->error_message) {
+        send_frame(fd, DAEMON_FRAME_ERROR, response->error_message,
+                   strlen(response->error_message));
+    }
+    if (response->cached_query) {
+        send_frame(fd, DAEMON_FRAME_SIMILAR, response->cached_query,
+                   strlen(response->cached_query));
+    }
+
+    /* 相似度向下取整，命中时至少为 1 */
+    int percent = (int)(response->cache_similarity * 100);
+    if (response->cached && percent < 1) percent = 1;
+    char finish[4] = { (char)(success && response->success), (char)streamed,
+                       (char)response->truncated, (char)(response->cached ? percent : 0) };
+    send_frame(fd, DAEMON_FRAME_FINISH, finish, 4);
+
+    pool_release(pool, session);
+    api_response_destroy(response);
+    free(data);
+}
+
+
+/* 创建监听套接字；若已有守护进程在运行则返回 -1 */
+static int create_listener(const char *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", path);
+        return -1;
+    }
+
+    /* 已有守护进程在监听 */
+    int probe = daemon_connect();
+    if (probe >= 0) {
+        close(probe);
+        fprintf(stderr, "Error: glm-cmdd is already running (%s)\n", path);
+        return -1;
+    }
+
+    /* 清理上次异常退出遗留的套接字文件 */
+    unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    /* 套接字仅允许当前用户访问 */
+    mode_t old_mask = umask(0077);
+    int rc = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_mask);
+
+    if (rc != 0 || listen(fd, 16) != 0) {
+        perror("bind/listen");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* 检查对端是否为同一用户 */
+static bool peer_is_same_user(int fd) {
+#if defined(SO_PEERCRED)
+    struct ucred cred;
+    socklen_t cred_len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) == 0) {
+        return cred.uid == getuid();
+    }
+    return false;
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+    uid_t uid;
+    gid_t gid;
+    if (getpeereid(fd, &uid, &gid) == 0) {
+        return uid == getuid();
+    }
+    return false;
+#else
+    (void)fd;
+    return true;  /* 依赖套接字文件权限 (0600) */
+#endif
+}
+
+static void* client_thread(void *arg) {
+    ClientTask *task = (ClientTask *)arg;
+    SessionPool *pool = task->pool;
+
+    if (peer_is_same_user(task->fd)) {
+        handle_client(pool, task->fd);
+    }
+    close(task->fd);
+    free(task);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->active == 0) pthread_cond_signal(&pool->drained);
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/* 在新线程中处理连接；达到并发上限或无法创建线程时返回 false */
+static bool dispatch_client(SessionPool *pool, int fd) {
+    pthread_mutex_lock(&pool->lock);
+    bool busy = pool->active >= DAEMON_MAX_CLIENTS;
+    if (!busy) pool->active++;
+    pthread_mutex_unlock(&pool->lock);
+    if (busy) return false;
+
+    ClientTask *task = (ClientTask *)malloc(sizeof(ClientTask));
+    pthread_t thread;
+    if (task) {
+        task->pool = pool;
+        task->fd = fd;
+
+        /* 工作线程屏蔽停止信号，信号总是由主线程处理 */
+        sigset_t block, old_mask;
+        sigemptyset(&block);
+        sigaddset(&block, SIGTERM);
+        sigaddset(&block, SIGINT);
+        pthread_sigmask(SIG_BLOCK, &block, &old_mask);
+        bool started = pthread_create(&thread, NULL, client_thread, task) == 0;
+        pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+
+        if (started) {
+            pthread_detach(thread);
+            return true;
+        }
+        free(task);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->active--;
+    pthread_mutex_unlock(&pool->lock);
+    return false;
+}
+
+int daemon_run(bool foreground) {
+    char path[512];
+    if (!daemon_get_socket_path(path, sizeof(path))) {
+        fprintf(stderr, "Error: Unable to determine daemon socket path\n");
+        return 1;
+    }
+
+    /* 常驻状态：配置、系统信息和对话历史在查询之间保留（文件变化时重新加载） */
+    Session *session = session_create(false);
+    if (!session) {
+        return 1;
+    }
+
+    mkdir(session->config_dir, 0700);
+
+    int listen_fd = create_listener(path);
+    if (listen_fd < 0) {
+        session_destroy(session);
+        return 1;
+    }
+
+    if (!foreground) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            close(listen_fd);
+            unlink(path);
+            session_destroy(session);
+            return 1;
+        }
+        if (pid > 0) {
+            printf("glm-cmdd started (pid %d), listening on %s\n", (int)pid, path);
+            close(listen_fd);
+            session_destroy(session);
+            return 0;
+        }
+
+        /* 子进程：脱离终端，输出重定向到日志文件 */
+        setsid();
+        char log_path[600];
+        snprintf(log_path, sizeof(log_path), "%s/glm-cmdd.log", session->config_dir);
+        int null_fd = open("/dev/null", O_RDONLY);
+        int log_fd = open(log_path, O_WRONLY | O_CREAT | O_APPEND, 0600);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDIN_FILENO);
+            close(null_fd);
+        }
+        if (log_fd >= 0) {
+            dup2(log_fd, STDOUT_FILENO);
+            dup2(log_fd, STDERR_FILENO);
+            close(log_fd);
+        }
+    }
+
+    if (pipe(wake_pipe) != 0) {
+        perror("pipe");
+        close(listen_fd);
+        unlink(path);
+        session_destroy(session);
+        return 1;
+    }
+    fcntl(wake_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(wake_pipe[1], F_SETFD, FD_CLOEXEC);
+    fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+
+    /* 启动时加载的会话作为第一个空闲会话 */
+    SessionPool pool;
+    memset(&pool, 0, sizeof(pool));
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.drained, NULL);
+    pool.idle[pool.idle_count++] = session;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signal;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "glm-cmdd: serving on %s\n", path);
+
+    while (!stop_requested) {
+        struct pollfd fds[2] = {
+            { listen_fd, POLLIN, 0 },
+            { wake_pipe[0], POLLIN, 0 },
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+        if (fds[1].revents) break;
+        if (!fds[0].revents) continue;
+
+        int client_fd = accept(listen_fd, NULL, NULL);
+        if (client_fd < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == ECONNABORTED) continue;
+            perror("accept");
+            break;
+        }
+        fcntl(client_fd, F_SETFD, FD_CLOEXEC);
+
+        /* 每个连接在独立线程中处理：其他终端的查询不必等待当前请求完成 */
+        if (!dispatch_client(&pool, client_fd)) {
+            close(client_fd);
+        }
+    }
+
+    close(listen_fd);
+    unlink(path);
+
+    /* 等待进行中的查询完成（其中可能还要保存对话历史） */
+    pthread_mutex_lock(&pool.lock);
+    while (pool.active > 0) {
+        pthread_cond_wait(&pool.drained, &pool.lock);
+    }
+    while (pool.idle_count > 0) {
+        session_destroy(pool.idle[--pool.idle_count]);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.drained);
+
+    fprintf(stderr, "glm-cmdd: stopped\n");
+    return 0;
+}
+
+int daemon_stop(void) {
+    int fd = daemon_connect();
+    if (fd < 0) {
+        fprintf(stderr, "glm-cmdd is not running\n");
+        return 1;
+    }
+
+    char type;
+    char *data = NULL;
+    size_t len = 0;
+    bool ok = send_frame(fd, DAEMON_FRAME_SHUTDOWN, NULL, 0) &&
+              recv_frame(fd, &type, &data, &len);
+    free(data);
+    close(fd);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to stop glm-cmdd\n");
+        return 1;
+    }
+
+    printf("glm-cmdd stopped\n");
+    return 0;
+}
+
+int daemon_query(int fd, const char *user_input, StreamCallback callback, void *userdata,
+                 ApiResponse *response, bool *streamed) {
+    if (fd < 0) return -1;
+    if (!user_input || !response) {
+        close(fd);
+        return -1;
+    }
+
+    if (!send_frame(fd, DAEMON_FRAME_QUERY, user_input, strlen(user_input))) {
+        close(fd);
+        return -1;
+    }
+
+    bool received_any = false;
+    bool finished = false;
+
+    while (!finished) {
+        char type;
+        char *data = NULL;
+        size_t len = 0;
+
+        if (!recv_frame(fd, &type, &data, &len)) break;
+        received_any = true;
+
+        switch (type) {
+            case DAEMON_FRAME_REASONING:
+                if (callback) callback(data, STREAM_CONTENT_REASONING, userdata);
+                break;
+            case DAEMON_FRAME_ANSWER:
+                if (callback) callback(data, STREAM_CONTENT_ANSWER, userdata);
+                break;
+            case DAEMON_FRAME_CMD_READY:
+                if (callback) callback(data, STREAM_CONTENT_COMMAND, userdata);
+                break;
+            case DAEMON_FRAME_DONE:
+                if (callback) callback(data, STREAM_CONTENT_DONE, userdata);
+                break;
+            case DAEMON_FRAME_THINKING:
+                response->thinking_process = arena_strndup(response->arena, data, len);
+                break;
+            case DAEMON_FRAME_COMMAND:
+                response->command = arena_strndup(response->arena, data, len);
+                break;
+            case DAEMON_FRAME_ERROR:
+                response->error_message = arena_strndup(response->arena, data, len);
+                break;
+            case DAEMON_FRAME_SIMILAR:
+                response->cached_query = arena_strndup(response->arena, data, len);
+                break;
+            case DAEMON_FRAME_FINISH:
+                response->success = len >= 1 && data[0] != 0;
+                if (streamed) *streamed = len >= 2 && data[1] != 0;
+                response->truncated = len >= 3 && data[2] != 0;
+                response->cached = len >= 4 && data[3] != 0;
+                response->cache_similarity = response->cached ? (unsigned char)data[3] / 100.0 : 0;
+                finished = true;
+                break;
+            default:
+                break;
+        }
+
+        free(data);
+    }
+
+    close(fd);
+
+    if (!finished) {
+        /* 尚未收到任何内容时允许调用者回退到本地执行 */
+        if (!received_any) return -1;
+        if (!response->error_message) {
+            response->error_message = arena_strdup(response->arena,
+                                                       "Connection to glm-cmdd lost");
+        }
+        response->success = false;
+    }
+
+    return 0;
+}
+
+#endif /* _WIN32 */
@@ -0,0 +1,49 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Resident Daemon (glm-cmdd) Header
+ *===========================================================================*/
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "api.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* 守护进程套接字文件名（位于 ~/.glm-cmd/ 下） */
+#define DAEMON_SOCKET_NAME "glm-cmdd.sock"
+
+/* 帧类型：每帧由 1 字节类型 + 4 字节长度（网络字节序）+ 数据组成 */
+#define DAEMON_FRAME_QUERY     'Q'  /* 客户端 -> 守护进程：用户输入 */
+#define DAEMON_FRAME_SHUTDOWN  'X'  /* 客户端 -> 守护进程：停止服务 */
+#define DAEMON_FRAME_REASONING 'R'  /* 思考过程片段 */
+#define DAEMON_FRAME_ANSWER    'A'  /* 最终回答片段 */
+#define DAEMON_FRAME_DONE      'D'  /* 流式结束标记 */
+#define DAEMON_FRAME_CMD_READY 'K'  /* 流式输出中命令块已闭合 */
+#define DAEMON_FRAME_THINKING  'T'  /* 非流式模式的完整思考过程 */
+#define DAEMON_FRAME_COMMAND   'C'  /* 提取出的命令 */
+#define DAEMON_FRAME_ERROR     'E'  /* 错误信息 */
+#define DAEMON_FRAME_SIMILAR   'S'  /* 相似匹配命中的原查询 */
+#define DAEMON_FRAME_FINISH    'F'  /* 结束帧：[success, streamed, truncated, cached]
+                                     * cached 为缓存命中的相似度百分比（0 表示未命中） */
+
+/* 获取守护进程套接字路径（可通过 GLM_CMD_SOCKET 覆盖） */
+bool daemon_get_socket_path(char *path, size_t path_size);
+
+/* 启动守护进程：foreground 为 false 时脱离终端在后台运行 */
+int daemon_run(bool foreground);
+
+/* 请求正在运行的守护进程退出 */
+int daemon_stop(void);
+
+/* 连接正在运行的守护进程，未运行时返回 -1 */
+int daemon_connect(void);
+
+/* 通过已连接的守护进程执行查询（函数返回前关闭 fd）
+ * 返回 -1：守护进程未返回任何内容（调用者应回退到本地执行）
+ * 返回  0：查询完成，结果写入 response；streamed 表示片段是否已通过 callback 实时输出
+ */
+int daemon_query(int fd, const char *user_input, StreamCallback callback, void *userdata,
+                 ApiResponse *response, bool *streamed);
+
+#endif /* DAEMON_H */
@@ -0,0 +1,478 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Streaming Delta Extractor Implementation
+ *===========================================================================*/
+
+#include "delta.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 最大嵌套深度（跳过未知字段时使用） */
+#define DELTA_MAX_DEPTH 64
+
+/* 扫描器：在 [p, end) 范围内前进，不要求输入以 '\0' 结尾 */
+typedef struct {
+    const char *p;
+    const char *end;
+} Scanner;
+
+#define KEY_IS(key, key_len, literal) \
+    ((key_len) == sizeof(literal) - 1 && memcmp((key), (literal), sizeof(literal) - 1) == 0)
+
+static void skip_ws(Scanner *s) {
+    while (s->p < s->end &&
+           (*s->p == ' ' || *s->p == '\t' || *s->p == '\n' || *s->p == '\r')) {
+        s->p++;
+    }
+}
+
+/* 跳过空白后若下一个字符为 c 则消费它 */
+static bool consume(Scanner *s, char c) {
+    skip_ws(s);
+    if (s->p < s->end && *s->p == c) {
+        s->p++;
+        return true;
+    }
+    return false;
+}
+
+static bool peek(Scanner *s, char c) {
+    skip_ws(s);
+    return s->p < s->end && *s->p == c;
+}
+
+/* 扫描字符串，返回引号内的原始内容；has_escape 标记是否包含转义序列 */
+static bool scan_string(Scanner *s, const char **start, size_t *len, bool *has_escape) {
+    if (!consume(s, '"')) return false;
+
+    const char *begin = s->p;
+    bool escaped = false;
+
+    /* 用 memchr 查找结束引号，只有遇到反斜杠时才逐个跳过转义 */
+    while (s->p < s->end) {
+        const char *quote = memchr(s->p, '"', (size_t)(s->end - s->p));
+        if (!quote) return false;
+
+        const char *backslash = memchr(s->p, '\\', (size_t)(quote - s->p));
+        if (!backslash) {
+            *start = begin;
+            *len = (size_t)(quote - begin);
+            *has_escape = escaped;
+            s->p = quote + 1;
+            return true;
+        }
+
+        escaped = true;
+        s->p = backslash + 2;
+    }
+
+    return false;
+}
+
+/* 跳过任意 JSON 值 */
+static bool skip_value(Scanner *s, int depth) {
+    const char *start;
+    size_t len;
+    bool has_escape;
+
+    if (depth > DELTA_MAX_DEPTH) return false;
+
+    skip_ws(s);
+    if (s->p >= s->end) return false;
+
+    switch (*s->p) {
+        case '"':
+            return scan_string(s, &start, &len, &has_escape);
+
+        case '{':
+            s->p++;
+            if (consume(s, '}')) return true;
+            do {
+                if (!scan_string(s, &start, &len, &has_escape)) return false;
+                if (!consume(s, ':')) return false;
+                if (!skip_value(s, depth + 1)) return false;
+            } while (consume(s, ','));
+            return consume(s, '}');
+
+        case '[':
+            s->p++;
+            if (consume(s, ']')) return true;
+            do {
+                if (!skip_value(s, depth + 1)) return false;
+            } while (consume(s, ','));
+            return consume(s, ']');
+
+        default:
+            /* 数字、true、false、null */
+            start = s->p;
+            while (s->p < s->end &&
+                   ((*s->p >= '0' && *s->p <= '9') || (*s->p >= 'a' && *s->p <= 'z') ||
+                    *s->p == '-' || *s->p == '+' || *s->p == '.' || *s->p == 'E')) {
+                s->p++;
+            }
+            return s->p > start;
+    }
+}
+
+/* 扫描对象的键（包含转义的键视为非预期结构） */
+static bool scan_key(Scanner *s, const char **key, size_t *key_len) {
+    bool has_escape;
+    if (!scan_string(s, key, key_len, &has_escape) || has_escape) return false;
+    return consume(s, ':');
+}
+
+/* 读取整数（小数部分截断，null 视为 0） */
+static bool read_int(Scanner *s, int *value) {
+    skip_ws(s);
+    if (peek(s, 'n')) {
+        *value = 0;
+        return skip_value(s, 0);
+    }
+
+    bool negative = false;
+    if (s->p < s->end && *s->p == '-') {
+        negative = true;
+        s->p++;
+    }
+
+    const char *digits = s->p;
+    long result = 0;
+    while (s->p < s->end && *s->p >= '0' && *s->p <= '9') {
+        if (result < 1000000000L) {
+            result = result * 10 + (*s->p - '0');
+        }
+        s->p++;
+    }
+    if (s->p == digits) return false;
+
+    /* 跳过小数和指数部分 */
+    while (s->p < s->end &&
+           ((*s->p >= '0' && *s->p <= '9') || *s->p == '.' || *s->p == 'e' ||
+            *s->p == 'E' || *s->p == '+' || *s->p == '-')) {
+        s->p++;
+    }
+
+    *value = (int)(negative ? -result : result);
+    return true;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool read_hex4(const char *p, const char *end, unsigned int *code) {
+    if (end - p < 4) return false;
+
+    unsigned int result = 0;
+    for (int i = 0; i < 4; i++) {
+        int v = hex_value(p[i]);
+        if (v < 0) return false;
+        result = (result << 4) | (unsigned int)v;
+    }
+    *code = result;
+    return true;
+}
+
+/* 将 Unicode 码点编码为 UTF-8，返回写入的字节数 */
+static size_t encode_utf8(unsigned int code, char *out) {
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    } else if (code < 0x800) {
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    } else if (code < 0x10000) {
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+/* 将原始字符串内容反转义到可复用缓冲区（反转义结果不会比原文更长） */
+static bool unescape_into(Arena *arena, const char *raw, size_t raw_len, bool has_escape,
+                          char **buffer, size_t *cap, size_t *out_len) {
+    if (raw_len + 1 > *cap) {
+        size_t new_cap = *cap ? *cap : 256;
+        while (raw_len + 1 > new_cap) {
+            new_cap *= 2;
+        }
+
+        /* 缓冲区只保存当前事件的内容，扩容时不需要保留旧数据 */
+        char *new_buffer = (char *)arena_resize(arena, *buffer, 0, new_cap);
+        if (!new_buffer) {
+            fprintf(stderr, "Error: Failed to grow delta buffer\n");
+            return false;
+        }
+        *buffer = new_buffer;
+        *cap = new_cap;
+    }
+
+    char *out = *buffer;
+
+    /* 常见情况：没有转义，直接复制 */
+    if (!has_escape) {
+        memcpy(out, raw, raw_len);
+        out[raw_len] = '\0';
+        *out_len = raw_len;
+        return true;
+    }
+
+    const char *p = raw;
+    const char *end = raw + raw_len;
+    size_t pos = 0;
+
+    while (p < end) {
+        const char *backslash = memchr(p, '\\', (size_t)(end - p));
+        size_t run = backslash ? (size_t)(backslash - p) : (size_t)(end - p);
+
+        memcpy(out + pos, p, run);
+        pos += run;
+        p += run;
+        if (!backslash) break;
+
+        if (end - p < 2) return false;
+        p++;
+
+        switch (*p++) {
+            case '"':  out[pos++] = '"';  break;
+            case '\\': out[pos++] = '\\'; break;
+            case '/':  out[pos++] = '/';  break;
+            case 'b':  out[pos++] = '\b'; break;
+            case 'f':  out[pos++] = '\f'; break;
+            case 'n':  out[pos++] = '\n'; break;
+            case 'r':  out[pos++] = '\r'; break;
+            case 't':  out[pos++] = '\t'; break;
+            case 'u': {
+                unsigned int code;
+                if (!read_hex4(p, end, &code)) return false;
+                p += 4;
+
+                /* UTF-16 代理对 */
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    unsigned int low;
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u' ||
+                        !read_hex4(p + 2, end, &low) || low < 0xDC00 || low > 0xDFFF) {
+                        return false;
+                    }
+                    p += 6;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                    return false;
+                }
+
+                pos += encode_utf8(code, out + pos);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+
+    out[pos] = '\0';
+    *out_len = pos;
+    return true;
+}
+
+/* 读取字符串或 null 字段到缓冲区 */
+static bool read_text_field(Scanner *s, Arena *arena, char **buffer, size_t *cap,
+                            const char **text, size_t *text_len) {
+    if (peek(s, 'n')) {
+        *text = NULL;
+        *text_len = 0;
+        return skip_value(s, 0);
+    }
+
+    const char *raw;
+    size_t raw_len;
+    bool has_escape;
+    if (!scan_string(s, &raw, &raw_len, &has_escape)) return false;
+
+    if (!unescape_into(arena, raw, raw_len, has_escape, buffer, cap, text_len)) return false;
+    *text = *buffer;
+    return true;
+}
+
+/* 解析 choices[0].delta */
+static bool parse_delta(Scanner *s, DeltaExtractor *extractor, DeltaEvent *event) {
+    if (peek(s, 'n')) return skip_value(s, 0);
+    if (!consume(s, '{')) return false;
+    if (consume(s, '}')) return true;
+
+    do {
+        const char *key;
+        size_t key_len;
+        if (!scan_key(s, &key, &key_len)) return false;
+
+        if (KEY_IS(key, key_len, "reasoning_content")) {
+            if (!read_text_field(s, extractor->arena, &extractor->reasoning_buf, &extractor->reasoning_cap,
+                                 &event->reasoning, &event->reasoning_len)) {
+                return false;
+            }
+        } else if (KEY_IS(key, key_len, "content")) {
+            if (!read_text_field(s, extractor->arena, &extractor->content_buf, &extractor->content_cap,
+                                 &event->content, &event->content_len)) {
+                return false;
+            }
+        } else if (!skip_value(s, 1)) {
+            return false;
+        }
+    } while (consume(s, ','));
+
+    return consume(s, '}');
+}
+
+/* 解析 choices[0] */
+static bool parse_choice(Scanner *s, DeltaExtractor *extractor, DeltaEvent *event) {
+    if (!consume(s, '{')) return false;
+    if (consume(s, '}')) return true;
+
+    do {
+        const char *key;
+        size_t key_len;
+        if (!scan_key(s, &key, &key_len)) return false;
+
+        if (KEY_IS(key, key_len, "delta")) {
+            if (!parse_delta(s, extractor, event)) return false;
+        } else if (KEY_IS(key, key_len, "finish_reason")) {
+            if (peek(s, 'n')) {
+                if (!skip_value(s, 0)) return false;
+            } else {
+                const char *reason;
+                size_t reason_len;
+                bool has_escape;
+                if (!scan_string(s, &reason, &reason_len, &has_escape) || has_escape) {
+                    return false;
+                }
+                if (reason_len >= sizeof(event->finish_reason)) {
+                    reason_len = sizeof(event->finish_reason) - 1;
+                }
+                memcpy(event->finish_reason, reason, reason_len);
+                event->finish_reason[reason_len] = '\0';
+            }
+        } else if (!skip_value(s, 1)) {
+            return false;
+        }
+    } while (consume(s, ','));
+
+    return consume(s, '}');
+}
+
+/* 解析 choices 数组（只关心第一个元素） */
+static bool parse_choices(Scanner *s, DeltaExtractor *extractor, DeltaEvent *event) {
+    if (!consume(s, '[')) return false;
+    if (consume(s, ']')) return true;
+
+    if (!parse_choice(s, extractor, event)) return false;
+    while (consume(s, ',')) {
+        if (!skip_value(s, 1)) return false;
+    }
+
+    return consume(s, ']');
+}
+
+/* 解析 usage.prompt_tokens_details（只关心 cached_tokens） */
+static bool parse_prompt_details(Scanner *s, DeltaEvent *event) {
+    if (peek(s, 'n')) return skip_value(s, 0);
+    if (!consume(s, '{')) return false;
+    if (consume(s, '}')) return true;
+
+    do {
+        const char *key;
+        size_t key_len;
+        if (!scan_key(s, &key, &key_len)) return false;
+
+        if (KEY_IS(key, key_len, "cached_tokens")) {
+            if (!read_int(s, &event->cached_tokens)) return false;
+        } else if (!skip_value(s, 2)) {
+            return false;
+        }
+    } while (consume(s, ','));
+
+    return consume(s, '}');
+}
+
+/* 解析 usage 对象 */
+static bool parse_usage_object(Scanner *s, DeltaEvent *event) {
+    if (peek(s, 'n')) return skip_value(s, 0);
+    if (!consume(s, '{')) return false;
+
+    event->has_usage = true;
+    if (consume(s, '}')) return true;
+
+    do {
+        const char *key;
+        size_t key_len;
+        if (!scan_key(s, &key, &key_len)) return false;
+
+        if (KEY_IS(key, key_len, "prompt_tokens")) {
+            if (!read_int(s, &event->prompt_tokens)) return false;
+        } else if (KEY_IS(key, key_len, "completion_tokens")) {
+            if (!read_int(s, &event->completion_tokens)) return false;
+        } else if (KEY_IS(key, key_len, "total_tokens")) {
+            if (!read_int(s, &event->total_tokens)) return false;
+        } else if (KEY_IS(key, key_len, "prompt_tokens_details")) {
+            if (!parse_prompt_details(s, event)) return false;
+        } else if (!skip_value(s, 1)) {
+            return false;
+        }
+    } while (consume(s, ','));
+
+    return consume(s, '}');
+}
+
+void delta_extractor_init(DeltaExtractor *extractor, Arena *arena) {
+    if (!extractor) return;
+    memset(extractor, 0, sizeof(DeltaExtractor));
+    extractor->arena = arena;
+}
+
+void delta_extractor_free(DeltaExtractor *extractor) {
+    if (!extractor) return;
+
+    arena_free(extractor->arena, extractor->content_buf);
+    arena_free(extractor->arena, extractor->reasoning_buf);
+    memset(extractor, 0, sizeof(DeltaExtractor));
+}
+
+bool delta_extract(DeltaExtractor *extractor, const char *json, size_t len,
+                   DeltaEvent *event) {
+    if (!extractor || !json || !event) return false;
+
+    memset(event, 0, sizeof(DeltaEvent));
+
+    Scanner s = { json, json + len };
+    if (!consume(&s, '{')) return false;
+
+    if (!consume(&s, '}')) {
+        do {
+            const char *key;
+            size_t key_len;
+            if (!scan_key(&s, &key, &key_len)) return false;
+
+            if (KEY_IS(key, key_len, "choices")) {
+                if (!parse_choices(&s, extractor, event)) return false;
+            } else if (KEY_IS(key, key_len, "usage")) {
+                if (!parse_usage_object(&s, event)) return false;
+            } else if (!skip_value(&s, 1)) {
+                return false;
+            }
+        } while (consume(&s, ','));
+
+        if (!consume(&s, '}')) return false;
+    }
+
+    /* 只允许尾随空白 */
+    skip_ws(&s);
+    return s.p == s.end;
+}
@@ -0,0 +1,52 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Streaming Delta Extractor Header
+ *===========================================================================*/
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#include "arena.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* 单个流式事件中提取出的字段
+ * reasoning / content 指向提取器内部的可复用缓冲区（以 '\0' 结尾），
+ * 在下一次调用 delta_extract 之前有效；字段不存在或为 null 时长度为 0。
+ */
+typedef struct {
+    const char *reasoning;       /* choices[0].delta.reasoning_content */
+    size_t reasoning_len;
+    const char *content;         /* choices[0].delta.content */
+    size_t content_len;
+    char finish_reason[32];      /* choices[0].finish_reason（未结束时为空串） */
+    bool has_usage;              /* 是否携带 usage（通常在最后一个事件） */
+    int prompt_tokens;
+    int completion_tokens;
+    int total_tokens;
+    int cached_tokens;           /* usage.prompt_tokens_details.cached_tokens */
+} DeltaEvent;
+
+/* 流式增量提取器
+ * 只扫描 chat.completion.chunk 事件中需要的字段并直接反转义到可复用缓冲区，
+ * 不为每个事件构建完整的 cJSON 树。
+ */
+typedef struct {
+    Arena *arena;               /* 缓冲区所在的内存池（NULL 时使用 malloc） */
+    char *reasoning_buf;
+    size_t reasoning_cap;
+    char *content_buf;
+    size_t content_cap;
+} DeltaExtractor;
+
+/* 函数声明 */
+void delta_extractor_init(DeltaExtractor *extractor, Arena *arena);
+void delta_extractor_free(DeltaExtractor *extractor);
+
+/* 从一个事件的 JSON 数据中提取字段
+ * 遇到非预期的结构（或非法 JSON）时返回 false，调用者应回退到 cJSON 解析。
+ */
+bool delta_extract(DeltaExtractor *extractor, const char *json, size_t len,
+                   DeltaEvent *event);
+
+#endif /* DELTA_H */
@@ -0,0 +1,53 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Advisory File Locks
+ *===========================================================================*/
+
+#ifndef FILE_LOCK_H
+#define FILE_LOCK_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <string.h>
+    #include <windows.h>
+#else
+    #include <errno.h>
+    #include <sys/file.h>
+#endif
+
+/* 对整个文件加建议锁（阻塞直到取得）
+ * POSIX 使用 flock：锁属于打开的文件描述，fork 出的进程各自 open 即可互斥，
+ * 关闭描述符时自动释放。Windows 使用 LockFileEx。
+ */
+static inline bool file_lock(int fd, bool exclusive) {
+#ifdef _WIN32
+    HANDLE handle = (HANDLE)_get_osfhandle(fd);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(overlapped));
+    return LockFileEx(handle, exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0,
+                      MAXDWORD, MAXDWORD, &overlapped) != 0;
+#else
+    int rc;
+    do {
+        rc = flock(fd, exclusive ? LOCK_EX : LOCK_SH);
+    } while (rc != 0 && errno == EINTR);
+    return rc == 0;
+#endif
+}
+
+static inline void file_unlock(int fd) {
+#ifdef _WIN32
+    HANDLE handle = (HANDLE)_get_osfhandle(fd);
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(overlapped));
+    if (handle != INVALID_HANDLE_VALUE) UnlockFileEx(handle, 0, MAXDWORD, MAXDWORD, &overlapped);
+#else
+    flock(fd, LOCK_UN);
+#endif
+}
+
+#endif /* FILE_LOCK_H */
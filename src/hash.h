@@ -0,0 +1,41 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Hash Helpers
+ *===========================================================================*/
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* FNV-1a 64 位初始值 */
+#define HASH_FNV_OFFSET 0xcbf29ce484222325ULL
+#define HASH_FNV_PRIME  0x100000001b3ULL
+
+/* FNV-1a：在 seed 基础上继续累加 data，可以链式哈希多个片段 */
+static inline uint64_t hash_fnv1a(uint64_t seed, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t hash = seed;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= HASH_FNV_PRIME;
+    }
+    return hash;
+}
+
+/* 哈希以 '\0' 结尾的字符串（包含结尾的 '\0'，使 "ab"+"c" 与 "a"+"bc" 不同） */
+static inline uint64_t hash_fnv1a_str(uint64_t seed, const char *str) {
+    if (!str) str = "";
+
+    uint64_t hash = seed;
+    const unsigned char *p = (const unsigned char *)str;
+    do {
+        hash ^= *p;
+        hash *= HASH_FNV_PRIME;
+    } while (*p++);
+    return hash;
+}
+
+#endif /* HASH_H */
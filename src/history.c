@@ -3,19 +3,34 @@
  *===========================================================================*/
 
 #include "history.h"
+#include "prefix.h"
+#include "json_writer.h"
+#include "file_lock.h"
+#include "probes.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 
 #ifdef _WIN32
     #include <direct.h>
+    #include <io.h>
     #include <shlobj.h>
+    #include <windows.h>
     #define mkdir_cross(path) _mkdir(path)
+    #define open_cross(path, flags) _open(path, (flags) | _O_BINARY, _S_IREAD | _S_IWRITE)
+    #define close_cross(fd) _close(fd)
+    #define fdopen_cross(fd, mode) _fdopen(fd, mode)
 #else
     #include <unistd.h>
     #include <pwd.h>
+    #include <sys/mman.h>
+    #include <sys/wait.h>
     #define mkdir_cross(path) mkdir(path, 0755)
+    #define open_cross(path, flags) open(path, flags, 0600)
+    #define close_cross(fd) close(fd)
+    #define fdopen_cross(fd, mode) fdopen(fd, mode)
 #endif
 
 // 尝试多种可能的 cJSON 头文件路径
@@ -27,8 +42,6 @@
     #include <cjson/cJSON.h>
 #endif
 
-/* 前向声明 JSON 转义辅助函数 */
-static char* json_escape(const char *str);
 
 ConversationHistory* history_create(const char *config_dir, int max_rounds) {
     ConversationHistory *history = (ConversationHistory *)calloc(1, sizeof(ConversationHistory));
@@ -40,11 +53,18 @@ ConversationHistory* history_create(const char *config_dir, int max_rounds) {
     /* 设置历史文件路径 */
     size_t path_len = strlen(config_dir) + 32;  /* 足够空间 */
     history->history_file = (char *)malloc(path_len);
-    if (!history->history_file) {
+    history->legacy_file = (char *)malloc(path_len);
+    history->lock_file = (char *)malloc(path_len);
+    if (!history->history_file || !history->legacy_file || !history->lock_file) {
+        free(history->history_file);
+        free(history->legacy_file);
+        free(history->lock_file);
         free(history);
         return NULL;
     }
-    snprintf(history->history_file, path_len, "%s/history.json", config_dir);
+    snprintf(history->history_file, path_len, "%s/history.jsonl", config_dir);
+    snprintf(history->legacy_file, path_len, "%s/history.json", config_dir);
+    snprintf(history->lock_file, path_len, "%s/history.lock", config_dir);
 
     /* 设置最大轮数 */
     history->max_rounds = max_rounds;
@@ -54,6 +74,8 @@ ConversationHistory* history_create(const char *config_dir, int max_rounds) {
     history->rounds = (ConversationRound *)calloc(max_rounds, sizeof(ConversationRound));
     if (!history->rounds) {
         free(history->history_file);
+        free(history->legacy_file);
+        free(history->lock_file);
         free(history);
         return NULL;
     }
@@ -64,61 +86,117 @@ ConversationHistory* history_create(const char *config_dir, int max_rounds) {
 void history_destroy(ConversationHistory *history) {
     if (!history) return;
 
-    /* 释放所有轮次数据 */
-    for (int i = 0; i < history->current_count; i++) {
-        if (history->rounds[i].user_input) {
-            free(history->rounds[i].user_input);
-        }
-        if (history->rounds[i].assistant_response) {
-            free(history->rounds[i].assistant_response);
-        }
-    }
-
     if (history->rounds) free(history->rounds);
+    if (history->text) free(history->text);
     if (history->history_file) free(history->history_file);
+    if (history->legacy_file) free(history->legacy_file);
+    if (history->lock_file) free(history->lock_file);
+    prompt_prefix_destroy(history->prefix);
     free(history);
 }
 
-bool history_add_round(ConversationHistory *history,
-                      const char *user_input,
-                      const char *assistant_response) {
-    if (!history || !user_input || !assistant_response) return false;
+bool history_enable_prefix_cache(ConversationHistory *history, const char *config_dir) {
+    if (!history || !config_dir) return false;
+    if (history->prefix) return true;
 
-    /* 如果已满,移除最旧的记录 */
-    if (history->current_count >= history->max_rounds) {
-        /* 释放最旧的记录 */
-        free(history->rounds[0].user_input);
-        free(history->rounds[0].assistant_response);
+    history->prefix = prompt_prefix_create(config_dir);
+    return history->prefix != NULL;
+}
 
-        /* 移动所有记录向前 */
-        for (int i = 0; i < history->current_count - 1; i++) {
-            history->rounds[i] = history->rounds[i + 1];
+/* 确保文本区末尾还能放下 needed 字节
+ * 仍在窗口中的文本总是连续位于文本区末尾：先把它们移到开头，
+ * 移动后仍不够一半空闲时再扩容，摊还下来每个字节只移动常数次。
+ */
+static bool reserve_text(ConversationHistory *history, size_t needed) {
+    if (history->text_len + needed <= history->text_cap) return true;
+
+    size_t live_start = history->current_count > 0 ?
+                        history_round(history, 0)->user_offset : history->text_len;
+    size_t live = history->text_len - live_start;
+
+    if ((live + needed) * 2 > history->text_cap) {
+        size_t new_cap = history->text_cap ? history->text_cap * 2 : 4096;
+        while (new_cap < (live + needed) * 2) new_cap *= 2;
+
+        char *new_text = (char *)malloc(new_cap);
+        if (!new_text) {
+            fprintf(stderr, "Error: Failed to grow history text buffer\n");
+            return false;
         }
+        if (live > 0) memcpy(new_text, history->text + live_start, live);
+        free(history->text);
+        history->text = new_text;
+        history->text_cap = new_cap;
+    } else if (live > 0 && live_start > 0) {
+        memmove(history->text, history->text + live_start, live);
+    }
 
-        history->current_count--;
+    for (int i = 0; i < history->current_count; i++) {
+        ConversationRound *round = (ConversationRound *)history_round(history, i);
+        round->user_offset -= live_start;
+        round->assistant_offset -= live_start;
     }
+    history->text_len = live;
+    return true;
+}
 
-    /* 添加新记录 */
-    int index = history->current_count;
-    history->rounds[index].user_input = strdup(user_input);
-    history->rounds[index].assistant_response = strdup(assistant_response);
+/* 添加一轮（长度已知） */
+static bool add_round(ConversationHistory *history, const char *user_input, size_t user_len,
+                      const char *assistant_response, size_t assistant_len) {
+    if (history->max_rounds <= 0) return false;
 
-    if (!history->rounds[index].user_input || !history->rounds[index].assistant_response) {
-        /* 内存分配失败 */
-        if (history->rounds[index].user_input) free(history->rounds[index].user_input);
-        if (history->rounds[index].assistant_response) free(history->rounds[index].assistant_response);
-        return false;
+    /* 如果已满,一次移除最旧的一半记录
+     * 逐轮移除会让每次请求的消息前缀都发生变化，提供方的前缀缓存永远无法命中；
+     * 批量移除后，在下一次截断之前前缀只会在末尾追加。
+     * 环形缓冲区只需移动起点，文本在下次整理文本区时回收。
+     */
+    if (history->current_count >= history->max_rounds) {
+        int drop = history->max_rounds / 2;
+        if (drop < 1) drop = 1;
+        if (drop > history->current_count) drop = history->current_count;
+
+        history->head = (history->head + drop) % history->max_rounds;
+        history->current_count -= drop;
+
+        /* 已序列化的前缀不再是历史的开头部分 */
+        prompt_prefix_reset(history->prefix, false);
     }
 
+    /* 文本依次写入文本区 */
+    if (!reserve_text(history, user_len + assistant_len + 2)) return false;
+
+    int index = (history->head + history->current_count) % history->max_rounds;
+    ConversationRound *round = &history->rounds[index];
+    char *text = history->text + history->text_len;
+
+    round->user_offset = history->text_len;
+    round->user_len = user_len;
+    memcpy(text, user_input, user_len);
+    text[user_len] = '\0';
+
+    round->assistant_offset = history->text_len + user_len + 1;
+    round->assistant_len = assistant_len;
+    memcpy(text + user_len + 1, assistant_response, assistant_len);
+    text[user_len + 1 + assistant_len] = '\0';
+
+    history->text_len += user_len + assistant_len + 2;
     history->current_count++;
+    history->next_seq++;
     return true;
 }
 
-bool history_save(const ConversationHistory *history) {
-    if (!history || !history->history_file) return false;
+bool history_add_round(ConversationHistory *history,
+                      const char *user_input,
+                      const char *assistant_response) {
+    if (!history || !user_input || !assistant_response) return false;
+
+    return add_round(history, user_input, strlen(user_input),
+                     assistant_response, strlen(assistant_response));
+}
 
-    /* 确保目录存在 */
-    char *dir_copy = strdup(history->history_file);
+/* 确保历史文件所在目录存在 */
+static void ensure_parent_dir(const char *path) {
+    char *dir_copy = strdup(path);
     if (dir_copy) {
         char *last_slash = strrchr(dir_copy, '/');
         if (last_slash) {
@@ -127,52 +205,441 @@ bool history_save(const ConversationHistory *history) {
         }
         free(dir_copy);
     }
+}
 
-    FILE *fp = fopen(history->history_file, "w");
-    if (!fp) return false;
+/* 序列化一条日志记录（以 '\n' 结尾，不含 '\0'） */
+static char* format_record(Arena *arena, long long seq, const ConversationHistory *history,
+                           int i, size_t *len) {
+    const ConversationRound *round = history_round(history, i);
+
+    JsonWriter writer;
+    json_writer_init(&writer, arena, round->user_len + round->assistant_len + 64);
+    json_writer_begin_object(&writer);
+    json_writer_key(&writer, "seq");
+    json_writer_int(&writer, seq);
+    json_writer_key(&writer, "user");
+    json_writer_string_n(&writer, history->text + round->user_offset, round->user_len);
+    json_writer_key(&writer, "assistant");
+    json_writer_string_n(&writer, history->text + round->assistant_offset, round->assistant_len);
+    json_writer_end_object(&writer);
+
+    size_t json_len;
+    char *line = json_writer_finish(&writer, &json_len);
+    if (!line) return NULL;
+
+    /* 用换行替换结尾的 '\0' */
+    line[json_len] = '\n';
+    *len = json_len + 1;
+    return line;
+}
 
-    /* 写入 JSON 格式 */
-    fprintf(fp, "[\n");
-    for (int i = 0; i < history->current_count; i++) {
-        fprintf(fp, "  {\n");
-        fprintf(fp, "    \"user\": %s,\n", json_escape(history->rounds[i].user_input));
-        fprintf(fp, "    \"assistant\": %s\n", json_escape(history->rounds[i].assistant_response));
-        fprintf(fp, "  }%s\n", i < history->current_count - 1 ? "," : "");
+static bool write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+#ifdef _WIN32
+        int n = _write(fd, data, (unsigned int)len);
+#else
+        ssize_t n = write(fd, data, len);
+#endif
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t)n;
     }
-    fprintf(fp, "]\n");
+    return true;
+}
 
-    fclose(fp);
+static bool read_at(int fd, char *buf, size_t len, size_t offset) {
+#ifdef _WIN32
+    if (_lseeki64(fd, (__int64)offset, SEEK_SET) < 0) return false;
+#else
+    if (lseek(fd, (off_t)offset, SEEK_SET) < 0) return false;
+#endif
+    while (len > 0) {
+#ifdef _WIN32
+        int n = _read(fd, buf, (unsigned int)len);
+#else
+        ssize_t n = read(fd, buf, len);
+#endif
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+    }
     return true;
 }
 
-bool history_load(ConversationHistory *history) {
-    if (!history || !history->history_file) return false;
+/* 用临时文件原子替换目标文件 */
+static bool replace_file(const char *tmp_path, const char *path) {
+#ifdef _WIN32
+    return MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(tmp_path, path) == 0;
+#endif
+}
 
-    FILE *fp = fopen(history->history_file, "r");
+/* 记录日志当前的大小、inode 和修改时间 */
+static void remember_file(ConversationHistory *history, const struct stat *st) {
+    history->file_size = st ? (size_t)st->st_size : 0;
+    history->file_id = st ? (long long)st->st_ino : 0;
+    history->file_mtime = st ? (long long)st->st_mtime : 0;
+}
+
+/* 迁移后保留的旧版历史文件路径（调用者负责释放） */
+static char* legacy_backup_path(const ConversationHistory *history) {
+    size_t len = strlen(history->legacy_file) + sizeof(".bak");
+    char *path = (char *)malloc(len);
+    if (path) snprintf(path, len, "%s.bak", history->legacy_file);
+    return path;
+}
+
+/* 加日志锁（阻塞直到取得），返回锁文件的描述符
+ * 锁加在独立的 history.lock 上：压缩和迁移用 rename 替换日志时锁不受影响。
+ * 无法创建锁文件时（例如只读目录）返回 -1，调用者不加锁继续。
+ */
+static int lock_history(const ConversationHistory *history, bool exclusive) {
+    int fd = open_cross(history->lock_file, O_RDWR | O_CREAT);
+    if (fd < 0) return -1;
+    if (!file_lock(fd, exclusive)) {
+        close_cross(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* 关闭描述符即释放锁 */
+static void unlock_history(int lock_fd) {
+    if (lock_fd >= 0) close_cross(lock_fd);
+}
+
+/* 最后一行完整记录的序号（行首为 {"seq":N），不是这种格式时返回 -1 */
+static long long record_seq(const char *line, size_t len) {
+    static const char key[] = "{\"seq\":";
+    if (len <= sizeof(key) - 1 || memcmp(line, key, sizeof(key) - 1) != 0) return -1;
+
+    long long seq = 0;
+    bool digits = false;
+    for (size_t i = sizeof(key) - 1; i < len && line[i] >= '0' && line[i] <= '9'; i++) {
+        seq = seq * 10 + (line[i] - '0');
+        digits = true;
+    }
+    return digits ? seq : -1;
+}
+
+/* 持有锁时读取日志末尾：返回最后一条完整记录的序号（没有时为 -1），
+ * 以及文件是否以换行结尾。只读取末尾几 KB，最后一行更长时逐步扩大。
+ */
+static long long tail_seq(int fd, size_t size, bool *ends_with_newline) {
+    size_t want = 4096;
+
+    for (;;) {
+        size_t n = want < size ? want : size;
+        char *buf = (char *)malloc(n);
+        if (!buf || !read_at(fd, buf, n, size - n)) {
+            free(buf);
+            return -1;
+        }
+        *ends_with_newline = buf[n - 1] == '\n';
+
+        long long seq = -1;
+        bool need_more = false;
+        const char *pos = buf + n;
+        while (pos > buf) {
+            const char *line_end = pos;
+            while (line_end > buf && (line_end[-1] == '\n' || line_end[-1] == '\r')) line_end--;
+            const char *line = line_end;
+            while (line > buf && line[-1] != '\n') line--;
+
+            /* 行首可能在读取范围之前 */
+            if (line == buf && n < size) {
+                need_more = true;
+                break;
+            }
+            /* 跳过写入中断留下的半行 */
+            if (line_end > line && line_end[-1] == '}') {
+                seq = record_seq(line, (size_t)(line_end - line));
+                break;
+            }
+            pos = line;
+        }
+
+        free(buf);
+        if (!need_more) return seq;
+        want *= 2;
+    }
+}
+
+bool history_append(ConversationHistory *history, Arena *arena) {
+    if (!history || !history->history_file || history->current_count == 0) return false;
+
+    ensure_parent_dir(history->history_file);
+
+    /* 多个进程可能同时追加：持有排他锁期间确定序号并一次写入整行 */
+    int lock_fd = lock_history(history, true);
+    int fd = open_cross(history->history_file, O_RDWR | O_CREAT | O_APPEND);
+    if (fd < 0) {
+        unlock_history(lock_fd);
+        return false;
+    }
+
+    struct stat st;
+    size_t size = fstat(fd, &st) == 0 ? (size_t)st.st_size : 0;
+
+    /* 日志与上次读写后的状态不同：其他进程写过，内存中缺少那些轮次 */
+    if (size != history->file_size || (size > 0 && (long long)st.st_ino != history->file_id)) {
+        history->stale = true;
+    }
+
+    /* 序号接在文件中最后一条记录之后（其他进程可能已经追加过），
+     * 使从日志末尾计算出的窗口与记录总数一致
+     */
+    long long seq = size == 0 ? 0 : history->next_seq - 1;
+    bool ends_with_newline = true;
+    if (size > 0) {
+        long long last_seq = tail_seq(fd, size, &ends_with_newline);
+        if (last_seq >= 0) seq = last_seq + 1;
+    }
+
+    size_t len;
+    char *line = format_record(arena, seq, history, history->current_count - 1, &len);
+    bool ok = line != NULL;
+
+    /* 上次写入中断留下的半行：先补上换行，新记录从新的一行开始 */
+    if (ok && !ends_with_newline) ok = write_all(fd, "\n", 1);
+    if (ok) ok = write_all(fd, line, len);
+    if (ok && fstat(fd, &st) == 0) {
+        remember_file(history, &st);
+    }
+    close_cross(fd);
+    unlock_history(lock_fd);
+    arena_free(arena, line);
+
+    if (!ok) return false;
+    history->next_seq = seq + 1;
+    TRACE_PROBE2(history_saved, history->current_count, 1);
+
+    /* 持久化请求前缀（只追加新增部分） */
+    if (history->prefix) prompt_prefix_save(history->prefix);
+
+    /* 日志远大于当前窗口时压缩 */
+    if (history->file_size >= HISTORY_COMPACT_BYTES) {
+        size_t live = 0;
+        for (int i = 0; i < history->current_count; i++) {
+            const ConversationRound *round = history_round(history, i);
+            live += round->user_len + round->assistant_len + 48;
+        }
+        if (history->file_size > live * 2) {
+            history_compact(history);
+        }
+    }
+
+    return true;
+}
+
+/* 写入当前窗口到临时文件后替换日志（调用者持有排他锁） */
+static bool write_snapshot(const ConversationHistory *history, Arena *arena) {
+    size_t path_len = strlen(history->history_file) + 32;
+    char *tmp_path = (char *)malloc(path_len);
+    if (!tmp_path) return false;
+#ifdef _WIN32
+    snprintf(tmp_path, path_len, "%s.tmp", history->history_file);
+#else
+    snprintf(tmp_path, path_len, "%s.tmp.%ld", history->history_file, (long)getpid());
+#endif
+
+    /* 与 history_append 创建的日志一样只允许当前用户读写 */
+    int fd = open_cross(tmp_path, O_WRONLY | O_CREAT | O_TRUNC);
+    FILE *fp = fd >= 0 ? fdopen_cross(fd, "wb") : NULL;
     if (!fp) {
-        /* 文件不存在是正常情况，首次运行时没有历史文件 */
+        if (fd >= 0) close_cross(fd);
+        free(tmp_path);
+        return false;
+    }
+
+    /* 转义结果放在调用者的 arena 中（未提供时使用临时 arena），写完后统一释放 */
+    Arena *scratch = arena ? arena : arena_create(0);
+    bool ok = scratch != NULL;
+
+    long long first_seq = history->next_seq - history->current_count;
+    for (int i = 0; ok && i < history->current_count; i++) {
+        size_t len;
+        char *line = format_record(scratch, first_seq + i, history, i, &len);
+        ok = line && fwrite(line, 1, len, fp) == len;
+        arena_free(scratch, line);
+    }
+
+    if (scratch && scratch != arena) arena_destroy(scratch);
+
+    if (fclose(fp) != 0) ok = false;
+
+    if (ok) ok = replace_file(tmp_path, history->history_file);
+    if (!ok) remove(tmp_path);
+
+    free(tmp_path);
+    return ok;
+}
+
+bool history_save(const ConversationHistory *history, Arena *arena) {
+    if (!history || !history->history_file) return false;
+
+    ensure_parent_dir(history->history_file);
+
+    int lock_fd = lock_history(history, true);
+    bool ok = write_snapshot(history, arena);
+    unlock_history(lock_fd);
+    if (ok) {
+        TRACE_PROBE2(history_saved, history->current_count, 0);
+    }
+    return ok;
+}
+
+/* 解析一行记录并添加到历史，返回记录的序号（没有 seq 字段时为 -1）
+ * 无法解析的行（例如写入中断留下的半行）返回 -2
+ */
+static long long parse_record(ConversationHistory *history, const char *line, size_t len) {
+    cJSON *record = cJSON_ParseWithLength(line, len);
+    if (!record) return -2;
+
+    long long seq = -2;
+    cJSON *user_json = cJSON_GetObjectItem(record, "user");
+    cJSON *assistant_json = cJSON_GetObjectItem(record, "assistant");
+    cJSON *seq_json = cJSON_GetObjectItem(record, "seq");
+
+    if (cJSON_IsString(user_json) && cJSON_IsString(assistant_json) &&
+        history_add_round(history, user_json->valuestring, assistant_json->valuestring)) {
+        seq = cJSON_IsNumber(seq_json) ? (long long)seq_json->valuedouble : -1;
+    }
+
+    cJSON_Delete(record);
+    return seq;
+}
+
+/* 按顺序重放所有记录（记录没有序号时使用） */
+static void replay_log(ConversationHistory *history, const char *data, size_t size) {
+    long long last_seq = -1;
+    const char *line = data;
+    const char *end = data + size;
+
+    while (line < end) {
+        const char *newline = (const char *)memchr(line, '\n', (size_t)(end - line));
+        const char *line_end = newline ? newline : end;
+
+        if (line_end > line) {
+            long long seq = parse_record(history, line, (size_t)(line_end - line));
+            if (seq >= 0) last_seq = seq;
+        }
+
+        if (!newline) break;
+        line = newline + 1;
+    }
+
+    if (last_seq >= 0) history->next_seq = last_seq + 1;
+}
+
+/* 一共记录过 total 轮时窗口中的轮数
+ * 与 add_round 的截断规则一致：达到上限后一次移除一半
+ */
+static int window_rounds(long long total, int max_rounds) {
+    if (total <= max_rounds) return (int)total;
+
+    int drop = max_rounds / 2;
+    if (drop < 1) drop = 1;
+    return max_rounds - drop + 1 + (int)((total - max_rounds - 1) % drop);
+}
+
+/* 从日志末尾向前找到窗口内的记录，只解析这些行
+ * 窗口大小由最后一条记录的序号决定，与从头重放全部记录得到的窗口相同；
+ * 更早的记录不会被读取，启动时间不随日志增长。
+ */
+static bool load_tail(ConversationHistory *history, const char *data, size_t size) {
+    /* 行的起止位置，从后往前收集 */
+    int capacity = history->max_rounds > 0 ? history->max_rounds : 1;
+    const char **starts = (const char **)malloc((size_t)capacity * 2 * sizeof(const char *));
+    if (!starts) return false;
+    const char **ends = starts + capacity;
+
+    long long last_seq = -1;
+    int wanted = capacity;
+    int found = 0;
+    const char *pos = data + size;
+
+    while (pos > data && found < wanted) {
+        /* 定位上一行 [line, line_end) */
+        const char *line_end = pos;
+        while (line_end > data && (line_end[-1] == '\n' || line_end[-1] == '\r')) line_end--;
+        const char *line = line_end;
+        while (line > data && line[-1] != '\n') line--;
+        pos = line;
+
+        if (line_end == line) continue;
+
+        /* 写入中断留下的半行没有结尾的 '}' */
+        if (line_end[-1] != '}') continue;
+
+        if (found == 0) {
+            last_seq = record_seq(line, (size_t)(line_end - line));
+            if (last_seq < 0) break;
+            wanted = window_rounds(last_seq + 1, history->max_rounds);
+        }
+
+        starts[found] = line;
+        ends[found] = line_end;
+        found++;
+    }
+
+    if (last_seq < 0) {
+        /* 没有序号（例如手工编辑过）：退回到完整重放 */
+        free(starts);
+        replay_log(history, data, size);
         return true;
     }
 
+    for (int i = found - 1; i >= 0; i--) {
+        parse_record(history, starts[i], (size_t)(ends[i] - starts[i]));
+    }
+    history->next_seq = last_seq + 1;
+
+    free(starts);
+    return true;
+}
+
+/* 读取日志的前 size 字节：POSIX 下使用 mmap，只有窗口内的页面会被实际读入 */
+static bool load_log(ConversationHistory *history, int fd, size_t size) {
+    if (size == 0) return true;  /* 空文件 */
+    history->file_size = size;
+
+#ifdef _WIN32
+    char *content = (char *)malloc(size);
+    if (!content) return false;
+
+    bool ok = read_at(fd, content, size, 0) && load_tail(history, content, size);
+    free(content);
+    return ok;
+#else
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) return false;
+
+    bool ok = load_tail(history, (const char *)map, size);
+    munmap(map, size);
+    return ok;
+#endif
+}
+
+/* 读取旧版 history.json（JSON 数组） */
+static bool load_legacy(ConversationHistory *history, FILE *fp) {
     /* 读取整个文件内容 */
     fseek(fp, 0, SEEK_END);
     long file_size = ftell(fp);
     fseek(fp, 0, SEEK_SET);
 
     if (file_size <= 0) {
-        fclose(fp);
         return true;  /* 空文件 */
     }
 
     char *json_content = (char *)malloc(file_size + 1);
     if (!json_content) {
-        fclose(fp);
         return false;
     }
 
     size_t read_size = fread(json_content, 1, file_size, fp);
     json_content[read_size] = '\0';
-    fclose(fp);
 
     /* 解析 JSON */
     cJSON *json = cJSON_Parse(json_content);
@@ -192,33 +659,13 @@ bool history_load(ConversationHistory *history) {
     /* 遍历数组，加载每一轮对话 */
     cJSON *item = NULL;
     cJSON_ArrayForEach(item, json) {
-        if (history->current_count >= history->max_rounds) {
-            break;  /* 已达到最大轮数 */
-        }
-
         /* 提取 user 和 assistant 字段 */
         cJSON *user_json = cJSON_GetObjectItem(item, "user");
         cJSON *assistant_json = cJSON_GetObjectItem(item, "assistant");
 
         if (user_json && cJSON_IsString(user_json) &&
             assistant_json && cJSON_IsString(assistant_json)) {
-
-            /* 添加到历史 */
-            int index = history->current_count;
-            history->rounds[index].user_input = strdup(user_json->valuestring);
-            history->rounds[index].assistant_response = strdup(assistant_json->valuestring);
-
-            if (history->rounds[index].user_input && history->rounds[index].assistant_response) {
-                history->current_count++;
-            } else {
-                /* 内存分配失败，清理 */
-                if (history->rounds[index].user_input) {
-                    free(history->rounds[index].user_input);
-                }
-                if (history->rounds[index].assistant_response) {
-                    free(history->rounds[index].assistant_response);
-                }
-            }
+            history_add_round(history, user_json->valuestring, assistant_json->valuestring);
         }
     }
 
@@ -226,61 +673,190 @@ bool history_load(ConversationHistory *history) {
     return true;
 }
 
-bool history_clear(ConversationHistory *history) {
+bool history_load(ConversationHistory *history) {
+    if (!history || !history->history_file) return false;
+
+    int fd = open_cross(history->history_file, O_RDONLY);
+    if (fd >= 0) {
+        /* 共享锁只在取得文件大小时持有：追加在排他锁下一次写入整行，
+         * 此时的大小总是落在记录边界上；之前的内容不会再被修改
+         * （压缩用 rename 换成新文件，已打开的描述符仍指向旧文件），
+         * 解锁后读取这一快照不会阻塞其他进程的追加。
+         */
+        int lock_fd = lock_history(history, false);
+        struct stat st;
+        bool has_stat = fstat(fd, &st) == 0;
+        size_t size = has_stat ? (size_t)st.st_size : 0;
+        unlock_history(lock_fd);
+        remember_file(history, has_stat ? &st : NULL);
+
+        bool ok = load_log(history, fd, size);
+        close_cross(fd);
+        return ok;
+    }
+
+    /* 没有日志时迁移旧版 history.json */
+    FILE *fp = history->legacy_file ? fopen(history->legacy_file, "rb") : NULL;
+    if (!fp) {
+        /* 文件不存在是正常情况，首次运行时没有历史文件 */
+        return true;
+    }
+
+    bool ok = load_legacy(history, fp);
+    fclose(fp);
+
+    /* 新日志只保存窗口内最近的轮次：旧文件改名为 history.json.bak 保留更早的轮次 */
+    if (ok && history->current_count > 0 && history_save(history, NULL)) {
+        char *backup = legacy_backup_path(history);
+        if (backup) replace_file(history->legacy_file, backup);
+        free(backup);
+
+        struct stat st;
+        remember_file(history, stat(history->history_file, &st) == 0 ? &st : NULL);
+    }
+    return ok;
+}
+
+bool history_changed(const ConversationHistory *history) {
+    if (!history || !history->history_file) return false;
+    if (history->stale) return true;
+
+    struct stat st;
+    if (stat(history->history_file, &st) != 0) {
+        /* 日志被删除（--clear-history） */
+        return history->file_size > 0 || history->current_count > 0;
+    }
+    return (size_t)st.st_size != history->file_size ||
+           (long long)st.st_ino != history->file_id ||
+           (long long)st.st_mtime != history->file_mtime;
+}
+
+bool history_reload(ConversationHistory *history) {
     if (!history) return false;
 
-    /* 释放所有记录 */
-    for (int i = 0; i < history->current_count; i++) {
-        if (history->rounds[i].user_input) {
-            free(history->rounds[i].user_input);
-            history->rounds[i].user_input = NULL;
-        }
-        if (history->rounds[i].assistant_response) {
-            free(history->rounds[i].assistant_response);
-            history->rounds[i].assistant_response = NULL;
+    history->head = 0;
+    history->current_count = 0;
+    history->text_len = 0;
+    history->next_seq = 0;
+    history->stale = false;
+    remember_file(history, NULL);
+    prompt_prefix_reset(history->prefix, false);
+
+    return history_load(history);
+}
+
+/* 后台压缩：持有排他锁重新读取日志（包括其他进程追加的记录）并只保留当前窗口
+ * 只读取末尾窗口并写出一个窗口大小的文件，其他进程的追加等待的时间很短。
+ */
+static void compact_log(const ConversationHistory *history) {
+    int lock_fd = lock_history(history, true);
+    int fd = open_cross(history->history_file, O_RDONLY);
+
+    /* 等锁期间其他进程可能已经压缩过 */
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < HISTORY_COMPACT_BYTES) {
+        if (fd >= 0) close_cross(fd);
+        unlock_history(lock_fd);
+        return;
+    }
+
+    ConversationHistory snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.history_file = history->history_file;
+    snapshot.max_rounds = history->max_rounds;
+    snapshot.rounds = (ConversationRound *)calloc(history->max_rounds, sizeof(ConversationRound));
+    bool ok = snapshot.rounds && load_log(&snapshot, fd, (size_t)st.st_size);
+
+    /* 替换前关闭日志（Windows 不能替换仍被打开的文件） */
+    close_cross(fd);
+    if (ok) write_snapshot(&snapshot, NULL);
+    unlock_history(lock_fd);
+
+    free(snapshot.rounds);
+    free(snapshot.text);
+}
+
+void history_compact(const ConversationHistory *history) {
+    if (!history || !history->history_file) return;
+
+#ifdef _WIN32
+    compact_log(history);
+#else
+    /* 两次 fork：中间进程立即退出，压缩进程由 init 接管，不会留下僵尸进程 */
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        compact_log(history);
+        return;
+    }
+    if (pid == 0) {
+        if (fork() == 0) {
+            compact_log(history);
         }
+        _exit(0);
     }
+    waitpid(pid, NULL, 0);
+#endif
+}
+
+bool history_clear(ConversationHistory *history) {
+    if (!history) return false;
 
+    /* 清空所有记录（文本区保留，供之后复用） */
+    history->head = 0;
     history->current_count = 0;
+    history->text_len = 0;
+    history->stale = false;
+    remember_file(history, NULL);
+    prompt_prefix_reset(history->prefix, true);
 
-    /* 删除历史文件 */
+    /* 删除历史文件（持有排他锁，不会删掉其他进程正在追加的记录） */
     if (history->history_file) {
+        int lock_fd = lock_history(history, true);
         remove(history->history_file);
+        unlock_history(lock_fd);
+    }
+    if (history->legacy_file) {
+        remove(history->legacy_file);
+        char *backup = legacy_backup_path(history);
+        if (backup) remove(backup);
+        free(backup);
     }
 
     return true;
 }
 
-char* history_to_json(const ConversationHistory *history) {
+char* history_to_json(const ConversationHistory *history, Arena *arena) {
     /* 将历史转换为 JSON 数组格式,用于 API 请求 */
     if (!history || history->current_count == 0) {
-        return strdup("[]");
+        return arena_strdup(arena, "[]");
     }
 
-    /* 估算所需空间 */
-    size_t total_len = 2;  /* [ 和 ] */
-    for (int i = 0; i < history->current_count; i++) {
-        total_len += strlen(history->rounds[i].user_input);
-        total_len += strlen(history->rounds[i].assistant_response);
-        total_len += 100;  /* JSON 结构开销 */
-    }
-
-    char *json = (char *)malloc(total_len);
-    if (!json) return NULL;
-
-    char *ptr = json;
-    ptr += sprintf(ptr, "[");
+    JsonWriter writer;
+    json_writer_init(&writer, arena, history->text_len + (size_t)history->current_count * 64);
+    json_writer_begin_array(&writer);
 
     for (int i = 0; i < history->current_count; i++) {
-        if (i > 0) ptr += sprintf(ptr, ",");
-        ptr += sprintf(ptr, "{\"role\":\"user\",\"content\":%s}",
-                       json_escape(history->rounds[i].user_input));
-        ptr += sprintf(ptr, ",{\"role\":\"assistant\",\"content\":%s}",
-                       json_escape(history->rounds[i].assistant_response));
+        const ConversationRound *round = history_round(history, i);
+
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "role");
+        json_writer_string(&writer, "user");
+        json_writer_key(&writer, "content");
+        json_writer_string_n(&writer, history->text + round->user_offset, round->user_len);
+        json_writer_end_object(&writer);
+
+        json_writer_begin_object(&writer);
+        json_writer_key(&writer, "role");
+        json_writer_string(&writer, "assistant");
+        json_writer_key(&writer, "content");
+        json_writer_string_n(&writer, history->text + round->assistant_offset,
+                             round->assistant_len);
+        json_writer_end_object(&writer);
     }
 
-    sprintf(ptr, "]");
-    return json;
+    json_writer_end_array(&writer);
+    return json_writer_finish(&writer, NULL);
 }
 
 void history_print(const ConversationHistory *history) {
@@ -291,38 +867,9 @@ void history_print(const ConversationHistory *history) {
 
     for (int i = 0; i < history->current_count; i++) {
         printf("\n[Round %d]\n", i + 1);
-        printf("User:      %s\n", history->rounds[i].user_input);
-        printf("Assistant: %s\n", history->rounds[i].assistant_response);
+        printf("User:      %s\n", history_user(history, i));
+        printf("Assistant: %s\n", history_assistant(history, i));
     }
 
     printf("\n─────────────────────────────────────────\n");
 }
-
-/* JSON 字符串转义辅助函数实现 */
-static char* json_escape(const char *str) {
-    if (!str) return strdup("");
-
-    /* 计算转义后的最大长度 */
-    size_t len = strlen(str);
-    char *escaped = (char *)malloc(len * 2 + 3);  /* 每个字符可能转义,加上引号 */
-    if (!escaped) return strdup("\"\"");
-
-    char *ptr = escaped;
-    *ptr++ = '"';
-
-    for (size_t i = 0; i < len; i++) {
-        switch (str[i]) {
-            case '"':  *ptr++ = '\\'; *ptr++ = '"'; break;
-            case '\\': *ptr++ = '\\'; *ptr++ = '\\'; break;
-            case '\n': *ptr++ = '\\'; *ptr++ = 'n'; break;
-            case '\r': *ptr++ = '\\'; *ptr++ = 'r'; break;
-            case '\t': *ptr++ = '\\'; *ptr++ = 't'; break;
-            default:   *ptr++ = str[i]; break;
-        }
-    }
-
-    *ptr++ = '"';
-    *ptr = '\0';
-
-    return escaped;
-}
@@ -5,29 +5,92 @@
 #ifndef HISTORY_H
 #define HISTORY_H
 
+#include "arena.h"
 #include <stdbool.h>
+#include <stddef.h>
 
-/* 对话记录结构体 */
+/* 对话记录结构体：字符串存放在历史的文本区中，这里只记录位置和长度 */
 typedef struct {
-    char *user_input;      /* 用户输入 */
-    char *assistant_response;  /* AI响应 */
+    size_t user_offset;        /* 用户输入在文本区中的偏移 */
+    size_t user_len;
+    size_t assistant_offset;   /* AI响应在文本区中的偏移 */
+    size_t assistant_len;
 } ConversationRound;
 
-/* 对话历史结构体 */
+/* 日志超过该大小（且超过当前窗口的两倍）时在后台压缩 */
+#define HISTORY_COMPACT_BYTES (1024 * 1024)
+
+struct PromptPrefix;
+
+/* 对话历史结构体
+ * 历史文件为只追加的 JSON Lines 日志（history.jsonl），每轮一行：
+ *     {"seq":N,"user":"...","assistant":"..."}
+ * 每次查询只追加一行；日志变大后由后台进程压缩为当前窗口。
+ * 多个进程可以同时使用同一份历史：追加、压缩和迁移持有 history.lock 的排他锁，
+ * 读取只在取得文件大小时短暂持有共享锁。
+ *
+ * 内存中的轮次保存在定长环形缓冲区中，所有字符串（以 '\0' 结尾）按添加顺序
+ * 连续存放在同一个文本区里：添加一轮是 O(1)，序列化时顺序遍历即可。
+ * 文本区在空间不足时整体前移或扩容，之前取得的字符串指针随之失效。
+ */
 typedef struct {
-    char *history_file;    /* 历史文件路径 */
-    ConversationRound *rounds;  /* 对话轮次数组 */
+    char *history_file;    /* 历史文件路径（history.jsonl） */
+    char *legacy_file;     /* 旧版 history.json，加载时迁移 */
+    char *lock_file;       /* 建议锁文件（history.lock） */
+    ConversationRound *rounds;  /* 环形缓冲区（容量 max_rounds） */
+    int head;              /* 最旧一轮在 rounds 中的位置 */
     int max_rounds;        /* 最大保存轮数 */
     int current_count;     /* 当前轮数 */
+    char *text;            /* 文本区 */
+    size_t text_len;       /* 文本区已用长度 */
+    size_t text_cap;
+    long long next_seq;    /* 下一轮的序号（累计记录过的轮数） */
+    size_t file_size;      /* 最近一次读写后的日志大小 */
+    long long file_id;     /* 最近一次读写后日志的 inode 和修改时间（判断是否被其他进程修改） */
+    long long file_mtime;
+    bool stale;            /* 追加时发现其他进程在此之前写过日志 */
+    struct PromptPrefix *prefix;  /* 请求前缀缓存（见 prefix.h），未启用时为 NULL */
 } ConversationHistory;
 
+/* 第 i 轮（0 为最旧的一轮） */
+static inline const ConversationRound* history_round(const ConversationHistory *history, int i) {
+    int index = history->head + i;
+    if (index >= history->max_rounds) index -= history->max_rounds;
+    return &history->rounds[index];
+}
+
+static inline const char* history_user(const ConversationHistory *history, int i) {
+    return history->text + history_round(history, i)->user_offset;
+}
+
+static inline const char* history_assistant(const ConversationHistory *history, int i) {
+    return history->text + history_round(history, i)->assistant_offset;
+}
+
 /* 函数声明 */
 ConversationHistory* history_create(const char *config_dir, int max_rounds);
 void history_destroy(ConversationHistory *history);
 
+/* 启用请求前缀缓存（<config_dir>/prefix.cache），随历史一起保存和清除 */
+bool history_enable_prefix_cache(ConversationHistory *history, const char *config_dir);
+
 /* 历史管理 */
 bool history_load(ConversationHistory *history);
-bool history_save(const ConversationHistory *history);
+
+/* 日志在最近一次加载或追加之后被其他进程修改过（追加、压缩或清除） */
+bool history_changed(const ConversationHistory *history);
+
+/* 丢弃内存中的轮次，重新加载日志 */
+bool history_reload(ConversationHistory *history);
+/* 把最新一轮追加到日志（一次 write），必要时启动后台压缩
+ * 序列化时的临时字符串从 arena 分配；传入 NULL 时使用 malloc
+ */
+bool history_append(ConversationHistory *history, Arena *arena);
+/* 把当前窗口整体写入临时文件再 rename 替换日志 */
+bool history_save(const ConversationHistory *history, Arena *arena);
+/* 压缩日志：POSIX 下在后台子进程中进行，不阻塞当前查询 */
+void history_compact(const ConversationHistory *history);
+/* 已满时一次移除最旧的一半轮次，使请求前缀在两次截断之间只追加、不移动 */
 bool history_add_round(ConversationHistory *history,
                       const char *user_input,
                       const char *assistant_response);
@@ -36,7 +99,7 @@ bool history_add_round(ConversationHistory *history,
 bool history_clear(ConversationHistory *history);
 
 /* 辅助函数 */
-char* history_to_json(const ConversationHistory *history);
+char* history_to_json(const ConversationHistory *history, Arena *arena);
 void history_print(const ConversationHistory *history);
 
 #endif /* HISTORY_H */
@@ -0,0 +1,256 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Streaming JSON Writer Implementation
+ *===========================================================================*/
+
+#include "json_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+/* 每字节批量判断：是否存在 < 0x20、'"' 或 '\\' 的字节 */
+#define ONES   0x0101010101010101ULL
+#define HIGHS  0x8080808080808080ULL
+#define HAS_ZERO(v)     (((v) - ONES) & ~(v) & HIGHS)
+#define HAS_LESS(v, n)  (((v) - ONES * (n)) & ~(v) & HIGHS)
+
+/* 需要转义的字节：0 表示原样输出，'u' 表示 \u00XX，其余为反斜杠后的字符 */
+static const char escape_table[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+};
+
+/* 确保还能追加 extra 字节（以及 '\0'） */
+static bool reserve(JsonWriter *writer, size_t extra) {
+    if (writer->failed) return false;
+    if (writer->len + extra + 1 <= writer->cap) return true;
+
+    /* 倍增扩容；首次预留（或一次需要更多）时按实际需要分配 */
+    size_t needed = writer->len + extra + 1;
+    size_t new_cap = writer->cap ? writer->cap * 2 : 256;
+    if (new_cap < needed) new_cap = needed;
+
+    char *new_buf = (char *)arena_resize(writer->arena, writer->buf, writer->len, new_cap);
+    if (!new_buf) {
+        fprintf(stderr, "Error: Failed to grow JSON output buffer\n");
+        writer->failed = true;
+        return false;
+    }
+    writer->buf = new_buf;
+    writer->cap = new_cap;
+    return true;
+}
+
+static void put_raw(JsonWriter *writer, const char *data, size_t len) {
+    if (!reserve(writer, len)) return;
+    memcpy(writer->buf + writer->len, data, len);
+    writer->len += len;
+}
+
+static void put_char(JsonWriter *writer, char c) {
+    if (!reserve(writer, 1)) return;
+    writer->buf[writer->len++] = c;
+}
+
+/* 写入值之前：同一层的后续元素需要逗号 */
+static void before_value(JsonWriter *writer) {
+    if (writer->after_key) {
+        writer->after_key = false;
+        return;
+    }
+    if (writer->depth > 0) {
+        if (writer->has_items[writer->depth - 1]) put_char(writer, ',');
+        writer->has_items[writer->depth - 1] = true;
+    }
+}
+
+/* 不需要转义的前缀长度：每次检查 8 个字节 */
+static size_t safe_run(const char *str, size_t len) {
+    size_t i = 0;
+
+    while (i + 8 <= len) {
+        uint64_t v;
+        memcpy(&v, str + i, 8);
+        if (HAS_LESS(v, 0x20) | HAS_ZERO(v ^ (ONES * '"')) | HAS_ZERO(v ^ (ONES * '\\'))) break;
+        i += 8;
+    }
+
+    while (i < len && escape_table[(unsigned char)str[i]] == 0) i++;
+    return i;
+}
+
+/* 转义字符串内容（不含引号）追加到输出 */
+static void put_escaped(JsonWriter *writer, const char *str, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+
+    /* 乐观预留：大多数字符串不需要转义 */
+    if (!reserve(writer, len)) return;
+
+    size_t i = 0;
+    while (i < len) {
+        size_t run = safe_run(str + i, len - i);
+        memcpy(writer->buf + writer->len, str + i, run);
+        writer->len += run;
+        i += run;
+        if (i >= len) break;
+
+        unsigned char c = (unsigned char)str[i++];
+        if (!reserve(writer, 6 + (len - i))) return;
+
+        char *out = writer->buf + writer->len;
+        char escape = escape_table[c];
+        if (escape == 'u') {
+            out[0] = '\\'; out[1] = 'u'; out[2] = '0'; out[3] = '0';
+            out[4] = hex[c >> 4];
+            out[5] = hex[c & 0x0f];
+            writer->len += 6;
+        } else {
+            out[0] = '\\';
+            out[1] = escape;
+            writer->len += 2;
+        }
+    }
+}
+
+void json_writer_init(JsonWriter *writer, Arena *arena, size_t initial_cap) {
+    if (!writer) return;
+
+    memset(writer, 0, sizeof(JsonWriter));
+    writer->arena = arena;
+    if (initial_cap > 0) reserve(writer, initial_cap);
+}
+
+void json_writer_free(JsonWriter *writer) {
+    if (!writer) return;
+
+    arena_free(writer->arena, writer->buf);
+    writer->buf = NULL;
+    writer->len = writer->cap = 0;
+}
+
+char* json_writer_finish(JsonWriter *writer, size_t *len) {
+    if (!writer) return NULL;
+
+    if (writer->failed || writer->depth != 0 || !reserve(writer, 0)) {
+        json_writer_free(writer);
+        return NULL;
+    }
+
+    char *result = writer->buf;
+    result[writer->len] = '\0';
+    if (len) *len = writer->len;
+
+    writer->buf = NULL;
+    writer->len = writer->cap = 0;
+    return result;
+}
+
+static void begin_container(JsonWriter *writer, char open) {
+    before_value(writer);
+    if (writer->depth >= JSON_WRITER_MAX_DEPTH) {
+        writer->failed = true;
+        return;
+    }
+    writer->has_items[writer->depth++] = false;
+    put_char(writer, open);
+}
+
+static void end_container(JsonWriter *writer, char close) {
+    if (writer->depth == 0) {
+        writer->failed = true;
+        return;
+    }
+    writer->depth--;
+    put_char(writer, close);
+}
+
+void json_writer_begin_object(JsonWriter *writer) { begin_container(writer, '{'); }
+void json_writer_end_object(JsonWriter *writer) { end_container(writer, '}'); }
+void json_writer_begin_array(JsonWriter *writer) { begin_container(writer, '['); }
+void json_writer_end_array(JsonWriter *writer) { end_container(writer, ']'); }
+
+void json_writer_key(JsonWriter *writer, const char *key) {
+    before_value(writer);
+    put_char(writer, '"');
+    put_escaped(writer, key, strlen(key));
+    put_raw(writer, "\":", 2);
+    writer->after_key = true;
+}
+
+void json_writer_string(JsonWriter *writer, const char *str) {
+    if (!str) {
+        json_writer_null(writer);
+        return;
+    }
+    json_writer_string_n(writer, str, strlen(str));
+}
+
+void json_writer_string_n(JsonWriter *writer, const char *str, size_t len) {
+    json_writer_string_begin(writer);
+    put_escaped(writer, str, len);
+    put_char(writer, '"');
+}
+
+void json_writer_raw(JsonWriter *writer, const char *json, size_t len) {
+    if (!json || len == 0) return;
+    before_value(writer);
+    put_raw(writer, json, len);
+}
+
+void json_writer_string_begin(JsonWriter *writer) {
+    before_value(writer);
+    put_char(writer, '"');
+}
+
+void json_writer_string_append(JsonWriter *writer, const char *str, size_t len) {
+    if (str) put_escaped(writer, str, len);
+}
+
+void json_writer_string_end(JsonWriter *writer) {
+    put_char(writer, '"');
+}
+
+void json_writer_int(JsonWriter *writer, long long value) {
+    char number[32];
+    int n = snprintf(number, sizeof(number), "%lld", value);
+    before_value(writer);
+    put_raw(writer, number, (size_t)n);
+}
+
+void json_writer_double(JsonWriter *writer, double value) {
+    /* JSON 不支持 NaN / Infinity */
+    if (!isfinite(value)) {
+        json_writer_null(writer);
+        return;
+    }
+
+    /* 与 cJSON 相同：优先使用 15 位有效数字，无法精确还原时使用 17 位 */
+    char number[32];
+    int n = snprintf(number, sizeof(number), "%1.15g", value);
+    if (strtod(number, NULL) != value) {
+        n = snprintf(number, sizeof(number), "%1.17g", value);
+    }
+
+    before_value(writer);
+    put_raw(writer, number, (size_t)n);
+}
+
+void json_writer_bool(JsonWriter *writer, bool value) {
+    before_value(writer);
+    if (value) {
+        put_raw(writer, "true", 4);
+    } else {
+        put_raw(writer, "false", 5);
+    }
+}
+
+void json_writer_null(JsonWriter *writer) {
+    before_value(writer);
+    put_raw(writer, "null", 4);
+}
@@ -0,0 +1,63 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Streaming JSON Writer Header
+ *===========================================================================*/
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include "arena.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* 最大嵌套层数 */
+#define JSON_WRITER_MAX_DEPTH 32
+
+/* 顺序 JSON 写入器
+ * 直接把 JSON 文本追加到可增长的输出缓冲区，不构建中间的树结构；
+ * 字符串只在转义时复制一次。逗号由写入器根据嵌套层级自动插入。
+ * 任何一步分配失败后写入器进入错误状态，json_writer_finish 返回 NULL。
+ */
+typedef struct {
+    Arena *arena;               /* 输出缓冲区所在的内存池（NULL 时使用 malloc） */
+    char *buf;
+    size_t len;
+    size_t cap;
+
+    int depth;
+    bool has_items[JSON_WRITER_MAX_DEPTH];  /* 各层是否已有元素（决定是否需要逗号） */
+    bool after_key;             /* 刚写完键名，下一个值不需要逗号 */
+    bool failed;
+} JsonWriter;
+
+/* 函数声明 */
+void json_writer_init(JsonWriter *writer, Arena *arena, size_t initial_cap);
+void json_writer_free(JsonWriter *writer);
+
+/* 结束写入：返回以 '\0' 结尾的 JSON 文本（所有权转移给调用者），失败时返回 NULL */
+char* json_writer_finish(JsonWriter *writer, size_t *len);
+
+void json_writer_begin_object(JsonWriter *writer);
+void json_writer_end_object(JsonWriter *writer);
+void json_writer_begin_array(JsonWriter *writer);
+void json_writer_end_array(JsonWriter *writer);
+
+/* 对象键名（键名按字符串转义） */
+void json_writer_key(JsonWriter *writer, const char *key);
+
+void json_writer_string(JsonWriter *writer, const char *str);
+void json_writer_string_n(JsonWriter *writer, const char *str, size_t len);
+void json_writer_int(JsonWriter *writer, long long value);
+void json_writer_double(JsonWriter *writer, double value);
+void json_writer_bool(JsonWriter *writer, bool value);
+void json_writer_null(JsonWriter *writer);
+
+/* 追加已经序列化好的 JSON 文本（一个值，或以逗号分隔的多个数组元素），不做任何检查 */
+void json_writer_raw(JsonWriter *writer, const char *json, size_t len);
+
+/* 拼接字符串值：多个片段连续写入同一个 JSON 字符串 */
+void json_writer_string_begin(JsonWriter *writer);
+void json_writer_string_append(JsonWriter *writer, const char *str, size_t len);
+void json_writer_string_end(JsonWriter *writer);
+
+#endif /* JSON_WRITER_H */
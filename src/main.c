@@ -13,6 +13,13 @@
 #include "system_info.h"
 #include "api.h"
 #include "history.h"
+#include "session.h"
+#include "daemon.h"
+#include "batch.h"
+#include "timing.h"
+#include "cassette.h"
+#include "json_writer.h"
+#include "probes.h"
 #include "ui.h"
 
 #ifdef _WIN32
@@ -28,55 +35,30 @@
 
 #define VERSION "1.0.0"
 
-/* 流式输出数据结构 */
+/* 仅有长格式的命令行选项 */
+enum {
+    OPT_DAEMON = 1000,
+    OPT_DAEMON_STOP,
+    OPT_NO_DAEMON,
+    OPT_BATCH,
+    OPT_JOBS,
+    OPT_NO_CACHE,
+    OPT_REFRESH,
+    OPT_STARTUP_PROFILE,
+    OPT_TIMINGS,
+    OPT_RECORD,
+    OPT_REPLAY,
+    OPT_REPLAY_SPEED
+};
+
+/* 流式输出显示状态 */
 typedef struct {
-    char *reasoning_buffer;      /* 思考过程缓冲区 */
-    size_t reasoning_size;       /* 思考过程缓冲区大小 */
-    size_t reasoning_pos;        /* 思考过程当前位置 */
-
-    char *answer_buffer;         /* 最终回答缓冲区 */
-    size_t answer_size;          /* 最终回答缓冲区大小 */
-    size_t answer_pos;           /* 最终回答当前位置 */
-
     bool reasoning_started;      /* 思考过程是否已开始 */
     bool answer_started;         /* 最终回答是否已开始 */
+    bool command_shown;          /* 命令框是否已在流式输出中显示 */
     FILE *tty;                   /* 终端文件描述符 */
 } StreamUserData;
 
-/* 辅助函数：追加内容到缓冲区 */
-static void append_to_buffer(char **buffer, size_t *buffer_size,
-                            size_t *buffer_pos, const char *content) {
-    size_t content_len = strlen(content);
-
-    /* 初始化缓冲区（如果需要） */
-    if (*buffer == NULL) {
-        *buffer_size = 4096;
-        *buffer = (char *)malloc(*buffer_size);
-        if (!*buffer) {
-            fprintf(stderr, "Error: Failed to allocate buffer\n");
-            return;
-        }
-        *buffer_pos = 0;
-        (*buffer)[0] = '\0';
-    }
-
-    /* 扩展缓冲区（如果需要） */
-    while (*buffer_pos + content_len + 1 >= *buffer_size) {
-        size_t new_size = *buffer_size * 2;
-        char *new_buffer = (char *)realloc(*buffer, new_size);
-        if (!new_buffer) {
-            fprintf(stderr, "Error: Failed to realloc buffer\n");
-            return;
-        }
-        *buffer = new_buffer;
-        *buffer_size = new_size;
-    }
-
-    /* 追加内容到缓冲区 */
-    strcat(*buffer + *buffer_pos, content);
-    *buffer_pos += content_len;
-}
-
 /* 流式回调函数 */
 static void stream_callback(const char *content, StreamContentType content_type, void *userdata) {
     StreamUserData *data = (StreamUserData *)userdata;
@@ -89,11 +71,17 @@ static void stream_callback(const char *content, StreamContentType content_type,
         return;
     }
 
+    /* 命令块闭合：立即显示命令，无需等待模型输出剩余的说明文字 */
+    if (content_type == STREAM_CONTENT_COMMAND) {
+        printf("\n\n");
+        print_command(content);
+        fflush(stdout);
+        data->command_shown = true;
+        return;
+    }
+
     /* 处理思考过程 */
     if (content_type == STREAM_CONTENT_REASONING) {
-        append_to_buffer(&data->reasoning_buffer, &data->reasoning_size,
-                        &data->reasoning_pos, content);
-
         /* 显示标题（仅首次） */
         if (!data->reasoning_started) {
             printf("%s[* Thinking Process]%s\n", COLOR_CYAN, COLOR_RESET);
@@ -108,9 +96,6 @@ static void stream_callback(const char *content, StreamContentType content_type,
 
     /* 处理最终回答 */
     if (content_type == STREAM_CONTENT_ANSWER) {
-        append_to_buffer(&data->answer_buffer, &data->answer_size,
-                        &data->answer_pos, content);
-
         /* 显示标题（仅首次） */
         if (!data->answer_started) {
             /* 如果思考过程已结束，先添加换行 */
@@ -138,8 +123,244 @@ static void print_version(void) {
     printf("License MIT\n");
 }
 
+/* 读取用户输入（命令行参数或标准输入），失败时返回 NULL */
+static char* read_user_input(int argc, char *argv[], int first_arg) {
+    char *user_input = NULL;
+
+    if (first_arg < argc) {
+        /* 从命令行参数获取输入 */
+        size_t total_len = 0;
+        for (int i = first_arg; i < argc; i++) {
+            total_len += strlen(argv[i]) + 1;
+        }
+
+        user_input = (char *)malloc(total_len);
+        if (!user_input) {
+            fprintf(stderr, "Error: Failed to allocate memory for input\n");
+            return NULL;
+        }
+
+        user_input[0] = '\0';
+        for (int i = first_arg; i < argc; i++) {
+            strcat(user_input, argv[i]);
+            if (i < argc - 1) {
+                strcat(user_input, " ");
+            }
+        }
+    } else {
+        /* 从标准输入读取 */
+        print_banner();
+
+        printf("%sEnter your command description (Ctrl+D to finish):%s\n",
+               COLOR_BLUE, COLOR_RESET);
+        printf("%s", COLOR_RESET);
+
+        char buffer[4096];
+        size_t total_size = 0;
+        user_input = (char *)malloc(1);
+        if (!user_input) {
+            fprintf(stderr, "Error: Failed to allocate memory for input\n");
+            return NULL;
+        }
+        user_input[0] = '\0';
+
+        while (fgets(buffer, sizeof(buffer), stdin)) {
+            size_t buffer_len = strlen(buffer);
+            char *new_input = (char *)realloc(user_input, total_size + buffer_len + 1);
+            if (!new_input) {
+                fprintf(stderr, "Error: Failed to allocate memory for input\n");
+                free(user_input);
+                return NULL;
+            }
+            user_input = new_input;
+            strcat(user_input, buffer);
+            total_size += buffer_len;
+        }
+
+        /* 去除末尾的换行符 */
+        while (total_size > 0 &&
+               (user_input[total_size - 1] == '\n' ||
+                user_input[total_size - 1] == '\r')) {
+            user_input[--total_size] = '\0';
+        }
+
+        printf("\n");
+    }
+
+    /* 检查输入是否为空 */
+    if (strlen(user_input) == 0) {
+        print_error("No input provided");
+        free(user_input);
+        return NULL;
+    }
+
+    return user_input;
+}
+
+/* 写入一个毫秒值（保留 3 位小数），负数表示该阶段没有发生 */
+static void write_ms(JsonWriter *writer, const char *key, double ms) {
+    json_writer_key(writer, key);
+    if (ms < 0) {
+        json_writer_null(writer);
+    } else {
+        json_writer_double(writer, (double)(long long)(ms * 1000.0 + 0.5) / 1000.0);
+    }
+}
+
+/* --timings：向 stderr 输出一行 JSON，包含启动阶段耗时和请求时间线 */
+static void print_timings(const ApiResponse *response, const Config *cfg, bool streamed,
+                          uint64_t main_start) {
+    const RequestTimings *t = &response->timings;
+    JsonWriter writer;
+    json_writer_init(&writer, NULL, 1024);
+
+    json_writer_begin_object(&writer);
+    json_writer_key(&writer, "mode");
+    json_writer_string(&writer, response->cached ? "cache" : streamed ? "stream" : "non-stream");
+    json_writer_key(&writer, "model");
+    json_writer_string(&writer, cfg->model);
+    json_writer_key(&writer, "success");
+    json_writer_bool(&writer, response->success);
+
+    json_writer_key(&writer, "startup_ms");
+    json_writer_begin_object(&writer);
+    write_ms(&writer, "config_load", startup_phase_ms(STARTUP_CONFIG));
+    write_ms(&writer, "system_detection", startup_phase_ms(STARTUP_SYSTEM));
+    write_ms(&writer, "history_load", startup_phase_ms(STARTUP_HISTORY));
+    write_ms(&writer, "network_init", startup_phase_ms(STARTUP_NETWORK));
+    json_writer_end_object(&writer);
+
+    /* 请求时间线：相对请求开始的毫秒数 */
+    json_writer_key(&writer, "request_ms");
+    if (t->start_ns == 0) {
+        json_writer_null(&writer);
+    } else {
+        json_writer_begin_object(&writer);
+        write_ms(&writer, "body_build", t->body_built);
+        write_ms(&writer, "dns", t->dns);
+        write_ms(&writer, "connect", t->connect);
+        write_ms(&writer, "tls", t->tls);
+        write_ms(&writer, "request_sent", t->request_sent);
+        write_ms(&writer, "first_byte", t->first_byte);
+        write_ms(&writer, "first_reasoning", t->first_reasoning);
+        write_ms(&writer, "first_answer", t->first_answer);
+        write_ms(&writer, "command", t->command);
+        write_ms(&writer, "end", t->end);
+        json_writer_end_object(&writer);
+    }
+    json_writer_key(&writer, "reused_connection");
+    json_writer_bool(&writer, t->reused_connection);
+    json_writer_key(&writer, "truncated");
+    json_writer_bool(&writer, response->truncated);
+
+    /* 生成速度：流式为第一个片段到传输结束，非流式为请求发出到第一个字节（服务端生成时间） */
+    double window = -1;
+    if (streamed) {
+        double first = t->first_reasoning;
+        if (first < 0 || (t->first_answer >= 0 && t->first_answer < first)) first = t->first_answer;
+        if (first >= 0 && t->end > first) window = t->end - first;
+    } else if (t->request_sent >= 0 && t->first_byte > t->request_sent) {
+        window = t->first_byte - t->request_sent;
+    }
+    json_writer_key(&writer, "completion_tokens");
+    if (response->completion_tokens > 0) {
+        json_writer_int(&writer, response->completion_tokens);
+    } else {
+        json_writer_null(&writer);
+    }
+    json_writer_key(&writer, "tokens_per_second");
+    if (response->completion_tokens > 0 && window > 0) {
+        double rate = response->completion_tokens * 1000.0 / window;
+        json_writer_double(&writer, (double)(long long)(rate * 10.0 + 0.5) / 10.0);
+    } else {
+        json_writer_null(&writer);
+    }
+
+    write_ms(&writer, "total_ms", timing_ms_since(main_start));
+    json_writer_end_object(&writer);
+
+    char *json = json_writer_finish(&writer, NULL);
+    if (json) {
+        fflush(stdout);
+        fprintf(stderr, "%s\n", json);
+        free(json);
+    }
+}
+
+/* 显示结果并询问是否执行，返回进程退出码
+ * command_shown: 流式输出中已经显示过命令框
+ */
+static int handle_response(const ApiResponse *response, bool streamed, bool command_shown,
+                           bool verbose) {
+    /* 显示结果（非流式模式需要显示，流式模式已经实时显示了） */
+    if (!streamed) {
+        if (response->cached_query) {
+            char message[1024];
+            snprintf(message, sizeof(message),
+                     "Similar cached result (%.0f%% match for \"%s\"; use --refresh to query the API)",
+                     response->cache_similarity * 100, response->cached_query);
+            print_info(message);
+        } else if (response->cached) {
+            print_info("Cached result (use --refresh to query the API again)");
+        }
+        printf("\n");
+        if (response->thinking_process) {
+            print_thinking(response->thinking_process);
+        }
+
+        if (response->command) {
+            print_command(response->command);
+        }
+    } else if (!command_shown) {
+        /* 流式模式：只是显示命令部分的标题 */
+        if (response->command) {
+            printf("\n\n");
+            print_command(response->command);
+        }
+    }
+
+    if (!response->command) {
+        print_error("Failed to extract command from response");
+        if (verbose && response->raw_response) {
+            printf("\nRaw response:\n%s\n", response->raw_response);
+        }
+        return 1;
+    }
+
+    /* 询问是否执行 */
+    printf("\n");
+    if (ask_confirmation("Do you want to execute this command?")) {
+        printf("\n");
+        printf("%s[>] Executing command...%s\n\n", COLOR_GREEN, COLOR_RESET);
+        int ret = system(response->command);
+        TRACE_PROBE2(command_executed, response->command, ret);
+        printf("\n");
+        if (ret == 0) {
+            print_success("Command executed successfully");
+        } else {
+            printf("%s[!] Command exited with code: %d%s\n",
+                   COLOR_YELLOW, ret, COLOR_RESET);
+        }
+    } else {
+        print_info("Command execution cancelled");
+    }
+
+    return 0;
+}
+
+/* 获取程序名（去除路径） */
+static const char* program_basename(const char *path) {
+    const char *name = strrchr(path, '/');
+#ifdef _WIN32
+    const char *backslash = strrchr(path, '\\');
+    if (backslash && (!name || backslash > name)) name = backslash;
+#endif
+    return name ? name + 1 : path;
+}
+
 /* 主函数 */
 int main(int argc, char *argv[]) {
+    uint64_t main_start = timing_now_ns();
     int opt;
     bool show_help = false;
     bool show_version = false;
@@ -147,8 +368,25 @@ int main(int argc, char *argv[]) {
     bool show_history = false;
     bool clear_history = false;
     bool run_init = false;
+    bool run_daemon = false;
+    bool stop_daemon = false;
+    bool use_daemon = true;
+    bool verbose = false;
+    bool no_cache = false;
+    bool refresh = false;
+    bool timings = false;
+    const char *batch_file = NULL;
+    const char *record_dir = NULL;
+    const char *replay_dir = NULL;
+    double replay_speed = 1.0;
+    int batch_jobs = BATCH_DEFAULT_JOBS;
     char *user_input = NULL;
 
+    /* 以 glm-cmdd 名称启动时直接在前台运行守护进程（适用于 systemd 等服务管理器） */
+    if (argc > 0 && strcmp(program_basename(argv[0]), "glm-cmdd") == 0) {
+        return daemon_run(true);
+    }
+
     /* 命令行选项 */
     static struct option long_options[] = {
         {"help",          no_argument,       0, 'h'},
@@ -158,6 +396,18 @@ int main(int argc, char *argv[]) {
         {"init",          no_argument,       0, 'I'},
         {"history",       no_argument,       0,  'H'},
         {"clear-history", no_argument,       0,  'c'},
+        {"daemon",        no_argument,       0,  OPT_DAEMON},
+        {"daemon-stop",   no_argument,       0,  OPT_DAEMON_STOP},
+        {"no-daemon",     no_argument,       0,  OPT_NO_DAEMON},
+        {"batch",         required_argument, 0,  OPT_BATCH},
+        {"jobs",          required_argument, 0,  OPT_JOBS},
+        {"no-cache",      no_argument,       0,  OPT_NO_CACHE},
+        {"refresh",       no_argument,       0,  OPT_REFRESH},
+        {"startup-profile", no_argument,     0,  OPT_STARTUP_PROFILE},
+        {"timings",       no_argument,       0,  OPT_TIMINGS},
+        {"record",        required_argument, 0,  OPT_RECORD},
+        {"replay",        required_argument, 0,  OPT_REPLAY},
+        {"replay-speed",  required_argument, 0,  OPT_REPLAY_SPEED},
         {0, 0, 0, 0}
     };
 
@@ -171,7 +421,8 @@ int main(int argc, char *argv[]) {
                 show_version = true;
                 break;
             case 'V':
-                break;  /* 已在 Config 中处理 */
+                verbose = true;
+                break;
             case 'i':
                 show_info = true;
                 break;
@@ -184,12 +435,71 @@ int main(int argc, char *argv[]) {
             case 'c':
                 clear_history = true;
                 break;
+            case OPT_DAEMON:
+                run_daemon = true;
+                break;
+            case OPT_DAEMON_STOP:
+                stop_daemon = true;
+                break;
+            case OPT_NO_DAEMON:
+                use_daemon = false;
+                break;
+            case OPT_BATCH:
+                batch_file = optarg;
+                break;
+            case OPT_JOBS:
+                batch_jobs = atoi(optarg);
+                if (batch_jobs < 1 || batch_jobs > BATCH_MAX_JOBS) {
+                    fprintf(stderr, "Error: --jobs must be between 1 and %d\n", BATCH_MAX_JOBS);
+                    return 1;
+                }
+                break;
+            case OPT_NO_CACHE:
+                no_cache = true;
+                break;
+            case OPT_REFRESH:
+                refresh = true;
+                break;
+            case OPT_STARTUP_PROFILE:
+                startup_profile_enable(main_start);
+                break;
+            case OPT_TIMINGS:
+                timings = true;
+                startup_phases_enable(main_start);
+                break;
+            case OPT_RECORD:
+                record_dir = optarg;
+                break;
+            case OPT_REPLAY:
+                replay_dir = optarg;
+                break;
+            case OPT_REPLAY_SPEED:
+                replay_speed = atof(optarg);
+                if (replay_speed < 0) {
+                    fprintf(stderr, "Error: --replay-speed must not be negative\n");
+                    return 1;
+                }
+                break;
             default:
                 print_usage(argv[0]);
                 return 1;
         }
     }
 
+    /* 录制 / 重放 API 流量 */
+    if (record_dir && replay_dir) {
+        fprintf(stderr, "Error: --record and --replay cannot be combined\n");
+        return 1;
+    }
+    if ((record_dir || replay_dir) && batch_file) {
+        fprintf(stderr, "Error: --record and --replay do not support --batch\n");
+        return 1;
+    }
+    if ((record_dir && !cassette_record(record_dir)) ||
+        (replay_dir && !cassette_replay(replay_dir, replay_speed))) {
+        return 1;
+    }
+
     /* 显示版本信息 */
     if (show_version) {
         print_version();
@@ -213,6 +523,7 @@ int main(int argc, char *argv[]) {
     /* 显示历史记录 */
     if (show_history) {
         /* 创建配置 */
+        uint64_t start = startup_phase_begin();
         Config *cfg = config_create();
         if (!cfg) {
             fprintf(stderr, "Error: Failed to create configuration\n");
@@ -220,10 +531,11 @@ int main(int argc, char *argv[]) {
         }
 
         /* 加载配置 */
-        if (!config_load(cfg)) {
+        if (!config_load(cfg) || !config_validate(cfg)) {
             config_destroy(cfg);
             return 1;
         }
+        startup_phase_end(STARTUP_CONFIG, start);
 
         /* 创建历史管理器 */
         if (cfg->memory_enabled) {
@@ -231,9 +543,11 @@ int main(int argc, char *argv[]) {
             const char *home = getenv("HOME");
             if (home) {
                 snprintf(config_dir, sizeof(config_dir), "%s/.glm-cmd", home);
+                start = startup_phase_begin();
                 ConversationHistory *history = history_create(config_dir, cfg->memory_rounds);
                 if (history) {
                     history_load(history);
+                    startup_phase_end(STARTUP_HISTORY, start);
                     printf("Conversation History (%d rounds):\n", history->current_count);
                     printf("========================================\n\n");
                     history_print(history);
@@ -259,7 +573,7 @@ int main(int argc, char *argv[]) {
         }
 
         /* 加载配置 */
-        if (!config_load(cfg)) {
+        if (!config_load(cfg) || !config_validate(cfg)) {
             config_destroy(cfg);
             return 1;
         }
@@ -271,6 +585,8 @@ int main(int argc, char *argv[]) {
             snprintf(config_dir, sizeof(config_dir), "%s/.glm-cmd", home);
             ConversationHistory *history = history_create(config_dir, cfg->memory_rounds);
             if (history) {
+                /* 序列化的请求前缀随历史一起删除 */
+                history_enable_prefix_cache(history, config_dir);
                 history_clear(history);
                 printf("Conversation history cleared successfully.\n");
                 history_destroy(history);
@@ -281,412 +597,145 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
-    /* 创建配置 */
-    Config *cfg = config_create();
-    if (!cfg) {
-        fprintf(stderr, "Error: Failed to create configuration\n");
-        return 1;
-    }
-
-    /* 加载配置（优先级：配置文件 > 环境变量 > 默认值） */
-    if (!config_load(cfg)) {
-        config_destroy(cfg);
-        return 1;
+    /* 启动 / 停止常驻守护进程 */
+    if (run_daemon) {
+        return daemon_run(false);
     }
-
-    /* 处理 verbose 选项 */
-    for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "-V") == 0 || strcmp(argv[i], "--verbose") == 0) {
-            cfg->verbose = true;
-            break;
-        }
-    }
-
-    /* 检测系统信息 */
-    SystemInfo *sys_info = system_info_create();
-    if (!sys_info) {
-        fprintf(stderr, "Error: Failed to create system info\n");
-        config_destroy(cfg);
-        return 1;
-    }
-
-    if (!system_info_detect(sys_info)) {
-        fprintf(stderr, "Warning: Failed to detect some system information\n");
-    }
-
-    /* 创建对话历史管理器（如果启用） */
-    ConversationHistory *history = NULL;
-    if (cfg->memory_enabled) {
-        /* 获取配置目录路径 */
-        const char *home = NULL;
-        char config_dir[512];
-
-#ifdef _WIN32
-        char home_dir[MAX_PATH];
-        if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_PROFILE, NULL, 0, home_dir))) {
-            home = home_dir;
-        }
-#else
-        home = getenv("HOME");
-        if (!home) {
-            struct passwd *pw = getpwuid(getuid());
-            if (pw) home = pw->pw_dir;
-        }
-#endif
-
-        if (home) {
-            snprintf(config_dir, sizeof(config_dir), "%s/.glm-cmd", home);
-            history = history_create(config_dir, cfg->memory_rounds);
-            if (history) {
-                history_load(history);
-            } else {
-                fprintf(stderr, "Warning: Failed to create conversation history\n");
-            }
-        }
+    if (stop_daemon) {
+        return daemon_stop();
     }
 
     /* 显示系统信息 */
     if (show_info) {
+        Session *session = session_create(verbose);
+        if (!session) {
+            return 1;
+        }
         print_banner();
-        system_info_print(sys_info);
+        system_info_print(session->sys_info);
         printf("\n");
-        config_print(cfg);
-        system_info_destroy(sys_info);
-        config_destroy(cfg);
-        if (history) history_destroy(history);
+        config_print(session->cfg);
+        session_destroy(session);
         return 0;
     }
 
-    /* 获取用户输入 */
-    if (optind < argc) {
-        /* 从命令行参数获取输入 */
-        size_t total_len = 0;
-        for (int i = optind; i < argc; i++) {
-            total_len += strlen(argv[i]) + 1;
-        }
-
-        user_input = (char *)malloc(total_len);
-        if (!user_input) {
-            fprintf(stderr, "Error: Failed to allocate memory for input\n");
-            system_info_destroy(sys_info);
-            config_destroy(cfg);
+    /* 批量模式：并发翻译文件中的查询，每行输出一条 JSON 结果 */
+    if (batch_file) {
+        Session *session = session_create(verbose);
+        if (!session) {
             return 1;
         }
-
-        user_input[0] = '\0';
-        for (int i = optind; i < argc; i++) {
-            strcat(user_input, argv[i]);
-            if (i < argc - 1) {
-                strcat(user_input, " ");
-            }
-        }
-    } else {
-        /* 从标准输入读取 */
-        print_banner();
-
-        printf("%sEnter your command description (Ctrl+D to finish):%s\n",
-               COLOR_BLUE, COLOR_RESET);
-        printf("%s", COLOR_RESET);
-
-        char buffer[4096];
-        size_t total_size = 0;
-        user_input = (char *)malloc(1);
-        user_input[0] = '\0';
-
-        while (fgets(buffer, sizeof(buffer), stdin)) {
-            size_t buffer_len = strlen(buffer);
-            char *new_input = (char *)realloc(user_input, total_size + buffer_len + 1);
-            if (!new_input) {
-                fprintf(stderr, "Error: Failed to allocate memory for input\n");
-                free(user_input);
-                system_info_destroy(sys_info);
-                config_destroy(cfg);
-                return 1;
-            }
-            user_input = new_input;
-            strcat(user_input, buffer);
-            total_size += buffer_len;
-        }
-
-        /* 去除末尾的换行符 */
-        while (total_size > 0 &&
-               (user_input[total_size - 1] == '\n' ||
-                user_input[total_size - 1] == '\r')) {
-            user_input[--total_size] = '\0';
-        }
-
-        printf("\n");
+        bool ok = batch_run(session, batch_file, batch_jobs, stdout);
+        session_destroy(session);
+        return ok ? 0 : 1;
     }
 
-    /* 检查输入是否为空 */
-    if (!user_input || strlen(user_input) == 0) {
-        print_error("No input provided");
-        if (user_input) free(user_input);
-        system_info_destroy(sys_info);
-        config_destroy(cfg);
+    /* 获取用户输入 */
+    user_input = read_user_input(argc, argv, optind);
+    if (!user_input) {
         return 1;
     }
 
-    /* 显示输入 */
-    if (cfg->verbose) {
-        printf("\n=== Input ===\n");
-        printf("%s\n", user_input);
-        printf("============\n\n");
-    }
-
-    /* 发送 API 请求 */
     ApiResponse *response = api_response_create();
     if (!response) {
         fprintf(stderr, "Error: Failed to create API response\n");
         free(user_input);
-        system_info_destroy(sys_info);
-        config_destroy(cfg);
         return 1;
     }
 
-    printf("%s[*] Processing your request...%s\n\n", COLOR_BLUE, COLOR_RESET);
-
-    /* 调试: 显示历史状态 */
-    if (cfg->verbose && history) {
-        printf("%s[DEBUG] Conversation History: %d rounds%s\n", COLOR_YELLOW, history->current_count, COLOR_RESET);
-    }
-
-    bool success;
-
     /* 流式输出数据 */
     StreamUserData stream_data = {0};
-    stream_data.reasoning_buffer = NULL;
-    stream_data.answer_buffer = NULL;
     stream_data.reasoning_started = false;
     stream_data.answer_started = false;
     stream_data.tty = stdout;
 
-    /* 根据配置选择使用流式或非流式 API */
-    if (cfg->stream_enabled) {
-        /* 使用流式 API */
-        success = api_send_request_stream(cfg, sys_info, history, user_input,
-                                          stream_callback, &stream_data, response);
-    } else {
-        /* 使用非流式 API */
-        success = api_send_request(cfg, sys_info, history, user_input, response);
+    bool streamed = false;
+    bool announced = false;
+    int rc = -1;
+
+    /* 快速路径：守护进程在运行时直接转发查询，跳过配置、系统检测和历史加载
+     * （--no-cache / --refresh 只作用于本次查询，--timings 需要本地的时间线，
+     *  --record / --replay 需要本进程发送请求，都在本地执行）
+     */
+    bool cassette = record_dir || replay_dir;
+    int daemon_fd = (use_daemon && !verbose && !no_cache && !refresh && !timings && !cassette)
+                        ? daemon_connect() : -1;
+    if (daemon_fd >= 0) {
+        printf("%s[*] Processing your request...%s\n\n", COLOR_BLUE, COLOR_RESET);
+        announced = true;
+        rc = daemon_query(daemon_fd, user_input, stream_callback, &stream_data,
+                          response, &streamed);
     }
 
-    if (!success) {
-        printf("\n");
-        if (response->error_message) {
-            print_error(response->error_message);
+    if (rc >= 0) {
+        if (!response->success) {
+            printf("\n");
+            print_error(response->error_message ? response->error_message
+                                                : "Failed to get response from API");
+            rc = 1;
         } else {
-            print_error("Failed to get response from API");
+            rc = handle_response(response, streamed, stream_data.command_shown, false);
         }
+
         api_response_destroy(response);
         free(user_input);
-        system_info_destroy(sys_info);
-        if (history) history_destroy(history);
-        config_destroy(cfg);
-        if (stream_data.reasoning_buffer) free(stream_data.reasoning_buffer);
-        if (stream_data.answer_buffer) free(stream_data.answer_buffer);
-        return 1;
+        return rc;
     }
 
-    /* 流式模式：从 answer_buffer 提取命令 */
-    if (cfg->stream_enabled && stream_data.answer_buffer) {
-        if (cfg->verbose) {
-            printf("[DEBUG] answer_buffer size: %zu bytes\n", stream_data.answer_pos);
-            printf("[DEBUG] answer_buffer content preview (first 500 chars):\n%.500s\n[DEBUG END]\n",
-                   stream_data.answer_buffer);
-        }
-
-        /* 在回答缓冲区中查找最后一个命令块（更可靠） */
-        const char *last_cmd_start = NULL;
-        const char *last_cmd_end = NULL;
-        const char *search_pos = stream_data.answer_buffer;
-
-        /* 查找所有 ```bash 块，取最后一个 */
-        while (true) {
-            const char *cmd_start = strstr(search_pos, "```bash");
-            if (!cmd_start) break;
-
-            cmd_start += strlen("```bash");  /* 跳过标记本身 */
-            const char *cmd_end = strstr(cmd_start, "```");
-
-            if (cmd_end && cmd_end > cmd_start) {
-                /* 找到一个有效的代码块，记录它 */
-                last_cmd_start = cmd_start;
-                last_cmd_end = cmd_end;
-                search_pos = cmd_end + 3;  /* 继续搜索 */
-            } else if (cmd_start) {
-                /* 找到了开始但没有结束标记 - 可能是不完整的响应 */
-                /* 检查 cmd_start 后面是否有实际内容 */
-                const char *content_start = cmd_start;
-                while (content_start < cmd_start + 100 && *content_start &&
-                       (*content_start == ' ' || *content_start == '\n' || *content_start == '\r')) {
-                    content_start++;
-                }
-
-                if (*content_start && content_start < stream_data.answer_buffer + stream_data.answer_pos) {
-                    /* 有内容但没有结束标记，使用到最后作为命令 */
-                    last_cmd_start = cmd_start;
-                    last_cmd_end = stream_data.answer_buffer + stream_data.answer_pos;
-                    if (cfg->verbose) {
-                        printf("[DEBUG] Found unclosed code block, using remaining content\n");
-                        printf("[DEBUG] Command preview: %.200s\n", cmd_start);
-                    }
-                }
-                break;
-            }
-        }
-
-        if (last_cmd_start && last_cmd_end && last_cmd_end > last_cmd_start) {
-            size_t cmd_len = last_cmd_end - last_cmd_start;
-            char *command = (char *)malloc(cmd_len + 1);
-            if (command) {
-                strncpy(command, last_cmd_start, cmd_len);
-                command[cmd_len] = '\0';
-
-                /* 去除首尾空白 */
-                char *start = command;
-                char *end = start + cmd_len - 1;
-                while (start < end && (*start == ' ' || *start == '\n' || *start == '\r')) start++;
-                while (end > start && (*end == ' ' || *end == '\n' || *end == '\r')) end--;
-                *(end + 1) = '\0';
-
-                if (start != command) {
-                    memmove(command, start, strlen(start) + 1);
-                }
-
-                /* 验证命令不为空且有效 */
-                if (strlen(start) > 0) {
-                    /* 设置命令到响应中 */
-                    response->command = command;
-                    if (cfg->verbose) {
-                        printf("[DEBUG] Successfully extracted command: %s\n", command);
-                    }
-                } else {
-                    if (cfg->verbose) {
-                        printf("[DEBUG] Extracted command is empty after trimming\n");
-                    }
-                    free(command);
-                }
-            }
-        } else {
-            if (cfg->verbose) {
-                printf("[DEBUG] No valid ```bash code block found in answer_buffer\n");
-                printf("[DEBUG] Searched for '```bash' but found none or incomplete\n");
-            }
-        }
+    /* 本地执行：加载配置、检测系统信息并加载对话历史 */
+    Session *session = session_create(verbose);
+    if (!session) {
+        api_response_destroy(response);
+        free(user_input);
+        return 1;
     }
 
-    /* 保存对话到历史（如果启用） */
-    if (history && response->success && response->command) {
-        /* 构建完整的响应文本（包含思考过程和命令） */
-        char *full_response = NULL;
-
-        if (cfg->stream_enabled && (stream_data.reasoning_buffer || stream_data.answer_buffer)) {
-            /* 流式模式：组合思考过程和回答 */
-            size_t total_len = 1;  /* 至少包含 null 终止符 */
-            if (stream_data.reasoning_buffer) {
-                total_len += strlen(stream_data.reasoning_buffer) + 20;  /* +20 for labels */
-            }
-            if (stream_data.answer_buffer) {
-                total_len += strlen(stream_data.answer_buffer) + 20;
-            }
-
-            full_response = (char *)malloc(total_len);
-            if (full_response) {
-                full_response[0] = '\0';
-                if (stream_data.reasoning_buffer) {
-                    strcat(full_response, "Thinking: ");
-                    strcat(full_response, stream_data.reasoning_buffer);
-                }
-                if (stream_data.answer_buffer) {
-                    if (stream_data.reasoning_buffer) {
-                        strcat(full_response, "\n\n");
-                    }
-                    strcat(full_response, "Answer: ");
-                    strcat(full_response, stream_data.answer_buffer);
-                }
-            }
-        } else if (response->thinking_process && strlen(response->thinking_process) > 0) {
-            /* 非流式模式：使用 response 中的内容 */
-            size_t len = strlen(response->thinking_process) + strlen(response->command) + 20;
-            full_response = (char *)malloc(len);
-            if (full_response) {
-                snprintf(full_response, len, "%s\n\nCommand: %s",
-                        response->thinking_process, response->command);
-            }
-        } else {
-            full_response = strdup(response->command);
-        }
+    /* 录制和重放都要经过真实的请求路径，不使用响应缓存 */
+    if (no_cache || cassette) session->cfg->cache_enabled = false;
+    if (refresh) session->cfg->cache_refresh = true;
 
-        if (full_response) {
-            history_add_round(history, user_input, full_response);
-            history_save(history);
-            free(full_response);
-        }
+    /* 显示输入 */
+    if (session->cfg->verbose) {
+        printf("\n=== Input ===\n");
+        printf("%s\n", user_input);
+        printf("============\n\n");
     }
 
-    /* 清理流式缓冲区 */
-    if (stream_data.reasoning_buffer) {
-        free(stream_data.reasoning_buffer);
+    if (!announced) {
+        printf("%s[*] Processing your request...%s\n\n", COLOR_BLUE, COLOR_RESET);
     }
-    if (stream_data.answer_buffer) {
-        free(stream_data.answer_buffer);
+
+    /* 调试: 显示历史状态 */
+    if (session->cfg->verbose && session->history) {
+        printf("%s[DEBUG] Conversation History: %d rounds%s\n", COLOR_YELLOW,
+               session->history->current_count, COLOR_RESET);
     }
 
-    /* 显示结果（非流式模式需要显示，流式模式已经实时显示了） */
-    if (!cfg->stream_enabled) {
-        printf("\n");
-        if (response->thinking_process) {
-            print_thinking(response->thinking_process);
-        }
+    bool success = session_query(session, user_input, stream_callback, &stream_data, response);
+    streamed = session->cfg->stream_enabled && !response->cached;
 
-        if (response->command) {
-            print_command(response->command);
-        }
-    } else {
-        /* 流式模式：只是显示命令部分的标题 */
-        if (response->command) {
-            printf("\n\n");
-            print_command(response->command);
-        }
+    /* 时间线在询问是否执行之前输出，不包含等待用户确认的时间 */
+    if (timings) {
+        print_timings(response, session->cfg, streamed, main_start);
     }
 
-    if (response->command) {
-        /* 询问是否执行 */
+    if (!success) {
         printf("\n");
-        if (ask_confirmation("Do you want to execute this command?")) {
-            printf("\n");
-            printf("%s[>] Executing command...%s\n\n", COLOR_GREEN, COLOR_RESET);
-            int ret = system(response->command);
-            printf("\n");
-            if (ret == 0) {
-                print_success("Command executed successfully");
-            } else {
-                printf("%s[!] Command exited with code: %d%s\n",
-                       COLOR_YELLOW, ret, COLOR_RESET);
-            }
+        if (response->error_message) {
+            print_error(response->error_message);
         } else {
-            print_info("Command execution cancelled");
+            print_error("Failed to get response from API");
         }
+        rc = 1;
     } else {
-        print_error("Failed to extract command from response");
-        if (cfg->verbose && response->raw_response) {
-            printf("\nRaw response:\n%s\n", response->raw_response);
-        }
-        api_response_destroy(response);
-        free(user_input);
-        system_info_destroy(sys_info);
-        if (history) history_destroy(history);
-        config_destroy(cfg);
-        return 1;
+        rc = handle_response(response, streamed, stream_data.command_shown,
+                             session->cfg->verbose);
     }
 
     /* 清理 */
     api_response_destroy(response);
     free(user_input);
-    system_info_destroy(sys_info);
-    if (history) history_destroy(history);
-    config_destroy(cfg);
+    session_destroy(session);
 
-    return 0;
+    return rc;
 }
@@ -0,0 +1,325 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Prompt Prefix Cache Implementation
+ *===========================================================================*/
+
+#include "prefix.h"
+#include "hash.h"
+#include "file_lock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <io.h>
+    #define open_cross(path, flags) _open(path, (flags) | _O_BINARY, _S_IREAD | _S_IWRITE)
+    #define close_cross(fd) _close(fd)
+    #define fdopen_cross(fd, mode) _fdopen(fd, mode)
+    #define fileno_cross(fp) _fileno(fp)
+#else
+    #include <unistd.h>
+    #define open_cross(path, flags) open(path, flags, 0600)
+    #define close_cross(fd) close(fd)
+    #define fdopen_cross(fd, mode) fdopen(fd, mode)
+    #define fileno_cross(fp) fileno(fp)
+#endif
+
+/* 缓存文件头：魔数、系统消息哈希、历史哈希、轮数、消息长度（定长，便于原地更新） */
+#define PREFIX_MAGIC "GLMPFX1"
+#define PREFIX_HEADER_LEN 68
+#define PREFIX_HEADER_FMT "%s %016llx %016llx %08x %016llx\n"
+
+/* 一轮对话计入链式哈希（包含各自结尾的 '\0'） */
+static uint64_t hash_round(uint64_t hash, const ConversationHistory *history, int i) {
+    const ConversationRound *round = history_round(history, i);
+    hash = hash_fnv1a(hash, history->text + round->user_offset, round->user_len + 1);
+    return hash_fnv1a(hash, history->text + round->assistant_offset, round->assistant_len + 1);
+}
+
+static uint64_t hash_system(const char *sys_context, const char *base_prompt, size_t base_len) {
+    uint64_t hash = hash_fnv1a_str(HASH_FNV_OFFSET, sys_context);
+    return hash_fnv1a(hash, base_prompt, base_len);
+}
+
+/* 追加一条 {"role": ..., "content": ...} 消息 */
+static void write_message(JsonWriter *writer, const char *role, const char *content, size_t len) {
+    json_writer_begin_object(writer);
+    json_writer_key(writer, "role");
+    json_writer_string(writer, role);
+    json_writer_key(writer, "content");
+    json_writer_string_n(writer, content, len);
+    json_writer_end_object(writer);
+}
+
+void prompt_prefix_write_system(JsonWriter *writer, const char *sys_context,
+                                const char *base_prompt, size_t base_len) {
+    /* 系统上下文与基础提示词直接写入同一个字符串 */
+    json_writer_begin_object(writer);
+    json_writer_key(writer, "role");
+    json_writer_string(writer, "system");
+    json_writer_key(writer, "content");
+    json_writer_string_begin(writer);
+    if (sys_context) {
+        json_writer_string_append(writer, sys_context, strlen(sys_context));
+        json_writer_string_append(writer, "\n", 1);
+    }
+    json_writer_string_append(writer, base_prompt, base_len);
+    json_writer_string_end(writer);
+    json_writer_end_object(writer);
+}
+
+void prompt_prefix_write_round(JsonWriter *writer, const ConversationHistory *history, int i) {
+    const ConversationRound *round = history_round(history, i);
+    write_message(writer, "user", history->text + round->user_offset, round->user_len);
+    write_message(writer, "assistant", history->text + round->assistant_offset,
+                  round->assistant_len);
+}
+
+PromptPrefix* prompt_prefix_create(const char *config_dir) {
+    if (!config_dir) return NULL;
+
+    PromptPrefix *prefix = (PromptPrefix *)calloc(1, sizeof(PromptPrefix));
+    if (!prefix) {
+        fprintf(stderr, "Error: Failed to allocate memory for prompt prefix\n");
+        return NULL;
+    }
+
+    size_t path_len = strlen(config_dir) + 32;
+    prefix->cache_file = (char *)malloc(path_len);
+    if (!prefix->cache_file) {
+        free(prefix);
+        return NULL;
+    }
+    snprintf(prefix->cache_file, path_len, "%s/prefix.cache", config_dir);
+
+    /* 前缀跨请求存在，不使用请求级 arena */
+    json_writer_init(&prefix->writer, NULL, 0);
+    return prefix;
+}
+
+void prompt_prefix_destroy(PromptPrefix *prefix) {
+    if (!prefix) return;
+
+    json_writer_free(&prefix->writer);
+    free(prefix->cache_file);
+    free(prefix);
+}
+
+/* 清空内存中的前缀，重新打开 messages 数组 */
+static void restart(PromptPrefix *prefix) {
+    json_writer_free(&prefix->writer);
+    json_writer_init(&prefix->writer, NULL, 0);
+    json_writer_begin_array(&prefix->writer);
+    prefix->system_hash = 0;
+    prefix->rounds_hash = HASH_FNV_OFFSET;
+    prefix->round_count = 0;
+}
+
+/* 从文件开头读取并解析头部 */
+static bool read_header(FILE *fp, uint64_t *system_hash, uint64_t *rounds_hash,
+                        unsigned int *rounds, size_t *len) {
+    char header[PREFIX_HEADER_LEN + 1];
+    char magic[16];
+    unsigned long long sys, hist, data_len;
+
+    if (fseek(fp, 0, SEEK_SET) != 0 ||
+        fread(header, 1, PREFIX_HEADER_LEN, fp) != PREFIX_HEADER_LEN) {
+        return false;
+    }
+    header[PREFIX_HEADER_LEN] = '\0';
+
+    if (sscanf(header, "%15s %llx %llx %x %llx", magic, &sys, &hist, rounds, &data_len) != 5 ||
+        strcmp(magic, PREFIX_MAGIC) != 0 || data_len < 2) {
+        return false;
+    }
+
+    *system_hash = sys;
+    *rounds_hash = hist;
+    *len = (size_t)data_len;
+    return true;
+}
+
+/* 读取缓存文件；格式不对或内容不完整时保持为空 */
+static void load_cache(PromptPrefix *prefix) {
+    FILE *fp = fopen(prefix->cache_file, "rb");
+    if (!fp) return;
+
+    /* 共享锁：其他进程不会在读取期间改写头部或内容 */
+    bool locked = file_lock(fileno_cross(fp), false);
+
+    uint64_t system_hash, rounds_hash;
+    unsigned int rounds;
+    size_t len;
+    char *data = NULL;
+    bool ok = read_header(fp, &system_hash, &rounds_hash, &rounds, &len) &&
+              (data = (char *)malloc(len)) != NULL &&
+              /* 文件可能比头部记录的更长（追加后未来得及更新头部），只使用记录的部分 */
+              fread(data, 1, len, fp) == len &&
+              data[0] == '{' && data[len - 1] == '}';
+
+    if (locked) file_unlock(fileno_cross(fp));
+    fclose(fp);
+
+    if (ok) {
+        restart(prefix);
+        json_writer_raw(&prefix->writer, data, len);
+        prefix->system_hash = system_hash;
+        prefix->rounds_hash = rounds_hash;
+        prefix->round_count = (int)rounds;
+        prefix->saved_len = len;
+        prefix->saved_system_hash = system_hash;
+        prefix->saved_rounds_hash = rounds_hash;
+    }
+    free(data);
+}
+
+bool prompt_prefix_sync(PromptPrefix *prefix, const char *sys_context,
+                        const char *base_prompt, size_t base_len,
+                        const ConversationHistory *history) {
+    if (!prefix || !base_prompt) return false;
+
+    if (!prefix->loaded) {
+        prefix->loaded = true;
+        load_cache(prefix);
+    }
+
+    int count = history ? history->current_count : 0;
+    uint64_t system_hash = hash_system(sys_context, base_prompt, base_len);
+
+    bool valid = prefix->writer.len > 0 && !prefix->writer.failed &&
+                 prefix->system_hash == system_hash && prefix->round_count <= count;
+
+    /* 从文件读取的前缀需要确认对应的仍是当前历史的开头部分 */
+    if (valid && !prefix->verified) {
+        uint64_t hash = HASH_FNV_OFFSET;
+        for (int i = 0; i < prefix->round_count; i++) {
+            hash = hash_round(hash, history, i);
+        }
+        valid = hash == prefix->rounds_hash;
+    }
+
+    if (!valid) {
+        restart(prefix);
+        prompt_prefix_write_system(&prefix->writer, sys_context, base_prompt, base_len);
+        prefix->system_hash = system_hash;
+        prefix->rewrite = true;
+    }
+    prefix->verified = true;
+    prefix->reused_rounds = prefix->round_count;
+
+    /* 只序列化新增的轮次 */
+    for (int i = prefix->round_count; i < count; i++) {
+        prompt_prefix_write_round(&prefix->writer, history, i);
+        prefix->rounds_hash = hash_round(prefix->rounds_hash, history, i);
+    }
+    prefix->round_count = count;
+
+    return !prefix->writer.failed;
+}
+
+const char* prompt_prefix_messages(const PromptPrefix *prefix, size_t *len) {
+    if (!prefix || prefix->writer.len < 2 || prefix->writer.failed) {
+        if (len) *len = 0;
+        return NULL;
+    }
+
+    /* 跳过开头的 '[' */
+    if (len) *len = prefix->writer.len - 1;
+    return prefix->writer.buf + 1;
+}
+
+static bool write_header(FILE *fp, const PromptPrefix *prefix, size_t len) {
+    char header[PREFIX_HEADER_LEN + 1];
+    int n = snprintf(header, sizeof(header), PREFIX_HEADER_FMT, PREFIX_MAGIC,
+                     (unsigned long long)prefix->system_hash,
+                     (unsigned long long)prefix->rounds_hash,
+                     (unsigned int)prefix->round_count, (unsigned long long)len);
+    return n == PREFIX_HEADER_LEN && fwrite(header, 1, PREFIX_HEADER_LEN, fp) == PREFIX_HEADER_LEN;
+}
+
+bool prompt_prefix_save(PromptPrefix *prefix) {
+    if (!prefix || !prefix->cache_file) return false;
+
+    size_t len;
+    const char *data = prompt_prefix_messages(prefix, &len);
+
+    if (!data) {
+        /* 前缀已被丢弃：删除过期的缓存文件，下次运行时重建 */
+        if (prefix->rewrite || prefix->saved_len > 0) remove(prefix->cache_file);
+        prefix->saved_len = 0;
+        prefix->rewrite = false;
+        return true;
+    }
+
+    if (!prefix->rewrite && len == prefix->saved_len) return true;
+
+    /* 打开时不截断：其他进程可能持有锁正在写入 */
+    int fd = open_cross(prefix->cache_file, O_RDWR | O_CREAT);
+    FILE *fp = fd >= 0 ? fdopen_cross(fd, "r+b") : NULL;
+    if (!fp) {
+        if (fd >= 0) close_cross(fd);
+        return false;
+    }
+
+    /* 排他锁在 fclose 时随描述符释放 */
+    file_lock(fd, true);
+
+    /* 只有文件仍是上次保存的内容时才能追加；其他进程写过之后整体重写 */
+    bool append = !prefix->rewrite && prefix->saved_len > 0 && len > prefix->saved_len;
+    if (append) {
+        uint64_t system_hash, rounds_hash;
+        unsigned int rounds;
+        size_t saved_len;
+        append = read_header(fp, &system_hash, &rounds_hash, &rounds, &saved_len) &&
+                 saved_len == prefix->saved_len &&
+                 system_hash == prefix->saved_system_hash &&
+                 rounds_hash == prefix->saved_rounds_hash;
+    }
+
+    bool ok;
+    if (append) {
+        /* 先追加新增的消息，再更新头部：中途失败时旧的头部仍然描述有效的内容 */
+        ok = fseek(fp, PREFIX_HEADER_LEN + (long)prefix->saved_len, SEEK_SET) == 0 &&
+             fwrite(data + prefix->saved_len, 1, len - prefix->saved_len, fp) ==
+                 len - prefix->saved_len &&
+             fflush(fp) == 0 &&
+             fseek(fp, 0, SEEK_SET) == 0 &&
+             write_header(fp, prefix, len);
+    } else {
+        /* 原来更长的文件不截断：头部记录的长度之后的内容会被忽略 */
+        ok = fseek(fp, 0, SEEK_SET) == 0 &&
+             write_header(fp, prefix, len) && fwrite(data, 1, len, fp) == len;
+    }
+
+    if (fclose(fp) != 0) ok = false;
+
+    if (ok) {
+        prefix->saved_len = len;
+        prefix->saved_system_hash = prefix->system_hash;
+        prefix->saved_rounds_hash = prefix->rounds_hash;
+        prefix->rewrite = false;
+    }
+    return ok;
+}
+
+void prompt_prefix_reset(PromptPrefix *prefix, bool remove_file) {
+    if (!prefix) return;
+
+    json_writer_free(&prefix->writer);
+    json_writer_init(&prefix->writer, NULL, 0);
+    prefix->system_hash = 0;
+    prefix->rounds_hash = HASH_FNV_OFFSET;
+    prefix->round_count = 0;
+    prefix->reused_rounds = 0;
+    prefix->loaded = true;      /* 文件中的内容同样已经过期 */
+    prefix->verified = true;
+    prefix->rewrite = true;
+
+    if (remove_file && prefix->cache_file) {
+        remove(prefix->cache_file);
+        prefix->saved_len = 0;
+        prefix->rewrite = false;
+    }
+}
@@ -0,0 +1,60 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Prompt Prefix Cache Header
+ *===========================================================================*/
+
+#ifndef PREFIX_H
+#define PREFIX_H
+
+#include "history.h"
+#include "json_writer.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* 请求前缀缓存
+ * messages 数组开头的系统消息和历史消息在连续的查询之间保持不变，
+ * 只会在末尾追加新的轮次。这里保存它们序列化后的 JSON 文本并持久化到
+ * <config_dir>/prefix.cache：下次运行只需校验哈希、追加新增的轮次，
+ * 不必重新转义整个历史；前缀字节保持完全一致，也便于命中提供方的前缀缓存。
+ */
+typedef struct PromptPrefix {
+    char *cache_file;           /* 缓存文件路径 */
+    JsonWriter writer;          /* "[" + 已序列化的消息（数组保持打开，便于继续追加） */
+    uint64_t system_hash;       /* 系统消息内容的哈希 */
+    uint64_t rounds_hash;       /* rounds[0, round_count) 的链式哈希 */
+    int round_count;            /* 已序列化的历史轮数 */
+    int reused_rounds;          /* 最近一次同步时直接复用的轮数 */
+
+    bool loaded;                /* 已尝试读取缓存文件 */
+    bool verified;              /* 已确认与当前历史一致（之后历史只会追加） */
+    bool rewrite;               /* 缓存文件需要整体重写 */
+    size_t saved_len;           /* 缓存文件中已有的消息长度 */
+    uint64_t saved_system_hash; /* 缓存文件头部的哈希（追加前确认文件没有被其他进程改写） */
+    uint64_t saved_rounds_hash;
+} PromptPrefix;
+
+/* 函数声明 */
+PromptPrefix* prompt_prefix_create(const char *config_dir);
+void prompt_prefix_destroy(PromptPrefix *prefix);
+
+/* 与当前系统消息和历史同步：前缀仍然有效时只序列化新增的轮次，否则整体重建 */
+bool prompt_prefix_sync(PromptPrefix *prefix, const char *sys_context,
+                        const char *base_prompt, size_t base_len,
+                        const ConversationHistory *history);
+
+/* 序列化的消息前缀（以逗号分隔的数组元素，不含方括号） */
+const char* prompt_prefix_messages(const PromptPrefix *prefix, size_t *len);
+
+/* 写入缓存文件：只追加上次保存之后新增的部分 */
+bool prompt_prefix_save(PromptPrefix *prefix);
+
+/* 丢弃前缀（历史被截断或清空时）；remove_file 为 true 时同时删除缓存文件 */
+void prompt_prefix_reset(PromptPrefix *prefix, bool remove_file);
+
+/* 消息序列化（不使用缓存时 build_request_body 直接写入请求体） */
+void prompt_prefix_write_system(JsonWriter *writer, const char *sys_context,
+                                const char *base_prompt, size_t base_len);
+void prompt_prefix_write_round(JsonWriter *writer, const ConversationHistory *history, int i);
+
+#endif /* PREFIX_H */
@@ -0,0 +1,33 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * USDT Probes
+ *===========================================================================*/
+
+#ifndef PROBES_H
+#define PROBES_H
+
+/* 请求生命周期上的静态跟踪点（make USDT=1 时编译进程序，供 perf/bpftrace 使用）
+ * provider 为 glm_cmd，探针及参数：
+ *   request_build_start                      开始构建请求体
+ *   request_build_done(len)                  请求体构建完成，len 为 JSON 字节数
+ *   request_perform_start(stream)            开始传输（stream: 1 流式 / 0 非流式 / 2 批量）
+ *   request_perform_done(result)             传输结束，result 为 CURLcode
+ *   sse_event(len, type)                     解码一个 SSE 事件，len 为 data 字节数，
+ *                                            type 为 StreamContentType（无文本内容时为 -1）
+ *   command_extracted(command)               从回答中提取出命令
+ *   history_saved(rounds, append)            历史已写入（append: 1 追加一轮 / 0 整体重写）
+ *   command_executed(command, status)        执行命令，status 为 system() 返回值
+ * 未启用时宏展开为空语句，参数不会被求值。
+ */
+#ifdef USDT
+    #include <sys/sdt.h>
+    #define TRACE_PROBE(name) DTRACE_PROBE(glm_cmd, name)
+    #define TRACE_PROBE1(name, a) DTRACE_PROBE1(glm_cmd, name, a)
+    #define TRACE_PROBE2(name, a, b) DTRACE_PROBE2(glm_cmd, name, a, b)
+#else
+    #define TRACE_PROBE(name) do { } while (0)
+    #define TRACE_PROBE1(name, a) do { } while (0)
+    #define TRACE_PROBE2(name, a, b) do { } while (0)
+#endif
+
+#endif /* PROBES_H */
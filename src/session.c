@@ -0,0 +1,427 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Query Session Implementation
+ *===========================================================================*/
+
+#include "session.h"
+#include "config_parser.h"
+#include "timing.h"
+#include "cassette.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <shlobj.h>
+#else
+    #include <unistd.h>
+    #include <pwd.h>
+    #include <fcntl.h>
+    #include <sys/wait.h>
+#endif
+
+/* 流式输出收集结构：缓存思考过程和回答，并转发给调用者的回调 */
+typedef struct {
+    char *reasoning_buffer;      /* 思考过程缓冲区 */
+    size_t reasoning_size;       /* 思考过程缓冲区大小 */
+    size_t reasoning_pos;        /* 思考过程当前位置 */
+
+    char *answer_buffer;         /* 最终回答缓冲区 */
+    size_t answer_size;          /* 最终回答缓冲区大小 */
+    size_t answer_pos;           /* 最终回答当前位置 */
+
+    Arena *arena;                /* 缓冲区所在的内存池（本次响应的 arena） */
+    StreamCallback callback;     /* 调用者的回调（显示或转发） */
+    void *userdata;
+} SessionStream;
+
+/* 辅助函数：追加内容到缓冲区 */
+static void append_to_buffer(Arena *arena, char **buffer, size_t *buffer_size,
+                            size_t *buffer_pos, const char *content) {
+    size_t content_len = strlen(content);
+
+    /* 扩展缓冲区（如果需要） */
+    if (*buffer_pos + content_len + 1 > *buffer_size) {
+        size_t new_size = *buffer_size ? *buffer_size : 4096;
+        while (*buffer_pos + content_len + 1 > new_size) {
+            new_size *= 2;
+        }
+
+        char *new_buffer = (char *)arena_resize(arena, *buffer, *buffer_size, new_size);
+        if (!new_buffer) {
+            fprintf(stderr, "Error: Failed to grow buffer\n");
+            return;
+        }
+        *buffer = new_buffer;
+        *buffer_size = new_size;
+    }
+
+    /* 追加内容到缓冲区（记录位置，不需要 strcat 重新扫描） */
+    memcpy(*buffer + *buffer_pos, content, content_len);
+    *buffer_pos += content_len;
+    (*buffer)[*buffer_pos] = '\0';
+}
+
+/* 收集回调：先缓存内容，再交给调用者显示 */
+static void collect_callback(const char *content, StreamContentType content_type, void *userdata) {
+    SessionStream *stream = (SessionStream *)userdata;
+
+    if (content_type == STREAM_CONTENT_REASONING) {
+        append_to_buffer(stream->arena, &stream->reasoning_buffer, &stream->reasoning_size,
+                        &stream->reasoning_pos, content);
+    } else if (content_type == STREAM_CONTENT_ANSWER) {
+        append_to_buffer(stream->arena, &stream->answer_buffer, &stream->answer_size,
+                        &stream->answer_pos, content);
+    }
+
+    if (stream->callback) {
+        stream->callback(content, content_type, stream->userdata);
+    }
+}
+
+bool session_get_config_dir(char *path, size_t path_size) {
+    const char *home = NULL;
+
+#ifdef _WIN32
+    char home_dir[MAX_PATH];
+    if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_PROFILE, NULL, 0, home_dir))) {
+        home = home_dir;
+    }
+#else
+    home = getenv("HOME");
+    if (!home) {
+        struct passwd *pw = getpwuid(getuid());
+        if (pw) home = pw->pw_dir;
+    }
+#endif
+
+    if (!home) return false;
+
+    snprintf(path, path_size, "%s/.glm-cmd", home);
+    return true;
+}
+
+/* 读取文件状态，文件不存在时返回全 0 */
+static FileStamp file_stamp(const char *path) {
+    FileStamp stamp = {0, 0, 0};
+    struct stat st;
+    if (path && path[0] != '\0' && stat(path, &st) == 0) {
+        stamp.id = (long long)st.st_ino;
+        stamp.size = (long long)st.st_size;
+        stamp.mtime = (long long)st.st_mtime;
+    }
+    return stamp;
+}
+
+/* 当前生效的配置文件及其状态 */
+static FileStamp find_config_file(char *path, size_t path_size) {
+    if (!config_file_find_path(path, path_size)) path[0] = '\0';
+    return file_stamp(path);
+}
+
+Session* session_create(bool verbose) {
+    Session *session = (Session *)calloc(1, sizeof(Session));
+    if (!session) {
+        fprintf(stderr, "Error: Failed to allocate memory for session\n");
+        return NULL;
+    }
+
+    /* 创建配置 */
+    uint64_t start = startup_phase_begin();
+    session->cfg = config_create();
+    if (!session->cfg) {
+        fprintf(stderr, "Error: Failed to create configuration\n");
+        session_destroy(session);
+        return NULL;
+    }
+
+    /* 加载配置（优先级：配置文件 > 环境变量 > 默认值） */
+    session->config_stamp = find_config_file(session->config_file, sizeof(session->config_file));
+    if (!config_load(session->cfg) ||
+        (!cassette_replaying() && !config_validate(session->cfg))) {
+        session_destroy(session);
+        return NULL;
+    }
+    startup_phase_end(STARTUP_CONFIG, start);
+
+    if (verbose) {
+        session->cfg->verbose = true;
+    }
+
+    bool has_dir = session_get_config_dir(session->config_dir, sizeof(session->config_dir));
+
+    /* 检测系统信息（优先使用 ~/.glm-cmd/system_info.cache 中的快照） */
+    start = startup_phase_begin();
+    session->sys_info = system_info_create();
+    if (!session->sys_info) {
+        fprintf(stderr, "Error: Failed to create system info\n");
+        session_destroy(session);
+        return NULL;
+    }
+
+    char snapshot_file[sizeof(session->config_dir) + 32];
+    snprintf(snapshot_file, sizeof(snapshot_file), "%s/system_info.cache", session->config_dir);
+    if (!system_info_detect_cached(session->sys_info, has_dir ? snapshot_file : NULL)) {
+        fprintf(stderr, "Warning: Failed to detect some system information\n");
+    }
+    startup_phase_end(STARTUP_SYSTEM, start);
+
+    /* 创建对话历史管理器（如果启用） */
+    if (session->cfg->memory_enabled && has_dir) {
+        start = startup_phase_begin();
+        session->history = history_create(session->config_dir, session->cfg->memory_rounds);
+        if (session->history) {
+            history_load(session->history);
+            history_enable_prefix_cache(session->history, session->config_dir);
+        } else {
+            fprintf(stderr, "Warning: Failed to create conversation history\n");
+        }
+        startup_phase_end(STARTUP_HISTORY, start);
+    }
+
+    /* 本地响应缓存（可在查询前通过 cfg->cache_enabled 临时关闭） */
+    if (session->cfg->cache_enabled && has_dir) {
+        session->cache = response_cache_create(session->config_dir, session->cfg->cache_ttl,
+                                               session->cfg->cache_max_entries);
+    }
+
+    return session;
+}
+
+bool session_refresh(Session *session) {
+    if (!session) return false;
+
+    char path[sizeof(session->config_file)];
+    FileStamp stamp = find_config_file(path, sizeof(path));
+    if (strcmp(path, session->config_file) != 0 ||
+        memcmp(&stamp, &session->config_stamp, sizeof(stamp)) != 0) {
+        return false;
+    }
+
+    if (session->history && history_changed(session->history)) {
+        history_reload(session->history);
+    }
+    return true;
+}
+
+void session_destroy(Session *session) {
+    if (!session) return;
+
+    if (session->client) client_destroy(session->client);
+    if (session->cache) response_cache_destroy(session->cache);
+    if (session->history) history_destroy(session->history);
+    if (session->sys_info) system_info_destroy(session->sys_info);
+    if (session->cfg) config_destroy(session->cfg);
+
+    free(session);
+}
+
+/* 构建完整的响应文本（包含思考过程和命令）并保存到历史 */
+static void save_round(Session *session, const SessionStream *stream,
+                       const char *user_input, const ApiResponse *response) {
+    const Config *cfg = session->cfg;
+    Arena *arena = response->arena;
+    char *full_response = NULL;
+
+    if (cfg->stream_enabled && (stream->reasoning_buffer || stream->answer_buffer)) {
+        /* 流式模式：组合思考过程和回答 */
+        size_t total_len = 1;  /* 至少包含 null 终止符 */
+        if (stream->reasoning_buffer) {
+            total_len += stream->reasoning_pos + 20;  /* +20 for labels */
+        }
+        if (stream->answer_buffer) {
+            total_len += stream->answer_pos + 20;
+        }
+
+        full_response = (char *)arena_alloc(arena, total_len);
+        if (full_response) {
+            size_t pos = 0;
+            if (stream->reasoning_buffer) {
+                pos += (size_t)snprintf(full_response + pos, total_len - pos,
+                                        "Thinking: %s", stream->reasoning_buffer);
+            }
+            if (stream->answer_buffer) {
+                snprintf(full_response + pos, total_len - pos, "%sAnswer: %s",
+                         stream->reasoning_buffer ? "\n\n" : "", stream->answer_buffer);
+            }
+        }
+    } else if (response->thinking_process && strlen(response->thinking_process) > 0) {
+        /* 非流式模式：使用 response 中的内容 */
+        size_t len = strlen(response->thinking_process) + strlen(response->command) + 20;
+        full_response = (char *)arena_alloc(arena, len);
+        if (full_response) {
+            snprintf(full_response, len, "%s\n\nCommand: %s",
+                    response->thinking_process, response->command);
+        }
+    } else {
+        full_response = response->command;
+    }
+
+    if (full_response) {
+        history_add_round(session->history, user_input, full_response);
+        history_append(session->history, arena);
+    }
+}
+
+/* 相似匹配命中后在后台重新请求，把新措辞的回答写入缓存
+ * 两次 fork：中间进程立即退出，刷新进程由 init 接管，不会留下僵尸进程
+ */
+static void refresh_in_background(Session *session, const char *user_input, uint64_t key,
+                                  uint64_t context, const char *normalized) {
+#ifdef _WIN32
+    (void)session;
+    (void)user_input;
+    (void)key;
+    (void)context;
+    (void)normalized;
+#else
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) return;
+    if (pid == 0) {
+        if (fork() == 0) {
+            /* 不再向终端（或守护进程的客户端）输出 */
+            int null_fd = open("/dev/null", O_RDWR);
+            if (null_fd >= 0) {
+                dup2(null_fd, STDIN_FILENO);
+                dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+                close(null_fd);
+            }
+
+            /* 使用新的客户端，不与父进程共享连接 */
+            GlmClient *client = client_create();
+            ApiResponse *response = api_response_create();
+            if (client && response &&
+                api_send_request(client, session->cfg, session->sys_info, session->history,
+                                 user_input, response) &&
+                response->success && response->command) {
+                response_cache_store(session->cache, key, context, normalized,
+                                     response->command, response->thinking_process);
+            }
+            _exit(0);
+        }
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+#endif
+}
+
+bool session_query(Session *session, const char *user_input,
+                   StreamCallback callback, void *userdata,
+                   ApiResponse *response) {
+    if (!session || !user_input || !response) return false;
+
+    const Config *cfg = session->cfg;
+
+    /* 响应缓存：相同的输入、模型、user_prompt 和系统上下文直接返回之前的结果；
+     * 设置了 cache_similarity 时，相同上下文中措辞相近的查询也可以命中。
+     * 请求携带对话历史时回答依赖之前的轮次（"再来一次"、"改成按日期排序"），
+     * 此时既不查找也不写入缓存
+     */
+    bool with_history = session->history && session->history->current_count > 0;
+    ResponseCache *cache = cfg->cache_enabled && !with_history ? session->cache : NULL;
+    char *normalized = NULL;
+    uint64_t cache_key = 0;
+    uint64_t cache_context = 0;
+    if (cache) {
+        const char *sys_context = system_info_prompt(session->sys_info);
+        normalized = response_cache_normalize(response->arena, user_input);
+        cache_key = response_cache_key(normalized, cfg, sys_context);
+        cache_context = response_cache_context(cfg, sys_context);
+    }
+
+    ResponseCacheEntry entry;
+    bool hit = false;
+    if (cache && normalized && !cfg->cache_refresh) {
+        hit = response_cache_lookup(cache, cache_key, normalized, response->arena, &entry) ||
+              (cfg->cache_similarity > 0 &&
+               response_cache_lookup_similar(cache, cache_context, normalized,
+                                             cfg->cache_similarity, response->arena, &entry));
+    }
+
+    if (hit) {
+        response->command = entry.command;
+        response->thinking_process = entry.thinking;
+        response->success = true;
+        response->cached = true;
+        response->cached_query = entry.query;
+        response->cache_similarity = entry.similarity;
+
+        if (cfg->verbose && entry.query) {
+            printf("[DEBUG] Similar cache hit: similarity=%.2f, query=\"%s\", age=%llds\n",
+                   entry.similarity, entry.query, (long long)time(NULL) - entry.created);
+        } else if (cfg->verbose) {
+            printf("[DEBUG] Response cache hit: key=%016llx, age=%llds\n",
+                   (unsigned long long)cache_key, (long long)time(NULL) - entry.created);
+        }
+
+        /* 在记入历史之前刷新：后台请求携带的历史中不能已经包含本次问答 */
+        if (entry.query && cfg->cache_background_refresh) {
+            refresh_in_background(session, user_input, cache_key, cache_context, normalized);
+        }
+
+        /* 缓存的结果同样计入对话历史 */
+        if (session->history) {
+            SessionStream empty = {0};
+            save_round(session, &empty, user_input, response);
+        }
+        return true;
+    }
+
+    /* 长生命周期客户端：首次需要请求时创建，之后复用连接、DNS 与 TLS 会话
+     * （放在缓存查找之后，命中时不初始化 curl）
+     */
+    if (!session->client) {
+        session->client = client_create();
+    }
+
+    SessionStream stream = {0};
+    stream.arena = response->arena;
+    stream.callback = callback;
+    stream.userdata = userdata;
+
+    bool success;
+
+    /* 根据配置选择使用流式或非流式 API */
+    if (cfg->stream_enabled) {
+        success = api_send_request_stream(session->client, cfg, session->sys_info,
+                                          session->history, user_input,
+                                          collect_callback, &stream, response);
+    } else {
+        success = api_send_request(session->client, cfg, session->sys_info,
+                                   session->history, user_input, response);
+    }
+
+    /* 命令已在接收回答时由增量提取器识别 */
+    if (success && cfg->verbose) {
+        if (response->command) {
+            printf("[DEBUG] Successfully extracted command: %s\n", response->command);
+        } else {
+            printf("[DEBUG] No command code block found in answer\n");
+        }
+        /* cached_tokens 为提供方前缀缓存命中的输入 token 数 */
+        printf("[DEBUG] Usage: prompt=%d (cached=%d) completion=%d total=%d\n",
+               response->prompt_tokens, response->cached_tokens,
+               response->completion_tokens, response->total_tokens);
+    }
+
+    /* 保存对话到历史（如果启用） */
+    if (success && session->history && response->success && response->command) {
+        save_round(session, &stream, user_input, response);
+    }
+
+    /* 保存到响应缓存（流式模式下思考过程在收集缓冲区中） */
+    if (success && cache && normalized && response->success && response->command) {
+        const char *thinking = cfg->stream_enabled ? stream.reasoning_buffer
+                                                   : response->thinking_process;
+        response_cache_store(cache, cache_key, cache_context, normalized, response->command,
+                             thinking);
+    }
+
+    /* 流式缓冲区随 response->arena 一起释放 */
+
+    return success;
+}
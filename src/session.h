@@ -0,0 +1,62 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Query Session Header
+ *===========================================================================*/
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "config.h"
+#include "system_info.h"
+#include "history.h"
+#include "client.h"
+#include "api.h"
+#include "cache.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* 文件的 inode、大小和修改时间（文件不存在时全为 0） */
+typedef struct {
+    long long id;
+    long long size;
+    long long mtime;
+} FileStamp;
+
+/* 会话：一次加载、可多次查询的运行时状态
+ * 单次命令行调用只执行一次查询；守护进程则常驻持有会话，
+ * 让配置、系统信息、对话历史和已建立的连接在查询之间复用。
+ */
+typedef struct {
+    Config *cfg;
+    SystemInfo *sys_info;
+    ConversationHistory *history;  /* 未启用对话记忆时为 NULL */
+    GlmClient *client;             /* 首次查询时创建 */
+    ResponseCache *cache;          /* 未启用响应缓存时为 NULL */
+    char config_dir[512];          /* ~/.glm-cmd */
+    char config_file[512];         /* 加载时使用的配置文件（没有配置文件时为空） */
+    FileStamp config_stamp;        /* 加载时配置文件的状态 */
+} Session;
+
+/* 函数声明 */
+Session* session_create(bool verbose);
+void session_destroy(Session *session);
+
+/* 使常驻会话与磁盘保持一致（守护进程在每次查询前调用）：
+ * 对话历史日志被其他进程修改（追加、压缩、--clear-history）时重新加载历史；
+ * 配置文件变化时返回 false，调用者应销毁会话并重新创建
+ */
+bool session_refresh(Session *session);
+
+/* 获取配置目录路径（~/.glm-cmd） */
+bool session_get_config_dir(char *path, size_t path_size);
+
+/* 执行一次查询：发送请求、提取命令并保存对话历史
+ * 流式模式下 callback 会实时收到思考过程和回答片段；
+ * 命中响应缓存时不发送请求、不调用 callback，response->cached 为 true
+ * （相似匹配命中时 response->cached_query 为匹配到的原查询）
+ */
+bool session_query(Session *session, const char *user_input,
+                   StreamCallback callback, void *userdata,
+                   ApiResponse *response);
+
+#endif /* SESSION_H */
@@ -0,0 +1,224 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Server-Sent Events Parser Implementation
+ *===========================================================================*/
+
+#include "sse.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 辅助函数：追加内容到可增长缓冲区（保持 '\0' 结尾） */
+static bool buffer_append(Arena *arena, char **buffer, size_t *len, size_t *cap,
+                          const char *content, size_t content_len) {
+    if (*len + content_len + 1 > *cap) {
+        size_t new_cap = *cap ? *cap : 1024;
+        while (*len + content_len + 1 > new_cap) {
+            new_cap *= 2;
+        }
+
+        char *new_buffer = (char *)arena_resize(arena, *buffer, *cap, new_cap);
+        if (!new_buffer) {
+            fprintf(stderr, "Error: Failed to grow SSE buffer\n");
+            return false;
+        }
+        *buffer = new_buffer;
+        *cap = new_cap;
+    }
+
+    memcpy(*buffer + *len, content, content_len);
+    *len += content_len;
+    (*buffer)[*len] = '\0';
+    return true;
+}
+
+/* 复制定长字段到固定大小的字符数组（超长时截断） */
+static void copy_field(char *dest, size_t dest_size, const char *value, size_t value_len) {
+    if (value_len >= dest_size) value_len = dest_size - 1;
+    memcpy(dest, value, value_len);
+    dest[value_len] = '\0';
+}
+
+/* 将零拷贝引用的数据转存到 data_buf（数据块即将失效或需要拼接多行时） */
+static bool detach_data(SseParser *parser) {
+    if (!parser->data_ref) return true;
+
+    const char *ref = parser->data_ref;
+    size_t ref_len = parser->data_ref_len;
+    parser->data_ref = NULL;
+    parser->data_ref_len = 0;
+    parser->data_len = 0;
+
+    return buffer_append(parser->arena, &parser->data_buf, &parser->data_len, &parser->data_cap,
+                         ref, ref_len);
+}
+
+/* 分发当前事件并重置事件状态 */
+static void dispatch_event(SseParser *parser) {
+    if (parser->has_data) {
+        const char *data = parser->data_ref ? parser->data_ref : parser->data_buf;
+        size_t data_len = parser->data_ref ? parser->data_ref_len : parser->data_len;
+
+        /* 按规范，data 为空的事件不分发 */
+        if (data_len > 0 && parser->callback) {
+            parser->callback(parser->event[0] ? parser->event : "message",
+                             data, data_len, parser->userdata);
+        }
+    }
+
+    parser->has_data = false;
+    parser->data_ref = NULL;
+    parser->data_ref_len = 0;
+    parser->data_len = 0;
+    parser->event[0] = '\0';
+}
+
+/* 处理 data: 字段；stable 表示 value 在本次 feed 结束前保持有效 */
+static bool append_data(SseParser *parser, const char *value, size_t value_len, bool stable) {
+    if (!parser->has_data) {
+        parser->has_data = true;
+        if (stable) {
+            parser->data_ref = value;
+            parser->data_ref_len = value_len;
+            return true;
+        }
+        parser->data_len = 0;
+        return buffer_append(parser->arena, &parser->data_buf, &parser->data_len, &parser->data_cap,
+                             value, value_len);
+    }
+
+    /* 多行 data: 以 '\n' 连接 */
+    if (!detach_data(parser)) return false;
+    if (!buffer_append(parser->arena, &parser->data_buf, &parser->data_len, &parser->data_cap, "\n", 1)) {
+        return false;
+    }
+    return buffer_append(parser->arena, &parser->data_buf, &parser->data_len, &parser->data_cap,
+                         value, value_len);
+}
+
+/* 处理一行（不含行尾） */
+static bool process_line(SseParser *parser, const char *line, size_t len, bool stable) {
+    /* 空行：分发事件 */
+    if (len == 0) {
+        dispatch_event(parser);
+        return true;
+    }
+
+    /* 注释行 */
+    if (line[0] == ':') {
+        return true;
+    }
+
+    /* 拆分字段名和值（冒号后的一个空格不属于值） */
+    const char *colon = memchr(line, ':', len);
+    size_t field_len = colon ? (size_t)(colon - line) : len;
+    const char *value = colon ? colon + 1 : line + len;
+    size_t value_len = colon ? len - field_len - 1 : 0;
+
+    if (value_len > 0 && value[0] == ' ') {
+        value++;
+        value_len--;
+    }
+
+    if (field_len == 4 && memcmp(line, "data", 4) == 0) {
+        return append_data(parser, value, value_len, stable);
+    } else if (field_len == 5 && memcmp(line, "event", 5) == 0) {
+        copy_field(parser->event, sizeof(parser->event), value, value_len);
+    } else if (field_len == 2 && memcmp(line, "id", 2) == 0) {
+        /* 包含 NUL 的 id 按规范忽略 */
+        if (!memchr(value, '\0', value_len)) {
+            copy_field(parser->last_id, sizeof(parser->last_id), value, value_len);
+        }
+    }
+    /* retry: 及未知字段忽略 */
+
+    return true;
+}
+
+void sse_parser_init(SseParser *parser, Arena *arena,
+                     SseEventCallback callback, void *userdata) {
+    if (!parser) return;
+
+    memset(parser, 0, sizeof(SseParser));
+    parser->arena = arena;
+    parser->callback = callback;
+    parser->userdata = userdata;
+}
+
+void sse_parser_free(SseParser *parser) {
+    if (!parser) return;
+
+    arena_free(parser->arena, parser->data_buf);
+    arena_free(parser->arena, parser->line_buf);
+    parser->line_buf = NULL;
+    parser->data_buf = NULL;
+    parser->line_len = parser->line_cap = 0;
+    parser->data_len = parser->data_cap = 0;
+    parser->data_ref = NULL;
+}
+
+bool sse_parser_feed(SseParser *parser, const char *data, size_t len) {
+    if (!parser || (!data && len > 0)) return false;
+
+    const char *pos = data;
+    const char *end = data + len;
+
+    /* 上一数据块以 '\r' 结尾：CRLF 被拆分在两个数据块之间 */
+    if (parser->skip_lf && pos < end) {
+        if (*pos == '\n') pos++;
+        parser->skip_lf = false;
+    }
+
+    while (pos < end) {
+        /* 查找行尾：'\n'、'\r' 或 "\r\n" */
+        const char *lf = memchr(pos, '\n', (size_t)(end - pos));
+        const char *cr = memchr(pos, '\r', (size_t)((lf ? lf : end) - pos));
+        const char *eol = cr ? cr : lf;
+
+        if (!eol) {
+            /* 行被截断：仅复制尾部片段 */
+            if (!buffer_append(parser->arena, &parser->line_buf, &parser->line_len, &parser->line_cap,
+                               pos, (size_t)(end - pos))) {
+                return false;
+            }
+            break;
+        }
+
+        bool ok;
+        if (parser->line_len > 0) {
+            /* 拼接上一数据块留下的片段 */
+            ok = buffer_append(parser->arena, &parser->line_buf, &parser->line_len, &parser->line_cap,
+                               pos, (size_t)(eol - pos)) &&
+                 process_line(parser, parser->line_buf, parser->line_len, false);
+            parser->line_len = 0;
+        } else {
+            ok = process_line(parser, pos, (size_t)(eol - pos), true);
+        }
+        if (!ok) return false;
+
+        if (*eol == '\r') {
+            if (eol + 1 < end) {
+                if (eol[1] == '\n') eol++;
+            } else {
+                parser->skip_lf = true;
+            }
+        }
+        pos = eol + 1;
+    }
+
+    /* 数据块即将被 curl 复用：未分发事件的 data 需要转存 */
+    return detach_data(parser);
+}
+
+void sse_parser_finish(SseParser *parser) {
+    if (!parser) return;
+
+    if (parser->line_len > 0) {
+        process_line(parser, parser->line_buf, parser->line_len, false);
+        parser->line_len = 0;
+    }
+
+    /* 容忍服务器省略最后的空行 */
+    dispatch_event(parser);
+    parser->skip_lf = false;
+}
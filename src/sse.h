@@ -0,0 +1,61 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Server-Sent Events Parser Header
+ *===========================================================================*/
+
+#ifndef SSE_H
+#define SSE_H
+
+#include "arena.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* 事件回调函数类型
+ * event: 事件类型（未指定 event: 字段时为 "message"）
+ * data: 事件数据（多行 data: 以 '\n' 连接），不保证以 '\0' 结尾
+ * data_len: 事件数据长度
+ * userdata: 用户自定义数据
+ */
+typedef void (*SseEventCallback)(const char *event, const char *data,
+                                 size_t data_len, void *userdata);
+
+/* 增量 SSE 解析器
+ * 对 curl 交付的数据块用 memchr 查找行尾，完整的行直接在原缓冲区中解析；
+ * 只有跨数据块被截断的行尾片段才会复制到可复用的行缓冲区。
+ * 单行 data: 的事件在同一数据块内结束时，回调收到的 data 直接指向该数据块。
+ */
+typedef struct {
+    Arena *arena;               /* 缓冲区所在的内存池（NULL 时使用 malloc） */
+
+    char *line_buf;             /* 跨数据块的不完整行 */
+    size_t line_len;
+    size_t line_cap;
+
+    char *data_buf;             /* 需要复制时累积的 data 字段 */
+    size_t data_len;
+    size_t data_cap;
+
+    const char *data_ref;       /* 指向当前数据块内的 data 字段（零拷贝） */
+    size_t data_ref_len;
+    bool has_data;              /* 当前事件是否已有 data 字段 */
+
+    char event[64];             /* 当前事件类型 */
+    char last_id[128];          /* 最近一次的事件 ID */
+    bool skip_lf;               /* 上一数据块以 '\r' 结尾，需跳过紧随的 '\n' */
+
+    SseEventCallback callback;
+    void *userdata;
+} SseParser;
+
+/* 函数声明 */
+void sse_parser_init(SseParser *parser, Arena *arena,
+                     SseEventCallback callback, void *userdata);
+void sse_parser_free(SseParser *parser);
+
+/* 输入一个数据块，遇到空行时分发事件 */
+bool sse_parser_feed(SseParser *parser, const char *data, size_t len);
+
+/* 输入结束：处理残留的行并分发未以空行结束的事件 */
+void sse_parser_finish(SseParser *parser);
+
+#endif /* SSE_H */
@@ -4,14 +4,22 @@
  *===========================================================================*/
 
 #include "system_info.h"
+#include "hash.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #ifdef _WIN32
     #include <windows.h>
 #else
     #include <unistd.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <signal.h>
+    #include <sys/stat.h>
+    #include <sys/utsname.h>
+    #include <sys/wait.h>
 #endif
 
 #ifdef __linux__
@@ -22,9 +30,79 @@
 #ifdef __APPLE__
     #include <sys/utsname.h>
     #include <sys/sysctl.h>
+    #include <sys/time.h>
     #include <TargetConditionals.h>
 #endif
 
+/* 检测结果快照（本机字节序）：文件头 + 7 个字符串（4 字节长度 + 内容）
+ * 检测内容或系统上下文的格式变化时修改 SNAPSHOT_MAGIC
+ */
+#define SNAPSHOT_MAGIC "GLMSYS1"
+#define SNAPSHOT_FIELDS 7
+#define SNAPSHOT_NULL UINT32_MAX   /* 字段为 NULL */
+#define SNAPSHOT_MAX_SIZE 8192
+
+typedef struct {
+    char magic[8];
+    uint64_t key;              /* snapshot_key() */
+    uint32_t os_type;
+    uint32_t shell_type;
+} SnapshotHeader;
+
+#ifndef _WIN32
+/* 运行 "$SHELL --version"，取第一行中第一个以数字开头的词：
+ *   GNU bash, version 5.2.15(1)-release  /  zsh 5.9 (x86_64-pc-linux-gnu)  /  fish, version 3.6.0
+ * 最多等待 1 秒
+ */
+static char* probe_shell_version(const char *shell_path) {
+    int fds[2];
+    if (!shell_path || pipe(fds) != 0) return NULL;
+
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return NULL;
+    }
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_RDWR);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDIN_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+        }
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(shell_path, shell_path, "--version", (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    char output[256];
+    size_t len = 0;
+    struct pollfd pfd = { fds[0], POLLIN, 0 };
+    while (len < sizeof(output) - 1 && poll(&pfd, 1, 1000) > 0) {
+        ssize_t n = read(fds[0], output + len, sizeof(output) - 1 - len);
+        if (n <= 0) break;
+        len += (size_t)n;
+    }
+    close(fds[0]);
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    output[len] = '\0';
+
+    char *line_end = strchr(output, '\n');
+    if (line_end) *line_end = '\0';
+    for (char *p = output; *p; p++) {
+        if (*p >= '0' && *p <= '9' && (p == output || p[-1] == ' ')) {
+            return strndup(p, strspn(p, "0123456789."));
+        }
+    }
+    return NULL;
+}
+#endif
+
 SystemInfo* system_info_create(void) {
     SystemInfo *info = (SystemInfo *)calloc(1, sizeof(SystemInfo));
     if (!info) {
@@ -40,6 +118,7 @@ SystemInfo* system_info_create(void) {
     info->shell_version = NULL;
     info->arch = NULL;
     info->hostname = NULL;
+    info->prompt = NULL;
 
     return info;
 }
@@ -53,6 +132,7 @@ void system_info_destroy(SystemInfo *info) {
     if (info->shell_version) free(info->shell_version);
     if (info->arch) free(info->arch);
     if (info->hostname) free(info->hostname);
+    if (info->prompt) free(info->prompt);
 
     free(info);
 }
@@ -172,9 +252,170 @@ bool system_info_detect(SystemInfo *info) {
 #endif
     }
 
+    /* Shell 版本（需要启动一个进程，结果随快照保存） */
+#ifndef _WIN32
+    if (info->shell_type == SHELL_BASH || info->shell_type == SHELL_ZSH ||
+        info->shell_type == SHELL_FISH) {
+        info->shell_version = probe_shell_version(shell_env);
+    }
+#endif
+
+    info->prompt = system_info_to_prompt(info);
+    return true;
+}
+
+const char* system_info_prompt(const SystemInfo *info) {
+    return info ? info->prompt : NULL;
+}
+
+#ifndef _WIN32
+/* 快照的键：启动 ID（或启动时间）、内核版本、主机名、$SHELL 和 os-release 的修改时间，
+ * 任何一项变化都说明检测结果可能已经过期
+ */
+static uint64_t snapshot_key(void) {
+    uint64_t hash = hash_fnv1a_str(HASH_FNV_OFFSET, SNAPSHOT_MAGIC);
+    hash = hash_fnv1a_str(hash, getenv("SHELL"));
+
+    struct utsname uts;
+    if (uname(&uts) == 0) {
+        hash = hash_fnv1a_str(hash, uts.release);
+        hash = hash_fnv1a_str(hash, uts.machine);
+        hash = hash_fnv1a_str(hash, uts.nodename);
+    }
+
+#ifdef __linux__
+    char boot_id[64] = "";
+    int fd = open("/proc/sys/kernel/random/boot_id", O_RDONLY);
+    if (fd >= 0) {
+        ssize_t n = read(fd, boot_id, sizeof(boot_id) - 1);
+        boot_id[n > 0 ? n : 0] = '\0';
+        close(fd);
+    }
+    hash = hash_fnv1a_str(hash, boot_id);
+
+    struct stat st;
+    if (stat("/etc/os-release", &st) == 0) {
+        long long mtime = (long long)st.st_mtime;
+        hash = hash_fnv1a(hash, &mtime, sizeof(mtime));
+    }
+#elif defined(__APPLE__)
+    struct timeval boot_time;
+    size_t len = sizeof(boot_time);
+    if (sysctlbyname("kern.boottime", &boot_time, &len, NULL, 0) == 0) {
+        long long seconds = (long long)boot_time.tv_sec;
+        hash = hash_fnv1a(hash, &seconds, sizeof(seconds));
+    }
+#endif
+
+    return hash;
+}
+
+/* 快照中的字符串字段（顺序即文件中的顺序） */
+static char** snapshot_fields(SystemInfo *info, int index) {
+    char **fields[] = { &info->os_name, &info->os_version, &info->shell_name,
+                        &info->shell_version, &info->arch, &info->hostname, &info->prompt };
+    return index < (int)(sizeof(fields) / sizeof(fields[0])) ? fields[index] : NULL;
+}
+
+/* 读取快照：键一致时填充 info（全部字段读取成功才替换） */
+static bool snapshot_read(SystemInfo *info, const char *cache_file, uint64_t key) {
+    int fd = open(cache_file, O_RDONLY);
+    if (fd < 0) return false;
+
+    char data[SNAPSHOT_MAX_SIZE];
+    ssize_t size = read(fd, data, sizeof(data));
+    close(fd);
+
+    SnapshotHeader header;
+    if (size < (ssize_t)sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.key != key) {
+        return false;
+    }
+
+    char *values[SNAPSHOT_FIELDS] = { NULL };
+    size_t pos = sizeof(header);
+    bool ok = true;
+    for (int i = 0; i < SNAPSHOT_FIELDS && ok; i++) {
+        uint32_t len;
+        ok = pos + sizeof(len) <= (size_t)size;
+        if (!ok) break;
+        memcpy(&len, data + pos, sizeof(len));
+        pos += sizeof(len);
+        if (len == SNAPSHOT_NULL) continue;
+
+        ok = len <= (size_t)size - pos && (values[i] = strndup(data + pos, len)) != NULL;
+        pos += ok ? len : 0;
+    }
+
+    if (!ok || !values[SNAPSHOT_FIELDS - 1]) {
+        for (int i = 0; i < SNAPSHOT_FIELDS; i++) free(values[i]);
+        return false;
+    }
+
+    info->os_type = (OSType)header.os_type;
+    info->shell_type = (ShellType)header.shell_type;
+    for (int i = 0; i < SNAPSHOT_FIELDS; i++) {
+        char **field = snapshot_fields(info, i);
+        free(*field);
+        *field = values[i];
+    }
     return true;
 }
 
+/* 写入快照（临时文件 + rename，并发写入互不影响） */
+static void snapshot_write(SystemInfo *info, const char *cache_file, uint64_t key) {
+    char data[SNAPSHOT_MAX_SIZE];
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.key = key;
+    header.os_type = (uint32_t)info->os_type;
+    header.shell_type = (uint32_t)info->shell_type;
+    memcpy(data, &header, sizeof(header));
+
+    size_t pos = sizeof(header);
+    for (int i = 0; i < SNAPSHOT_FIELDS; i++) {
+        const char *value = *snapshot_fields(info, i);
+        uint32_t len = value ? (uint32_t)strlen(value) : SNAPSHOT_NULL;
+        size_t needed = sizeof(len) + (value ? len : 0);
+        if (pos + needed > sizeof(data)) return;
+
+        memcpy(data + pos, &len, sizeof(len));
+        if (value) memcpy(data + pos + sizeof(len), value, len);
+        pos += needed;
+    }
+
+    char tmp_file[1024];
+    snprintf(tmp_file, sizeof(tmp_file), "%s.tmp.%ld", cache_file, (long)getpid());
+    int fd = open(tmp_file, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return;
+
+    bool ok = write(fd, data, pos) == (ssize_t)pos;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp_file, cache_file) != 0) remove(tmp_file);
+}
+#endif
+
+bool system_info_detect_cached(SystemInfo *info, const char *cache_file) {
+    if (!info) return false;
+
+#ifdef _WIN32
+    /* Windows 上检测只调用系统 API，不需要快照 */
+    (void)cache_file;
+    return system_info_detect(info);
+#else
+    if (!cache_file) return system_info_detect(info);
+
+    uint64_t key = snapshot_key();
+    if (snapshot_read(info, cache_file, key)) return true;
+
+    bool ok = system_info_detect(info);
+    if (ok) snapshot_write(info, cache_file, key);
+    return ok;
+#endif
+}
+
 const char* os_type_to_string(OSType type) {
     switch (type) {
         case OS_LINUX: return "Linux";
@@ -205,6 +446,7 @@ void system_info_print(const SystemInfo *info) {
     if (info->os_version) printf("  OS Version: %s\n", info->os_version);
     printf("  Shell: %s\n", shell_type_to_string(info->shell_type));
     if (info->shell_name) printf("  Shell Name: %s\n", info->shell_name);
+    if (info->shell_version) printf("  Shell Version: %s\n", info->shell_version);
     if (info->arch) printf("  Architecture: %s\n", info->arch);
     if (info->hostname) printf("  Hostname: %s\n", info->hostname);
 }
@@ -235,7 +477,10 @@ char* system_info_to_prompt(const SystemInfo *info) {
                           "- Architecture: %s\n", info->arch);
     }
 
-    if (info->shell_name) {
+    if (info->shell_name && info->shell_version) {
+        offset += snprintf(buffer + offset, sizeof(buffer) - offset,
+                          "- Default Shell: %s %s\n", info->shell_name, info->shell_version);
+    } else if (info->shell_name) {
         offset += snprintf(buffer + offset, sizeof(buffer) - offset,
                           "- Default Shell: %s\n", info->shell_name);
     }
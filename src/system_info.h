@@ -37,12 +37,22 @@ typedef struct {
     char *shell_version;
     char *arch;
     char *hostname;
+    char *prompt;          /* 渲染好的 system_info_to_prompt 文本（检测后填充） */
 } SystemInfo;
 
 /* 函数声明 */
 SystemInfo* system_info_create(void);
 void system_info_destroy(SystemInfo *info);
 bool system_info_detect(SystemInfo *info);
+
+/* 使用快照文件中的检测结果，快照的键（启动 ID、内核版本、主机名、$SHELL、
+ * os-release 的修改时间）变化或快照不可用时重新检测并写入快照；
+ * cache_file 为 NULL 时等同于 system_info_detect
+ */
+bool system_info_detect_cached(SystemInfo *info, const char *cache_file);
+
+/* 检测时渲染好的系统上下文（不需要释放），没有检测过时为 NULL */
+const char* system_info_prompt(const SystemInfo *info);
 const char* os_type_to_string(OSType type);
 const char* shell_type_to_string(ShellType type);
 void system_info_print(const SystemInfo *info);
@@ -0,0 +1,184 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Timing Helpers Implementation
+ *===========================================================================*/
+
+/* dl_iterate_phdr 需要 _GNU_SOURCE */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
+#include "timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/resource.h>
+    #include <sys/time.h>
+#endif
+
+#if defined(__linux__)
+    #include <link.h>
+#elif defined(__APPLE__)
+    #include <mach-o/dyld.h>
+#endif
+
+/* 启动耗时统计（仅在 --startup-profile / --timings 时开启） */
+static struct {
+    bool enabled;                 /* 统计各阶段耗时 */
+    bool reported;                /* 退出时输出报告（--startup-profile） */
+    uint64_t main_start;
+    double premain_ms;            /* main 之前的 CPU 时间，不支持时为 -1 */
+    int shared_objects;           /* main 入口处已加载的共享库数，不支持时为 -1 */
+    uint64_t phase_ns[STARTUP_PHASE_COUNT];
+    int phase_count[STARTUP_PHASE_COUNT];
+} profile;
+
+static const char *const phase_names[STARTUP_PHASE_COUNT] = {
+    "config load",
+    "system detection",
+    "history load",
+    "network init",
+};
+
+uint64_t timing_now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#if defined(__linux__)
+static int count_object(struct dl_phdr_info *info, size_t size, void *data) {
+    (void)info;
+    (void)size;
+    (*(int *)data)++;
+    return 0;
+}
+#endif
+
+/* 当前已加载的共享对象数（包括可执行文件本身和 vDSO） */
+static int count_shared_objects(void) {
+#if defined(__linux__)
+    int count = 0;
+    dl_iterate_phdr(count_object, &count);
+    return count;
+#elif defined(__APPLE__)
+    return (int)_dyld_image_count();
+#else
+    return -1;
+#endif
+}
+
+static double ns_to_ms(uint64_t ns) {
+    return (double)ns / 1e6;
+}
+
+double timing_ms_since(uint64_t start_ns) {
+    return ns_to_ms(timing_now_ns() - start_ns);
+}
+
+void request_timings_reset(RequestTimings *timings) {
+    timings->start_ns = 0;
+    timings->body_built = -1;
+    timings->dns = -1;
+    timings->connect = -1;
+    timings->tls = -1;
+    timings->request_sent = -1;
+    timings->first_byte = -1;
+    timings->first_reasoning = -1;
+    timings->first_answer = -1;
+    timings->command = -1;
+    timings->end = -1;
+    timings->reused_connection = false;
+}
+
+void request_timings_mark(RequestTimings *timings, double *slot) {
+    if (timings->start_ns != 0 && *slot < 0) {
+        *slot = timing_ms_since(timings->start_ns);
+    }
+}
+
+static void print_profile(void) {
+    uint64_t total = timing_now_ns() - profile.main_start;
+
+    fflush(stdout);
+    fprintf(stderr, "\nStartup profile:\n");
+    if (profile.premain_ms >= 0) {
+        fprintf(stderr, "  %-24s %8.2f ms  (CPU time before main", "exec + dynamic linking",
+                profile.premain_ms);
+        if (profile.shared_objects >= 0) {
+            fprintf(stderr, ", %d shared objects", profile.shared_objects);
+        }
+        fprintf(stderr, ")\n");
+    } else {
+        fprintf(stderr, "  %-24s %8s\n", "exec + dynamic linking", "n/a");
+    }
+
+    for (int i = 0; i < STARTUP_PHASE_COUNT; i++) {
+        if (profile.phase_count[i] == 0) {
+            fprintf(stderr, "  %-24s %8s\n", phase_names[i], "-");
+        } else {
+            fprintf(stderr, "  %-24s %8.2f ms\n", phase_names[i], ns_to_ms(profile.phase_ns[i]));
+        }
+    }
+
+    int loaded = count_shared_objects();
+    fprintf(stderr, "  %-24s %8.2f ms", "main to exit", ns_to_ms(total));
+    if (loaded >= 0 && profile.shared_objects >= 0 && loaded != profile.shared_objects) {
+        fprintf(stderr, "  (%d shared objects loaded at runtime)", loaded - profile.shared_objects);
+    }
+    fprintf(stderr, "\n");
+}
+
+void startup_phases_enable(uint64_t main_start) {
+    if (profile.enabled) return;
+
+    profile.enabled = true;
+    profile.main_start = main_start;
+}
+
+double startup_phase_ms(StartupPhase phase) {
+    if (!profile.enabled || profile.phase_count[phase] == 0) return -1;
+    return ns_to_ms(profile.phase_ns[phase]);
+}
+
+void startup_profile_enable(uint64_t main_start) {
+    if (profile.reported) return;
+
+    startup_phases_enable(main_start);
+    profile.reported = true;
+    profile.premain_ms = -1;
+    profile.shared_objects = count_shared_objects();
+
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        profile.premain_ms = (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 +
+                             (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+    }
+#endif
+
+    atexit(print_profile);
+}
+
+uint64_t startup_phase_begin(void) {
+    return profile.enabled ? timing_now_ns() : 0;
+}
+
+void startup_phase_end(StartupPhase phase, uint64_t start) {
+    if (!profile.enabled || start == 0) return;
+
+    profile.phase_ns[phase] += timing_now_ns() - start;
+    profile.phase_count[phase]++;
+}
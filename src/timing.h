@@ -0,0 +1,70 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Timing Helpers Header
+ *===========================================================================*/
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* 启动阶段（--startup-profile） */
+typedef enum {
+    STARTUP_CONFIG,       /* 读取并解析配置 */
+    STARTUP_SYSTEM,       /* 系统信息检测（或读取快照） */
+    STARTUP_HISTORY,      /* 加载对话历史 */
+    STARTUP_NETWORK,      /* 加载 libcurl、全局初始化并创建连接句柄 */
+    STARTUP_PHASE_COUNT
+} StartupPhase;
+
+/* 一次请求的时间线（--timings）
+ * 各字段为相对请求开始（调用 api_send_request*）的毫秒数，未发生的阶段为 -1。
+ * 网络阶段来自 curl_easy_getinfo，其余为单调时钟时间点。
+ */
+typedef struct {
+    uint64_t start_ns;        /* 请求开始（timing_now_ns），未发送请求时为 0 */
+    double body_built;        /* 请求体构建完成 */
+    double dns;               /* DNS 解析完成（复用连接时为 -1） */
+    double connect;           /* TCP 连接建立（复用连接时为 -1） */
+    double tls;               /* TLS 握手完成（HTTP 或复用连接时为 -1） */
+    double request_sent;      /* 请求发送完成，开始等待响应 */
+    double first_byte;        /* 收到第一个响应字节 */
+    double first_reasoning;   /* 第一个思考过程片段（仅流式） */
+    double first_answer;      /* 第一个回答片段（仅流式） */
+    double command;           /* 提取出命令 */
+    double end;               /* 传输结束 */
+    bool reused_connection;   /* 复用了已建立的连接 */
+} RequestTimings;
+
+/* 单调时钟（纳秒） */
+uint64_t timing_now_ns(void);
+
+/* 自 start_ns 以来经过的毫秒数 */
+double timing_ms_since(uint64_t start_ns);
+
+/* 所有时间点置为 -1，start_ns 置为 0 */
+void request_timings_reset(RequestTimings *timings);
+
+/* 记录一个时间点（只记录第一次） */
+void request_timings_mark(RequestTimings *timings, double *slot);
+
+/* 开始统计各启动阶段的耗时；main_start 为 main 入口处的 timing_now_ns() */
+void startup_phases_enable(uint64_t main_start);
+
+/* 某个启动阶段的累计耗时（毫秒），未统计或未发生时返回 -1 */
+double startup_phase_ms(StartupPhase phase);
+
+/* 开启启动耗时报告（--startup-profile）：在 startup_phases_enable 的基础上
+ * 记录进入 main 之前消耗的 CPU 时间（exec、动态链接和构造函数），
+ * 进程退出时向 stderr 输出各阶段耗时
+ */
+void startup_profile_enable(uint64_t main_start);
+
+/* 阶段开始：未开启统计时返回 0，不读取时钟 */
+uint64_t startup_phase_begin(void);
+
+/* 阶段结束：累加自 start 以来的耗时（同一阶段可以出现多次） */
+void startup_phase_end(StartupPhase phase, uint64_t start);
+
+#endif /* TIMING_H */
@@ -0,0 +1,142 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Network Transport Implementation
+ *===========================================================================*/
+
+#include "transport.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(LAZY_CURL) && !defined(_WIN32)
+
+#include <dlfcn.h>
+
+/* 函数表在 transport_load 中填充 */
+Transport transport;
+
+static bool loaded = false;
+
+#ifdef __APPLE__
+static const char *const library_names[] = { "libcurl.4.dylib", "libcurl.dylib", NULL };
+#else
+static const char *const library_names[] = { "libcurl.so.4", "libcurl.so", NULL };
+#endif
+
+/* 解析一个符号并写入函数表的对应字段 */
+static bool load_symbol(void *library, const char *name, void *slot) {
+    void *symbol = dlsym(library, name);
+    if (!symbol) return false;
+    memcpy(slot, &symbol, sizeof(symbol));
+    return true;
+}
+
+bool transport_load(void) {
+    if (loaded) return true;
+
+    void *library = NULL;
+    for (int i = 0; library_names[i] && !library; i++) {
+        library = dlopen(library_names[i], RTLD_NOW | RTLD_LOCAL);
+    }
+    if (!library) {
+        fprintf(stderr, "Error: Cannot load libcurl: %s\n", dlerror());
+        return false;
+    }
+
+    Transport table;
+    memset(&table, 0, sizeof(table));
+
+    const struct {
+        const char *name;
+        void *slot;
+    } symbols[] = {
+        { "curl_global_init",         &table.global_init },
+        { "curl_global_cleanup",      &table.global_cleanup },
+        { "curl_easy_init",           &table.easy_init },
+        { "curl_easy_cleanup",        &table.easy_cleanup },
+        { "curl_easy_reset",          &table.easy_reset },
+        { "curl_easy_setopt",         &table.easy_setopt },
+        { "curl_easy_getinfo",        &table.easy_getinfo },
+        { "curl_easy_perform",        &table.easy_perform },
+        { "curl_easy_strerror",       &table.easy_strerror },
+        { "curl_slist_append",        &table.slist_append },
+        { "curl_slist_free_all",      &table.slist_free_all },
+        { "curl_share_init",          &table.share_init },
+        { "curl_share_setopt",        &table.share_setopt },
+        { "curl_share_cleanup",       &table.share_cleanup },
+        { "curl_multi_init",          &table.multi_init },
+        { "curl_multi_setopt",        &table.multi_setopt },
+        { "curl_multi_add_handle",    &table.multi_add_handle },
+        { "curl_multi_remove_handle", &table.multi_remove_handle },
+        { "curl_multi_perform",       &table.multi_perform },
+        { "curl_multi_info_read",     &table.multi_info_read },
+        { "curl_multi_cleanup",       &table.multi_cleanup },
+        { "curl_multi_strerror",      &table.multi_strerror },
+    };
+
+    for (size_t i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++) {
+        if (!load_symbol(library, symbols[i].name, symbols[i].slot)) {
+            fprintf(stderr, "Error: libcurl does not export %s\n", symbols[i].name);
+            dlclose(library);
+            return false;
+        }
+    }
+
+    /* 运行时的 libcurl 可能比编译时的头文件旧 */
+    if (!load_symbol(library, "curl_multi_poll", &table.multi_poll) &&
+        !load_symbol(library, "curl_multi_wait", &table.multi_poll)) {
+        fprintf(stderr, "Error: libcurl does not export curl_multi_wait\n");
+        dlclose(library);
+        return false;
+    }
+
+    /* 库保持加载直到进程退出 */
+    transport = table;
+    loaded = true;
+    return true;
+}
+
+bool transport_loaded(void) {
+    return loaded;
+}
+
+#else
+
+Transport transport = {
+    .global_init = curl_global_init,
+    .global_cleanup = curl_global_cleanup,
+    .easy_init = curl_easy_init,
+    .easy_cleanup = curl_easy_cleanup,
+    .easy_reset = curl_easy_reset,
+    .easy_setopt = curl_easy_setopt,
+    .easy_getinfo = curl_easy_getinfo,
+    .easy_perform = curl_easy_perform,
+    .easy_strerror = curl_easy_strerror,
+    .slist_append = curl_slist_append,
+    .slist_free_all = curl_slist_free_all,
+    .share_init = curl_share_init,
+    .share_setopt = curl_share_setopt,
+    .share_cleanup = curl_share_cleanup,
+    .multi_init = curl_multi_init,
+    .multi_setopt = curl_multi_setopt,
+    .multi_add_handle = curl_multi_add_handle,
+    .multi_remove_handle = curl_multi_remove_handle,
+    .multi_perform = curl_multi_perform,
+#if LIBCURL_VERSION_NUM >= 0x074200  /* 7.66.0 起提供 curl_multi_poll */
+    .multi_poll = curl_multi_poll,
+#else
+    .multi_poll = curl_multi_wait,
+#endif
+    .multi_info_read = curl_multi_info_read,
+    .multi_cleanup = curl_multi_cleanup,
+    .multi_strerror = curl_multi_strerror,
+};
+
+bool transport_load(void) {
+    return true;
+}
+
+bool transport_loaded(void) {
+    return true;
+}
+
+#endif
@@ -0,0 +1,58 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Network Transport Header
+ *===========================================================================*/
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdbool.h>
+#include <curl/curl.h>
+
+/* libcurl 函数表
+ * 所有网络调用都通过 transport.xxx(...) 进行，而不是直接调用 curl_xxx。
+ * 默认构建直接链接 libcurl，函数表在编译时填好；以 make LAZY_CURL=1 构建时
+ * 不链接 libcurl，第一次真正发送请求时（client_create）才 dlopen 并解析符号，
+ * --help、--history、缓存命中等不联网的调用不再加载 libcurl 和 TLS 库。
+ */
+typedef struct {
+    CURLcode (*global_init)(long flags);
+    void (*global_cleanup)(void);
+
+    CURL* (*easy_init)(void);
+    void (*easy_cleanup)(CURL *curl);
+    void (*easy_reset)(CURL *curl);
+    CURLcode (*easy_setopt)(CURL *curl, CURLoption option, ...);
+    CURLcode (*easy_getinfo)(CURL *curl, CURLINFO info, ...);
+    CURLcode (*easy_perform)(CURL *curl);
+    const char* (*easy_strerror)(CURLcode code);
+
+    struct curl_slist* (*slist_append)(struct curl_slist *list, const char *string);
+    void (*slist_free_all)(struct curl_slist *list);
+
+    CURLSH* (*share_init)(void);
+    CURLSHcode (*share_setopt)(CURLSH *share, CURLSHoption option, ...);
+    CURLSHcode (*share_cleanup)(CURLSH *share);
+
+    CURLM* (*multi_init)(void);
+    CURLMcode (*multi_setopt)(CURLM *multi, CURLMoption option, ...);
+    CURLMcode (*multi_add_handle)(CURLM *multi, CURL *curl);
+    CURLMcode (*multi_remove_handle)(CURLM *multi, CURL *curl);
+    CURLMcode (*multi_perform)(CURLM *multi, int *running_handles);
+    /* curl_multi_poll（7.66.0 起），更旧的 libcurl 上为 curl_multi_wait */
+    CURLMcode (*multi_poll)(CURLM *multi, struct curl_waitfd extra_fds[],
+                            unsigned int extra_nfds, int timeout_ms, int *numfds);
+    CURLMsg* (*multi_info_read)(CURLM *multi, int *msgs_in_queue);
+    CURLMcode (*multi_cleanup)(CURLM *multi);
+    const char* (*multi_strerror)(CURLMcode code);
+} Transport;
+
+extern Transport transport;
+
+/* 确保函数表可用（LAZY_CURL 构建时加载 libcurl），失败时输出错误并返回 false */
+bool transport_load(void);
+
+/* 函数表是否已经可用（不触发加载） */
+bool transport_loaded(void);
+
+#endif /* TRANSPORT_H */
@@ -99,6 +99,18 @@ void print_usage(const char *program_name) {
     printf("  -I, --init              Initialize configuration (interactive wizard)\n");
     printf("  -H, --history           Show conversation history\n");
     printf("  -c, --clear-history     Clear conversation history\n");
+    printf("      --daemon            Start the resident daemon (glm-cmdd) in the background\n");
+    printf("      --daemon-stop       Stop the running daemon\n");
+    printf("      --no-daemon         Do not forward the query to a running daemon\n");
+    printf("      --batch FILE        Translate every query in FILE (one per line, '-' for stdin)\n");
+    printf("      --jobs N            Number of concurrent batch requests (default: 4)\n");
+    printf("      --no-cache          Neither read nor update the local response cache\n");
+    printf("      --refresh           Skip the cached answer, query the API and update the cache\n");
+    printf("      --startup-profile   Print time spent in startup phases (exec, config, detection, history)\n");
+    printf("      --timings           Print a JSON latency breakdown of the query to stderr\n");
+    printf("      --record DIR        Record API responses (with chunk timing) into DIR\n");
+    printf("      --replay DIR        Replay responses recorded with --record, without network access\n");
+    printf("      --replay-speed X    Replay timing multiplier (default: 1, 0 = no delays)\n");
     printf("\n");
     printf("Environment Variables:\n");
     printf("  GLM_CMD_API_KEY         API key for Zhipu AI (required)\n");
@@ -107,6 +119,9 @@ void print_usage(const char *program_name) {
     printf("  GLM_CMD_TEMP            Temperature (default: 0.7)\n");
     printf("  GLM_CMD_MAX_TOKENS      Max tokens (default: 2048)\n");
     printf("  GLM_CMD_TIMEOUT         Timeout in seconds (default: 30)\n");
+    printf("  GLM_CMD_STOP_AFTER_COMMAND  End the stream once the command is complete (true/false)\n");
+    printf("  GLM_CMD_THINKING        Thinking mode sent to the model (enabled/disabled)\n");
+    printf("  GLM_CMD_SOCKET          Daemon socket path (default: ~/.glm-cmd/glm-cmdd.sock)\n");
     printf("\n");
     printf("Examples:\n");
     printf("  %s \"List all files larger than 100MB\"\n", program_name);
@@ -115,6 +130,8 @@ void print_usage(const char *program_name) {
     printf("  %s --init               # Run configuration wizard\n", program_name);
     printf("  %s --history             # Show conversation history\n", program_name);
     printf("  %s --clear-history       # Clear conversation history\n", program_name);
+    printf("  %s --daemon              # Keep config, history and connections warm\n", program_name);
+    printf("  %s --batch queries.jsonl --jobs 8 > results.jsonl\n", program_name);
     printf("\n");
     printf("For more information, visit: https://github.com/Y5neKO/glm-cmd\n");
 }
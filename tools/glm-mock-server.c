@@ -0,0 +1,678 @@
+/*=============================================================================
+ * GLM-CMD - Natural Language to Command Tool
+ * Local Mock GLM Server
+ *
+ * 在本机提供 /chat/completions（JSON 和 SSE 两种形式），用于在不访问
+ * open.bigmodel.cn 的情况下对完整客户端做可重复的延迟和吞吐测试：
+ *     make mock-server
+ *     tools/glm-mock-server --port 18080 --ttfb 300 --token-delay 20
+ *     （config.ini 中设置 endpoint="http://127.0.0.1:18080"）
+ *
+ * 响应内容来自录制的 SSE 流（--replay FILE，如 bench/data/glm-4.7-stream.sse）
+ * 或合成的 glm-4.7 流（默认）。非流式请求返回由同一组事件拼接出的完整 JSON。
+ * 流式响应按“片段”写出，片段之间等待 --token-delay 毫秒
+ * （非流式响应等待相同的总时长后一次返回，与真实服务一样要等全部生成完）：
+ *   - 默认每个 SSE 事件一个片段
+ *   - --chunk-size N 时不考虑事件边界，每 N 字节一个片段
+ *   - --split-utf8 时再把每个片段从第一个多字节 UTF-8 字符的中间切开
+ * 每个连接由一个子进程处理，支持 HTTP/1.1 keep-alive（流式响应使用 chunked 编码）。
+ *===========================================================================*/
+
+/* memmem 需要 _GNU_SOURCE */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define DEFAULT_PORT 18080
+#define DEFAULT_MODEL "glm-4.7"
+#define MAX_HEADER_SIZE (16 * 1024)
+#define MAX_BODY_SIZE (16 * 1024 * 1024)
+
+/* 服务器选项 */
+typedef struct {
+    int port;
+    const char *replay_file;     /* 录制的 SSE 流，NULL 时使用合成流 */
+    double ttfb_ms;              /* 收到请求后、写出响应前的等待 */
+    double token_delay_ms;       /* 流式片段之间的等待（非流式响应等待相同的总时长） */
+    size_t chunk_size;           /* 每个片段的字节数，0 表示每个事件一个片段 */
+    bool split_utf8;             /* 在多字节 UTF-8 字符中间切分片段 */
+    int reasoning_tokens;        /* 合成流的思考过程片段数 */
+    int status;                  /* 返回的 HTTP 状态码（非 200 时返回错误体） */
+    int disconnect_after;        /* 写出这么多片段后断开连接，-1 表示不断开 */
+    bool quiet;
+} MockOptions;
+
+/* 可增长的字节缓冲区 */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+/* 一个响应流：SSE 文本及每个事件的结束位置 */
+typedef struct {
+    Buffer sse;
+    size_t *event_ends;
+    size_t event_count;
+    int completion_tokens;
+} MockStream;
+
+static void buffer_reserve(Buffer *buf, size_t extra) {
+    if (buf->len + extra + 1 <= buf->cap) return;
+    size_t cap = buf->cap ? buf->cap : 4096;
+    while (buf->len + extra + 1 > cap) cap *= 2;
+    char *data = (char *)realloc(buf->data, cap);
+    if (!data) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    buf->data = data;
+    buf->cap = cap;
+}
+
+static void buffer_append(Buffer *buf, const char *data, size_t len) {
+    buffer_reserve(buf, len);
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+}
+
+static void buffer_printf(Buffer *buf, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    if (n < 0) return;
+
+    buffer_reserve(buf, (size_t)n);
+    va_start(args, fmt);
+    vsnprintf(buf->data + buf->len, (size_t)n + 1, fmt, args);
+    va_end(args);
+    buf->len += (size_t)n;
+}
+
+static void sleep_ms(double ms) {
+    if (ms <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ms / 1000);
+    ts.tv_nsec = (long)((ms - (double)ts.tv_sec * 1000) * 1e6);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static bool write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/*---------------------------------------------------------------------------
+ * 响应流
+ *-------------------------------------------------------------------------*/
+
+static void stream_add_event(MockStream *stream, const char *data, size_t len) {
+    buffer_append(&stream->sse, data, len);
+    size_t *ends = (size_t *)realloc(stream->event_ends,
+                                     sizeof(size_t) * (stream->event_count + 1));
+    if (!ends) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    stream->event_ends = ends;
+    stream->event_ends[stream->event_count++] = stream->sse.len;
+}
+
+/* 合成流的片段（已经是 JSON 转义后的文本） */
+static const char *const reasoning_pool[] = {
+    "用户想", "查找当前目录下", "大于 100MB 的", "文件，", "并按大小", "排序。",
+    "可以使用 find ", "的 -size 选项", "筛选，", "再交给 du ", "统计大小，", "最后用 sort -rh ",
+    "倒序排列。", "文件名可能", "包含空格，", "所以用 -exec ", "{} + 批量", "传参。\\n",
+};
+
+static const char *const answer_pieces[] = {
+    "**命令：**\\n", "```bash\\n", "find . -type f ", "-size +100M ", "-exec du -h {} + ",
+    "| sort -rh\\n", "```\\n\\n", "这个命令会", "递归查找大于 100MB 的文件，", "并按大小从大到小排列。",
+};
+
+static void add_delta(MockStream *stream, const char *model, const char *field, const char *text) {
+    Buffer event = {0};
+    buffer_printf(&event,
+                  "data: {\"id\":\"mock-0001\",\"created\":1768635012,\"object\":\"chat.completion.chunk\","
+                  "\"model\":\"%s\",\"choices\":[{\"index\":0,\"delta\":{\"role\":\"assistant\","
+                  "\"%s\":\"%s\"}}]}\n\n", model, field, text);
+    stream_add_event(stream, event.data, event.len);
+    free(event.data);
+    stream->completion_tokens++;
+}
+
+static void build_synthetic(MockStream *stream, const MockOptions *opts, const char *model) {
+    size_t pool = sizeof(reasoning_pool) / sizeof(reasoning_pool[0]);
+    for (int i = 0; i < opts->reasoning_tokens; i++) {
+        add_delta(stream, model, "reasoning_content", reasoning_pool[(size_t)i % pool]);
+    }
+    for (size_t i = 0; i < sizeof(answer_pieces) / sizeof(answer_pieces[0]); i++) {
+        add_delta(stream, model, "content", answer_pieces[i]);
+    }
+}
+
+/* 载入录制的 SSE 流：以空行分隔事件 */
+static bool load_replay(MockStream *stream, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open %s\n", path);
+        return false;
+    }
+
+    Buffer content = {0};
+    char chunk[8192];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        buffer_append(&content, chunk, n);
+    }
+    fclose(file);
+    if (!content.data) {
+        fprintf(stderr, "Error: %s is empty\n", path);
+        return false;
+    }
+
+    const char *pos = content.data;
+    const char *end = content.data + content.len;
+    while (pos < end) {
+        const char *sep = strstr(pos, "\n\n");
+        const char *event_end = sep ? sep + 2 : end;
+        size_t len = (size_t)(event_end - pos);
+        if (len > 0 && !(len == 1 && *pos == '\n')) {
+            stream_add_event(stream, pos, len);
+            if (strncmp(pos, "data: [DONE]", 12) != 0) stream->completion_tokens++;
+        }
+        pos = event_end;
+    }
+
+    free(content.data);
+    return stream->event_count > 0;
+}
+
+/* 合成流结尾：finish_reason、usage 和 [DONE] */
+static void finish_synthetic(MockStream *stream, const char *model, int prompt_tokens) {
+    Buffer event = {0};
+    buffer_printf(&event,
+                  "data: {\"id\":\"mock-0001\",\"created\":1768635012,\"object\":\"chat.completion.chunk\","
+                  "\"model\":\"%s\",\"choices\":[{\"index\":0,\"delta\":{\"role\":\"assistant\","
+                  "\"content\":\"\"},\"finish_reason\":\"stop\"}],\"usage\":{\"prompt_tokens\":%d,"
+                  "\"completion_tokens\":%d,\"total_tokens\":%d,"
+                  "\"prompt_tokens_details\":{\"cached_tokens\":0}}}\n\n",
+                  model, prompt_tokens, stream->completion_tokens,
+                  prompt_tokens + stream->completion_tokens);
+    stream_add_event(stream, event.data, event.len);
+    free(event.data);
+    stream_add_event(stream, "data: [DONE]\n\n", 14);
+}
+
+/* 从事件中取出某个字符串字段的原始（仍是转义形式的）值，拼接到 out
+ * 转义形式的片段直接拼接仍是合法的 JSON 字符串内容
+ */
+static void collect_field(const char *event, size_t len, const char *field, Buffer *out) {
+    char pattern[64];
+    int plen = snprintf(pattern, sizeof(pattern), "\"%s\":\"", field);
+    const char *pos = (const char *)memmem(event, len, pattern, (size_t)plen);
+    if (!pos) return;
+
+    const char *start = pos + plen;
+    const char *end = event + len;
+    const char *p = start;
+    while (p < end && *p != '"') {
+        if (*p == '\\' && p + 1 < end) p++;
+        p++;
+    }
+    buffer_append(out, start, (size_t)(p - start));
+}
+
+/* 非流式响应：拼接所有事件的思考过程和回答 */
+static void build_completion(const MockStream *stream, const char *model, int prompt_tokens,
+                             Buffer *out) {
+    Buffer reasoning = {0};
+    Buffer content = {0};
+    buffer_append(&reasoning, "", 0);
+    buffer_append(&content, "", 0);
+
+    size_t start = 0;
+    for (size_t i = 0; i < stream->event_count; i++) {
+        const char *event = stream->sse.data + start;
+        size_t len = stream->event_ends[i] - start;
+        collect_field(event, len, "reasoning_content", &reasoning);
+        collect_field(event, len, "content", &content);
+        start = stream->event_ends[i];
+    }
+
+    buffer_printf(out,
+                  "{\"id\":\"mock-0001\",\"created\":1768635012,\"object\":\"chat.completion\","
+                  "\"model\":\"%s\",\"choices\":[{\"index\":0,\"message\":{\"role\":\"assistant\","
+                  "\"content\":\"%s\",\"reasoning_content\":\"%s\"},\"finish_reason\":\"stop\"}],"
+                  "\"usage\":{\"prompt_tokens\":%d,\"completion_tokens\":%d,\"total_tokens\":%d,"
+                  "\"prompt_tokens_details\":{\"cached_tokens\":0}}}",
+                  model, content.data, reasoning.data, prompt_tokens, stream->completion_tokens,
+                  prompt_tokens + stream->completion_tokens);
+    free(reasoning.data);
+    free(content.data);
+}
+
+/* 计算片段边界（每个片段的结束位置） */
+static size_t* split_pieces(const MockStream *stream, const MockOptions *opts, size_t *count) {
+    size_t total = stream->sse.len;
+    size_t cap = stream->event_count * 2 + (opts->chunk_size ? total / opts->chunk_size * 2 : 0) + 4;
+    size_t *ends = (size_t *)malloc(sizeof(size_t) * cap);
+    size_t n = 0;
+    if (!ends) return NULL;
+
+    size_t start = 0;
+    size_t next_event = 0;
+    while (start < total) {
+        size_t end = opts->chunk_size ? start + opts->chunk_size : stream->event_ends[next_event++];
+        if (end > total) end = total;
+
+        /* 从第一个多字节字符的首字节之后切开 */
+        if (opts->split_utf8) {
+            for (size_t i = start; i + 1 < end; i++) {
+                if ((unsigned char)stream->sse.data[i] >= 0xC0) {
+                    ends[n++] = i + 1;
+                    break;
+                }
+            }
+        }
+        ends[n++] = end;
+        start = end;
+    }
+
+    *count = n;
+    return ends;
+}
+
+/*---------------------------------------------------------------------------
+ * HTTP
+ *-------------------------------------------------------------------------*/
+
+typedef struct {
+    char method[16];
+    char path[256];
+    size_t content_length;
+    bool close;
+    char *body;
+} HttpRequest;
+
+static const char* status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        default:  return "Error";
+    }
+}
+
+/* 读取一个请求（请求头和请求体），连接关闭或出错时返回 false
+ * pending 保存上一次读取中多出来的字节（keep-alive 时的下一个请求）
+ */
+static bool read_request(int fd, Buffer *pending, HttpRequest *request) {
+    memset(request, 0, sizeof(*request));
+
+    char *header_end;
+    while (!(pending->data && (header_end = strstr(pending->data, "\r\n\r\n")))) {
+        if (pending->len > MAX_HEADER_SIZE) return false;
+        char chunk[4096];
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buffer_append(pending, chunk, (size_t)n);
+    }
+
+    size_t header_len = (size_t)(header_end - pending->data) + 4;
+    *header_end = '\0';
+    if (sscanf(pending->data, "%15s %255s", request->method, request->path) != 2) return false;
+
+    /* 请求头（大小写不敏感） */
+    for (char *line = strstr(pending->data, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            request->content_length = (size_t)strtoul(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char *value = line + 11;
+            while (*value == ' ') value++;
+            request->close = strncasecmp(value, "close", 5) == 0;
+        }
+    }
+    if (request->content_length > MAX_BODY_SIZE) return false;
+
+    while (pending->len < header_len + request->content_length) {
+        char chunk[65536];
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buffer_append(pending, chunk, (size_t)n);
+    }
+
+    request->body = (char *)malloc(request->content_length + 1);
+    if (!request->body) return false;
+    memcpy(request->body, pending->data + header_len, request->content_length);
+    request->body[request->content_length] = '\0';
+
+    /* 剩余字节留给下一个请求 */
+    size_t consumed = header_len + request->content_length;
+    memmove(pending->data, pending->data + consumed, pending->len - consumed);
+    pending->len -= consumed;
+    pending->data[pending->len] = '\0';
+    return true;
+}
+
+/* 请求体中 "stream" 是否为 true */
+static bool body_wants_stream(const char *body) {
+    const char *pos = strstr(body, "\"stream\"");
+    if (!pos) return false;
+    pos += 8;
+    while (*pos == ' ' || *pos == ':') pos++;
+    return strncmp(pos, "true", 4) == 0;
+}
+
+/* 请求体中的 "model"（只接受不需要转义的字符） */
+static void body_model(const char *body, char *model, size_t size) {
+    snprintf(model, size, "%s", DEFAULT_MODEL);
+    const char *pos = strstr(body, "\"model\"");
+    if (!pos) return;
+    pos += 7;
+    while (*pos == ' ' || *pos == ':') pos++;
+    if (*pos != '"') return;
+    pos++;
+
+    size_t len = strcspn(pos, "\"\\");
+    if (pos[len] != '"' || len == 0 || len >= size) return;
+    memcpy(model, pos, len);
+    model[len] = '\0';
+}
+
+static bool send_status(int fd, int status, const char *content_type, const char *body,
+                        size_t body_len, bool close) {
+    char header[512];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                     "Connection: %s\r\n\r\n",
+                     status, status_text(status), content_type, body_len,
+                     close ? "close" : "keep-alive");
+    return write_all(fd, header, (size_t)n) && write_all(fd, body, body_len);
+}
+
+/* 处理一个请求，返回 false 时关闭连接 */
+static bool handle_request(int fd, const HttpRequest *request, const MockOptions *opts,
+                           const MockStream *replay) {
+    size_t path_len = strlen(request->path);
+    if (strcmp(request->method, "POST") != 0 || path_len < 17 ||
+        strcmp(request->path + path_len - 17, "/chat/completions") != 0) {
+        const char body[] = "{\"error\":{\"code\":\"404\",\"message\":\"Not Found\"}}";
+        if (!opts->quiet) fprintf(stderr, "[mock] %s %s 404\n", request->method, request->path);
+        return send_status(fd, 404, "application/json", body, sizeof(body) - 1, request->close) &&
+               !request->close;
+    }
+
+    bool stream_mode = body_wants_stream(request->body);
+    char model[64];
+    body_model(request->body, model, sizeof(model));
+    int prompt_tokens = (int)(request->content_length / 4);
+
+    sleep_ms(opts->ttfb_ms);
+
+    if (opts->status != 200) {
+        char body[256];
+        int n = snprintf(body, sizeof(body),
+                         "{\"error\":{\"code\":\"%d\",\"message\":\"Mock error (HTTP %d)\"}}",
+                         opts->status, opts->status);
+        if (!opts->quiet) {
+            fprintf(stderr, "[mock] POST %s %s %d\n", request->path,
+                    stream_mode ? "stream" : "json", opts->status);
+        }
+        return send_status(fd, opts->status, "application/json", body, (size_t)n, request->close) &&
+               !request->close;
+    }
+
+    /* 构建本次响应的事件（合成流中的 usage 按请求体大小估算） */
+    MockStream stream = {0};
+    if (replay) {
+        stream = *replay;
+    } else {
+        build_synthetic(&stream, opts, model);
+        finish_synthetic(&stream, model, prompt_tokens);
+    }
+
+    bool keep = !request->close;
+    if (!stream_mode) {
+        /* 非流式响应在整个流生成完之后才返回：等待与流式相同的总时长 */
+        size_t piece_count = 0;
+        free(split_pieces(&stream, opts, &piece_count));
+        if (piece_count > 1) sleep_ms(opts->token_delay_ms * (double)(piece_count - 1));
+
+        Buffer body = {0};
+        build_completion(&stream, model, prompt_tokens, &body);
+        if (opts->disconnect_after >= 0) {
+            /* 只写出一半的响应体后断开 */
+            char header[256];
+            int n = snprintf(header, sizeof(header),
+                             "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                             "Content-Length: %zu\r\n\r\n", body.len);
+            write_all(fd, header, (size_t)n);
+            write_all(fd, body.data, body.len / 2);
+            keep = false;
+        } else {
+            keep = send_status(fd, 200, "application/json", body.data, body.len, request->close) &&
+                   keep;
+        }
+        if (!opts->quiet) {
+            fprintf(stderr, "[mock] POST %s json 200 (%zu bytes%s)\n", request->path, body.len,
+                    opts->disconnect_after >= 0 ? ", disconnected" : "");
+        }
+        free(body.data);
+    } else {
+        char header[256];
+        int n = snprintf(header, sizeof(header),
+                         "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                         "Cache-Control: no-cache\r\nTransfer-Encoding: chunked\r\n"
+                         "Connection: %s\r\n\r\n", request->close ? "close" : "keep-alive");
+        keep = write_all(fd, header, (size_t)n) && keep;
+
+        size_t piece_count = 0;
+        size_t *pieces = split_pieces(&stream, opts, &piece_count);
+        size_t start = 0;
+        size_t sent = 0;
+        for (size_t i = 0; keep && pieces && i < piece_count; i++) {
+            if (opts->disconnect_after >= 0 && (int)i >= opts->disconnect_after) {
+                keep = false;
+                break;
+            }
+            if (i > 0) sleep_ms(opts->token_delay_ms);
+
+            char size_line[32];
+            size_t len = pieces[i] - start;
+            int m = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+            keep = write_all(fd, size_line, (size_t)m) &&
+                   write_all(fd, stream.sse.data + start, len) &&
+                   write_all(fd, "\r\n", 2);
+            start = pieces[i];
+            sent++;
+        }
+        if (keep) keep = write_all(fd, "0\r\n\r\n", 5) && !request->close;
+        if (!opts->quiet) {
+            fprintf(stderr, "[mock] POST %s stream 200 (%zu events, %zu of %zu pieces%s)\n",
+                    request->path, stream.event_count, sent, piece_count,
+                    sent < piece_count ? ", disconnected" : "");
+        }
+        free(pieces);
+    }
+
+    if (!replay) {
+        free(stream.sse.data);
+        free(stream.event_ends);
+    }
+    return keep;
+}
+
+static void serve_connection(int fd, const MockOptions *opts, const MockStream *replay) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    Buffer pending = {0};
+    HttpRequest request;
+    while (read_request(fd, &pending, &request)) {
+        bool keep = handle_request(fd, &request, opts, replay);
+        free(request.body);
+        if (!keep) break;
+    }
+    free(pending.data);
+    close(fd);
+}
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [options]\n\n", program_name);
+    printf("Serve /chat/completions (JSON and SSE) on 127.0.0.1 for offline benchmarks.\n\n");
+    printf("Options:\n");
+    printf("  -p, --port N              Port to listen on (default: %d, 0 = any free port)\n",
+           DEFAULT_PORT);
+    printf("  -r, --replay FILE         Replay a recorded SSE stream instead of a synthetic one\n");
+    printf("  -t, --ttfb MS             Delay before the first response byte (default: 0)\n");
+    printf("  -d, --token-delay MS      Delay between stream pieces (default: 0)\n");
+    printf("  -c, --chunk-size N        Write the stream in N-byte pieces (default: one per event)\n");
+    printf("  -u, --split-utf8          Split pieces in the middle of multi-byte UTF-8 characters\n");
+    printf("  -n, --reasoning-tokens N  Reasoning tokens in the synthetic stream (default: 40)\n");
+    printf("  -s, --status CODE         Answer every request with this HTTP status\n");
+    printf("  -D, --disconnect-after N  Drop the connection after N pieces (JSON: half the body)\n");
+    printf("  -q, --quiet               Do not log requests to stderr\n");
+    printf("  -h, --help                Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    MockOptions opts = {
+        .port = DEFAULT_PORT,
+        .reasoning_tokens = 40,
+        .status = 200,
+        .disconnect_after = -1,
+    };
+
+    static struct option long_options[] = {
+        {"port",             required_argument, 0, 'p'},
+        {"replay",           required_argument, 0, 'r'},
+        {"ttfb",             required_argument, 0, 't'},
+        {"token-delay",      required_argument, 0, 'd'},
+        {"chunk-size",       required_argument, 0, 'c'},
+        {"split-utf8",       no_argument,       0, 'u'},
+        {"reasoning-tokens", required_argument, 0, 'n'},
+        {"status",           required_argument, 0, 's'},
+        {"disconnect-after", required_argument, 0, 'D'},
+        {"quiet",            no_argument,       0, 'q'},
+        {"help",             no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:r:t:d:c:un:s:D:qh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'p': opts.port = atoi(optarg); break;
+            case 'r': opts.replay_file = optarg; break;
+            case 't': opts.ttfb_ms = atof(optarg); break;
+            case 'd': opts.token_delay_ms = atof(optarg); break;
+            case 'c': opts.chunk_size = (size_t)strtoul(optarg, NULL, 10); break;
+            case 'u': opts.split_utf8 = true; break;
+            case 'n': opts.reasoning_tokens = atoi(optarg); break;
+            case 's': opts.status = atoi(optarg); break;
+            case 'D': opts.disconnect_after = atoi(optarg); break;
+            case 'q': opts.quiet = true; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (opts.port < 0 || opts.port > 65535 || opts.status < 100 || opts.status > 599 ||
+        opts.reasoning_tokens < 0) {
+        fprintf(stderr, "Error: Invalid option value\n");
+        return 1;
+    }
+
+    MockStream replay = {0};
+    if (opts.replay_file && !load_replay(&replay, opts.replay_file)) {
+        return 1;
+    }
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    if (server < 0) {
+        perror("socket");
+        return 1;
+    }
+    int one = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)opts.port);
+    if (bind(server, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(server, 128) < 0) {
+        fprintf(stderr, "Error: Cannot listen on 127.0.0.1:%d: %s\n", opts.port, strerror(errno));
+        close(server);
+        return 1;
+    }
+
+    socklen_t addr_len = sizeof(addr);
+    getsockname(server, (struct sockaddr *)&addr, &addr_len);
+    printf("Listening on http://127.0.0.1:%d\n", ntohs(addr.sin_port));
+    fflush(stdout);
+
+    /* 每个连接一个子进程；不需要回收子进程 */
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (;;) {
+        int fd = accept(server, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            break;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(server);
+            serve_connection(fd, &opts, opts.replay_file ? &replay : NULL);
+            _exit(0);
+        }
+        if (pid < 0) perror("fork");
+        close(fd);
+    }
+
+    close(server);
+    return 1;
+}